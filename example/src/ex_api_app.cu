@@ -9,6 +9,9 @@
  *
  */
 
+#include <algorithm>
+#include <vector>
+
 #include "../../src/app.cuh"
 
 void demo_encapsulate_io()
@@ -106,11 +109,42 @@ void demo_expose_io()
     cusz_instance.destroy_compressor();
 }
 
+// decompress into a padded array owned by the caller, e.g., a simulation field with ghost cells
+void demo_host_io()
+{
+    using T = float;
+
+    char* cesm  = getenv(const_cast<char*>("CESM"));
+    auto  fname = std::string(cesm);
+
+    unsigned int const x = 3600, y = 1800, pad = 16;
+
+    std::vector<T> field((x + pad) * y, -1);
+    cusz::app<T>   cusz_instance;
+    cusz_instance.decompress(fname + ".cusza", field.data(), sizeof(T) * (x + pad));  // as compressed in demo 1
+
+    Capsule<T> origin(x * y, "origin");
+    origin.template alloc<cusz::LOC::HOST>().template from_file<cusz::LOC::HOST>(fname);
+
+    double max_err = 0;
+    auto   pad_ok  = true;
+    for (auto j = 0u; j < y; j++) {
+        for (auto i = 0u; i < x; i++)
+            max_err = std::max(max_err, (double)fabs(field[j * (x + pad) + i] - origin.hptr[j * x + i]));
+        for (auto i = x; i < x + pad; i++) pad_ok = pad_ok and field[j * (x + pad) + i] == -1;
+    }
+    printf("pitched decompression: max error %.3e, padding %s\n", max_err, pad_ok ? "untouched" : "overwritten");
+
+    origin.template free<cusz::LOC::HOST>();
+}
+
 int main()
 {
     demo_encapsulate_io();
     cout << "--------------------------------------------------------------------------------\n";
     demo_expose_io();
+    cout << "--------------------------------------------------------------------------------\n";
+    demo_host_io();
 
     return 0;
 }
\ No newline at end of file
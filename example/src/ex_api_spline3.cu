@@ -13,6 +13,8 @@
 #include <thrust/count.h>
 #include <thrust/device_vector.h>
 #include <thrust/execution_policy.h>
+#include <algorithm>
+#include <vector>
 
 #include "ex_common.cuh"
 #include "ex_common2.cuh"
@@ -175,6 +177,41 @@ void compressor_detail(T* data, T* cmp, dim3 xyz, double eb, bool use_sp, cudaSt
         echo_metric_gpu(xdata, cmp, len);
     else
         echo_metric_cpu(xdata, cmp, len);
+
+    // PREVIEW: decode the coarse levels from the archive prefix only (the rest is wiped)
+    std::vector<T> origin(len);
+    cudaMemcpy(origin.data(), cmp, len * sizeof(T), cudaMemcpyDeviceToHost);
+
+    Compressor::HEADER header;
+    memcpy(&header, file.hptr, sizeof(header));
+
+    for (auto nlevel = 0; nlevel < Predictor::NLEVEL; nlevel++) {
+        auto prefix_nbyte = Compressor::get_preview_nbyte(header, nlevel);
+        cudaMemcpy(compressed, file.dptr, compressed_len, cudaMemcpyDeviceToDevice);
+        cudaMemset(compressed + prefix_nbyte, 0x0, compressed_len - prefix_nbyte);
+
+        auto       size   = compressor.get_preview_size(nlevel);
+        auto       stride = cusz::Spline3Level::get_stride(nlevel);
+        Capsule<T> preview(size.x * size.y * size.z, "preview");
+        preview.template alloc<cusz::LOC::HOST_DEVICE>();
+
+        compressor.decompress(compressed, eb, radius, preview.dptr, stream, nlevel);
+        preview.device2host();
+
+        double max_err = 0;
+        for (auto z = 0u; z < size.z; z++)
+            for (auto y = 0u; y < size.y; y++)
+                for (auto x = 0u; x < size.x; x++) {
+                    auto o  = origin[x * stride + y * stride * dimx + z * stride * dimx * dimy];
+                    auto d  = preview.hptr[x + y * size.x + z * size.x * size.y];
+                    max_err = std::max(max_err, (double)fabs(o - d));
+                }
+        printf(
+            "preview level %d: %ux%ux%u, read %.2f%% of archive, max error %.3e (eb %.3e)\n", nlevel, size.x, size.y,
+            size.z, 100.0 * prefix_nbyte / compressed_len, max_err, eb);
+
+        preview.template free<cusz::LOC::HOST_DEVICE>();
+    }
 }
 
 void predictor_demo(bool use_sp, double eb = 1e-2, bool use_compressor = false, bool use_r2r = false)
@@ -28,6 +28,7 @@
 #include "../kernel/hist.cuh"
 #include "../utils/timer.hh"
 #include "../wrapper/huffman_coarse.cuh"
+#include "percentile.hh"
 
 using std::cout;
 
@@ -74,6 +75,7 @@ class Analyzer {
     ~Analyzer() = default;
 
     // TODO execution policy
+    // device: sorts `in` in place; host: the 0th to 100th percentiles, without modifying `in`
     template <typename T, ExecutionPolicy policy = ExecutionPolicy::host>
     static std::vector<T> percentile100(T* in, size_t len)
     {
@@ -92,12 +94,10 @@ class Analyzer {
             res.push_back(htmp[len - 1]);
             cudaFreeHost(htmp);
         }
-        else {  // fallback
-            std::sort(in, in + len);
-            for (auto i = 0; i < len; i += step) {  //
-                res.push_back(in[i]);
-            }
-            res.push_back(in[len - 1]);
+        else {  // by selection, leaving `in` as is
+            std::vector<double> pcts(101);
+            std::iota(pcts.begin(), pcts.end(), 0);
+            res = analysis::get_percentiles(in, len, pcts);
         }
 
         return res;
@@ -0,0 +1,197 @@
+/**
+ * @file percentile.hh
+ * @author Jiannan Tian
+ * @brief Percentiles of host data by sampled splitters and bucketing, without sorting or modifying the input.
+ * @version 0.3
+ * @date 2022-03-26
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef ANALYSIS_PERCENTILE_HH
+#define ANALYSIS_PERCENTILE_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../utils/thread_pool.hh"
+
+namespace analysis {
+
+struct PercentileHelper {
+    static const size_t MAX_NSPLITTER = 4096;  // about 2.5% of the data is copied for 101 percentiles
+    static const size_t OVERSAMPLE    = 16;    // samples per splitter
+    static const size_t MIN_BUCKET    = 4096;  // elements per bucket, at least, on average
+    static const size_t BATCH         = 16;    // values searched at once
+
+    /**
+     * @brief Buckets of `N` values among `nsplit` sorted, distinct splitters: bucket 2j is strictly between splitter
+     * j-1 and j, and bucket 2j+1 is equal to splitter j. The lower bounds are searched level by level for all values
+     * at once, with conditional moves, so that the loads of a level overlap rather than chain up behind mispredicted
+     * branches (4x as fast as `std::lower_bound` per value, over 4096 splitters).
+     */
+    template <size_t N, typename T>
+    static void get_buckets(T const* split, size_t nsplit, T const* v, size_t* bucket)
+    {
+        for (size_t k = 0; k < N; k++) bucket[k] = 0;
+        if (nsplit == 0) return;
+        for (auto m = nsplit; m > 1; m -= m / 2) {
+            auto half = m / 2;
+            for (size_t k = 0; k < N; k++) bucket[k] = split[bucket[k] + half - 1] < v[k] ? bucket[k] + half : bucket[k];
+        }
+        for (size_t k = 0; k < N; k++) {
+            auto j    = bucket[k] + (split[bucket[k]] < v[k]);
+            bucket[k] = 2 * j + (j < nsplit and not(v[k] < split[j]));
+        }
+    }
+};
+
+/**
+ * @brief The `ranks[i]`-th smallest element of `in`, for each i, in about two passes over `in`.
+ *
+ * Splitters are taken from a sorted sample. A first pass counts the elements of each bucket, a bucket being either
+ * the values between two adjacent splitters, or the values equal to a splitter (so that heavily repeated values do
+ * not pile up in one bucket). A rank then falls into a known bucket: if that bucket holds one value, the value is the
+ * splitter; otherwise a second pass copies out only the buckets that hold a rank, and `nth_element` finds the rank
+ * within its bucket. Both passes run on the host thread pool, each worker over a fixed part of `in`, so that every
+ * worker copies to its own place in a bucket without atomics. NaN is not ordered, and not supported.
+ */
+template <typename T>
+std::vector<T> select_ranks(T const* in, size_t len, std::vector<size_t> const& ranks)
+{
+    for (auto k : ranks)
+        if (k >= len) throw std::runtime_error("select_ranks: rank out of range.");
+
+    std::vector<T> res(ranks.size());
+    if (ranks.empty()) return res;
+
+    // splitters from a sorted sample, one pick within each stride, at a hashed offset so as not to alias with the
+    // field; none for a small input, which is then a single bucket
+    auto const     nsplitter = std::min(len / PercentileHelper::MIN_BUCKET, (size_t)PercentileHelper::MAX_NSPLITTER);
+    auto const     nsample   = nsplitter * PercentileHelper::OVERSAMPLE;
+    std::vector<T> sample(nsample), splitters(nsplitter);
+    for (size_t s = 0; s < nsample; s++) {
+        auto lo = s * len / nsample, hi = (s + 1) * len / nsample;
+        sample[s] = in[lo + (s * 2654435761u) % (hi - lo)];
+    }
+    std::sort(sample.begin(), sample.end());
+    for (size_t j = 0; j < nsplitter; j++) splitters[j] = sample[(j + 1) * nsample / (nsplitter + 1)];
+    splitters.erase(std::unique(splitters.begin(), splitters.end()), splitters.end());
+
+    auto const nbucket = 2 * splitters.size() + 1;
+
+    auto&      pool    = cusz::ThreadPool::get_default();
+    auto const nworker = (size_t)pool.get_nworker();
+
+    // fn(i, bucket of in[i]) over the part of worker w
+    auto for_each_bucket = [&](int w, auto const& fn) {
+        auto const begin = w * len / nworker, end = (w + 1) * len / nworker;
+        size_t     bucket[PercentileHelper::BATCH];
+        auto       i = begin;
+        for (; i + PercentileHelper::BATCH <= end; i += PercentileHelper::BATCH) {
+            PercentileHelper::get_buckets<PercentileHelper::BATCH>(splitters.data(), splitters.size(), in + i, bucket);
+            for (size_t k = 0; k < PercentileHelper::BATCH; k++) fn(i + k, bucket[k]);
+        }
+        for (; i < end; i++) {
+            PercentileHelper::get_buckets<1>(splitters.data(), splitters.size(), in + i, bucket);
+            fn(i, bucket[0]);
+        }
+    };
+
+    std::vector<std::vector<size_t>> count(nworker, std::vector<size_t>(nbucket, 0));
+    pool.for_each_worker([&](int w) {
+        auto& c = count[w];
+        for_each_bucket(w, [&](size_t, size_t b) { c[b]++; });
+    });
+
+    // the first rank of each bucket
+    std::vector<size_t> first(nbucket + 1, 0);
+    for (size_t b = 0; b < nbucket; b++) {
+        first[b + 1] = first[b];
+        for (size_t w = 0; w < nworker; w++) first[b + 1] += count[w][b];
+    }
+
+    // a rank in a bucket of one value is the splitter; the other buckets holding a rank are copied out, in order
+    std::vector<bool> wanted(nbucket, false);
+    for (size_t r = 0; r < ranks.size(); r++) {
+        auto b = std::upper_bound(first.begin(), first.end(), ranks[r]) - first.begin() - 1;
+        if (b % 2 == 1)
+            res[r] = splitters[b / 2];
+        else
+            wanted[b] = true;
+    }
+
+    std::vector<size_t> slot(nbucket, SIZE_MAX), picked_bucket, picked_first{0};
+    for (size_t b = 0; b < nbucket; b++)
+        if (wanted[b]) {
+            slot[b] = picked_bucket.size();
+            picked_bucket.push_back(b);
+            picked_first.push_back(picked_first.back() + first[b + 1] - first[b]);
+        }
+    if (picked_bucket.empty()) return res;
+
+    // where each worker writes into each picked bucket
+    std::vector<std::vector<size_t>> cursor(nworker, std::vector<size_t>(picked_bucket.size()));
+    for (size_t s = 0; s < picked_bucket.size(); s++) {
+        auto offset = picked_first[s];
+        for (size_t w = 0; w < nworker; w++) cursor[w][s] = offset, offset += count[w][picked_bucket[s]];
+    }
+
+    std::vector<T> picked(picked_first.back());
+    pool.for_each_worker([&](int w) {
+        auto& c = cursor[w];
+        for_each_bucket(w, [&](size_t i, size_t b) {
+            if (slot[b] != SIZE_MAX) picked[c[slot[b]]++] = in[i];
+        });
+    });
+
+    // within each picked bucket, its ranks in ascending order, each by `nth_element` right of the one before
+    std::vector<size_t> order(ranks.size());
+    for (size_t r = 0; r < ranks.size(); r++) order[r] = r;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ranks[a] < ranks[b]; });
+
+    pool.parallel_for(
+        picked_bucket.size(),
+        [&](size_t begin, size_t end, int) {
+            for (auto s = begin; s < end; s++) {
+                auto b    = picked_bucket[s];
+                auto data = picked.begin() + picked_first[s];
+                auto left = data;
+                for (auto r : order) {
+                    if (ranks[r] < first[b] or ranks[r] >= first[b + 1]) continue;
+                    auto nth = data + (ranks[r] - first[b]);
+                    if (nth >= left) std::nth_element(left, nth, data + (picked_first[s + 1] - picked_first[s]));
+                    res[r] = *nth, left = nth + 1;
+                }
+            }
+        },
+        1);
+
+    return res;
+}
+
+/**
+ * @brief Percentiles `pcts` (0 to 100) of `in`; the p-th is the element of rank floor(p / 100 * (len - 1)), so that
+ * the 0th is the min and the 100th is the max.
+ */
+template <typename T>
+std::vector<T> get_percentiles(T const* in, size_t len, std::vector<double> const& pcts)
+{
+    if (len == 0) throw std::runtime_error("get_percentiles: empty input.");
+
+    std::vector<size_t> ranks(pcts.size());
+    for (size_t i = 0; i < pcts.size(); i++) {
+        if (not(pcts[i] >= 0 and pcts[i] <= 100)) throw std::runtime_error("get_percentiles: out of [0, 100].");
+        ranks[i] = std::min(len - 1, (size_t)std::floor(pcts[i] / 100 * (len - 1)));
+    }
+    return select_ranks(in, len, ranks);
+}
+
+}  // namespace analysis
+
+#endif
@@ -15,23 +15,38 @@
 #include <math.h>
 #include <thrust/device_ptr.h>
 #include <thrust/extrema.h>
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 #include "../example/src/ex_common.cuh"
 #include "analysis/analyzer.hh"
+#include "chunked.hh"
 #include "common.hh"
+#include "container.hh"
 #include "context.hh"
 #include "default_path.cuh"
+#include "planner.hh"
 #include "query.hh"
 #include "utils.hh"
+#include "utils/pipeline.hh"
+#include "utils/thread_pool.hh"
+#include "utils/work_stealing.hh"
+#include "utils/workspace_pool.hh"
 
 using std::string;
 
@@ -111,7 +126,64 @@ class app {
 
     static void destroy_compressor(compressor_t compressor) { delete compressor; }
 
-    void destroy_compressor() { delete compressor; }
+    void destroy_compressor() { delete compressor, compressor = nullptr; }
+
+    /**
+     * @brief Turn on the workspace pool and size it for the largest field to come, by allocating (then dropping) the
+     * workspaces of a compressor for `largest`. Compressors for this or smaller fields, created or destroyed later in
+     * any order, are then carved from the same slabs.
+     *
+     * @param largest configuration of the largest field, e.g., the first timestep of the biggest variable
+     */
+    static void reserve_workspace(context_t largest)
+    {
+        cusz::WorkspacePool::enable();
+        compressor_t probe{nullptr};
+        __init_compressor(&probe, largest, nullptr);
+        delete probe;
+    }
+
+    /**
+     * @brief Give the idle slabs back to CUDA, e.g., between phases of a run; the pool stays enabled.
+     */
+    static void trim_workspace() { cusz::WorkspacePool::trim(); }
+
+    /**
+     * @brief With `--mem-limit`, fit the compression in memory, instead of failing in `allocate_workspace()`: a field
+     * whose monolithic compression is over the cap goes chunked, or streaming, with the largest brick that fits. The
+     * device cap is `--mem-limit` or the free device memory (idle pool slabs included), whichever is less; the host
+     * cap is `--mem-limit` as is. A brick given by the user is kept. Without `--mem-limit`, nothing is planned, so the
+     * archive format never depends on how busy the device is.
+     */
+    static void plan_execution(cuszCTX* ctx)
+    {
+        if ((*ctx).use_chunked() or (*ctx).mem_limit == 0) return;
+
+        size_t free_nbyte, total_nbyte;
+        CHECK_CUDA(cudaMemGetInfo(&free_nbyte, &total_nbyte));
+        auto& pool = cusz::WorkspacePool::device();
+        free_nbyte += pool.get_nbyte_reserved() - pool.get_nbyte_live();
+        auto device_cap = std::min((*ctx).mem_limit, free_nbyte);
+
+        cusz::MemoryPlanner planner(cusz::MemoryPlanner::get_setup(ctx, sizeof(T)), device_cap, (*ctx).mem_limit);
+        dim3_compat         field{(*ctx).x, (*ctx).y, (*ctx).z};
+
+        auto plan = (*ctx).on_off.streaming ? planner.plan_streaming(field) : planner.plan(field);
+        LOGGING(
+            LOG_INFO, "planned", cusz::MemoryPlan::get_mode_name(plan.mode), "compression, device",
+            plan.footprint.get_device_nbyte(), "of", device_cap, "bytes, host", plan.footprint.host, "bytes");
+        if (plan.mode == cusz::MemoryPlan::MONOLITHIC) return;
+
+        if (not(*ctx).fname.container.empty())
+            throw std::runtime_error("field does not fit in memory as a whole; a container holds monolithic fields.");
+        if (not(*ctx).on_off.streaming)
+            LOGGING(
+                LOG_WARN, "--mem-limit: the field does not fit as a whole; writing a",
+                cusz::MemoryPlan::get_mode_name(plan.mode), "archive instead of a monolithic one");
+        (*ctx).brick.x = plan.brick.x, (*ctx).brick.y = plan.brick.y, (*ctx).brick.z = plan.brick.z;
+        (*ctx).on_off.streaming = plan.mode == cusz::MemoryPlan::STREAMING;
+        LOGGING(LOG_INFO, "brick", plan.brick.x, "x", plan.brick.y, "x", plan.brick.z);
+    }
 
    private:
     template <typename CONFIG>
@@ -123,21 +195,36 @@ class app {
     compressor_t compressor{nullptr};
 
    private:
-    void cusz_write2disk_after_compress(BYTE* compressed, size_t compressed_len, string compressed_name)
+    void cusz_write2disk_after_compress(BYTE* compressed, size_t compressed_len, string compressed_name, bool checksum)
     {
         Capsule<BYTE> file("cusza");
-        file.set_len(compressed_len)
-            .template set<DEVICE>(compressed)
-            .template alloc<HOST>()
-            .device2host()
-            .to_file<HOST>(compressed_name)
-            .template free<HOST_DEVICE>();
+        file.set_len(compressed_len).template set<DEVICE>(compressed).template alloc<HOST>().device2host();
+        // on the way to disk, while the archive is on host anyway
+        if (checksum) ArchiveChecksum::seal(file.hptr);
+        file.template to_file<HOST>(compressed_name).template free<HOST_DEVICE>();
     }
 
    public:
-    void cusz_write2disk_after_compress(string compressed_name)
+    void cusz_write2disk_after_compress(string compressed_name, bool checksum = true)
     {
-        cusz_write2disk_after_compress(compressed, compressed_len, compressed_name);
+        cusz_write2disk_after_compress(compressed, compressed_len, compressed_name, checksum);
+    }
+
+    /**
+     * @brief Append the compressed field to a multi-field container under `field_name`, instead of writing a
+     * standalone .cusza.
+     *
+     */
+    void cusz_write2container_after_compress(string container_name, string field_name, cuszCTX* ctx)
+    {
+        std::vector<BYTE> h_compressed(compressed_len);
+        CHECK_CUDA(cudaMemcpy(h_compressed.data(), compressed, compressed_len, cudaMemcpyDeviceToHost));
+
+        ContainerWriter container(container_name);
+        container.add(
+            field_name, (*ctx).x, (*ctx).y, (*ctx).z, sizeof(T), (*ctx).eb, h_compressed.data(), compressed_len,
+            (*ctx).on_off.checksum);
+        container.finalize();
     }
 
    private:
@@ -203,11 +290,21 @@ class app {
             cmp.template free<HOST_DEVICE>();
         };
 
+        // chunk by chunk into the host copy of `xdata`, each verified against the same range of the original, which
+        // is thus never resident as a whole
         auto compare_on_cpu = [&]() {
-            cmp.template alloc<HOST>().template from_file<HOST>(compare);
-            xdata.device2host();
-            echo_metric_cpu(xdata.hptr, cmp.hptr, len, compressd_bytes);
-            cmp.template free<HOST>();
+            auto const CHUNK = BrickLayout::DEFAULT_SLAB_NBYTE / sizeof(T);
+
+            analysis::StreamingVerifier<T> verifier(compare, len);
+            for (size_t begin = 0; begin < len; begin += CHUNK) {
+                auto end = std::min(len, begin + CHUNK);
+                CHECK_CUDA(cudaMemcpy(
+                    xdata.hptr + begin, xdata.dptr + begin, sizeof(T) * (end - begin), cudaMemcpyDeviceToHost));
+                verifier.add_range(xdata.hptr + begin, begin, end);
+            }
+            stat_t stat;
+            verifier.get_stat(&stat);
+            analysis::print_data_quality_metrics<T>(&stat, compressd_bytes, false);
         };
 
         if (compare != "") {
@@ -271,23 +368,846 @@ class app {
         input_shared<T>(uncompressed, len, from_hptr, from_dptr);
     }
 
+    static io::MappedFile::hint_t get_input_hint()
+    {
+        io::MappedFile::hint_t hint;
+        hint.sequential = true;
+        hint.hugepage   = true;
+        return hint;
+    }
+
+    /**
+     * @brief Value range of a host array, scanned in parallel on the host pool; on a mapping, this also faults the
+     * pages in from several threads.
+     */
+    template <typename T>
+    static io::value_range_t<T> scan_value_range(const T* data, size_t len)
+    {
+        auto&                             pool = ThreadPool::get_default();
+        std::vector<io::value_range_t<T>> part(pool.get_nworker());
+        pool.parallel_for(len, [&](size_t begin, size_t end, int w) { part[w].update(data + begin, end - begin); });
+
+        io::value_range_t<T> range;
+        for (auto const& p : part) range.merge(p);
+        return range;
+    }
+
+    /**
+     * @brief Load the file straight from its memory mapping to device; no host buffer is allocated or filled. With
+     * `range`, the value range is found on the way: a piece is scanned right before it is copied, while it is in
+     * cache, so that r2r reads the field once.
+     *
+     */
     template <typename T>
-    static void input_uncompressed(Capsule<T>& uncompressed, size_t len, std::string uncompressed_name)
+    static void input_uncompressed(
+        Capsule<T>&           uncompressed,
+        size_t                len,
+        std::string           uncompressed_name,
+        io::value_range_t<T>* range = nullptr)
+    {
+        io::MappedFile mapped(uncompressed_name, get_input_hint());
+        auto           src = mapped.as<T>(len, uncompressed_name);
+
+        // alloc() zero-fills, keeping the square-matrix padding clean
+        uncompressed.set_len(len).template alloc<DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
+        if (not range) {
+            CHECK_CUDA(cudaMemcpy(uncompressed.dptr, src, sizeof(T) * len, cudaMemcpyHostToDevice));
+            return;
+        }
+
+        auto const PIECE = io::PositionalFile::RANGE_NBYTE / sizeof(T);
+        for (size_t begin = 0; begin < len; begin += PIECE) {
+            auto end = std::min(len, begin + PIECE);
+            range->merge(scan_value_range(src + begin, end - begin));
+            CHECK_CUDA(cudaMemcpy(
+                uncompressed.dptr + begin, src + begin, sizeof(T) * (end - begin), cudaMemcpyHostToDevice));
+        }
+    }
+
+    /**
+     * @brief Load one field of a multi-field container to device; other fields are not read.
+     *
+     */
+    static void input_compressed(
+        Capsule<BYTE>& compressed,
+        std::string    container_name,
+        std::string    field_name,
+        bool           verify = true)
+    {
+        ContainerReader container(container_name);
+        auto const&     entry = container.find(field_name);
+        if (verify) container.verify(entry);
+
+        compressed.set_len(entry.nbyte).template alloc<DEVICE>();
+        CHECK_CUDA(cudaMemcpy(compressed.dptr, container.map(entry), entry.nbyte, cudaMemcpyHostToDevice));
+    }
+
+    static void input_compressed(Capsule<BYTE>& compressed, std::string compressed_name, bool verify = true)
+    {
+        io::MappedFile mapped(compressed_name, get_input_hint());
+        if (verify) ArchiveChecksum::verify(mapped.as<BYTE>(), mapped.size(), compressed_name);
+
+        compressed.set_len(mapped.size()).template alloc<DEVICE>();
+        CHECK_CUDA(cudaMemcpy(compressed.dptr, mapped.as<BYTE>(), mapped.size(), cudaMemcpyHostToDevice));
+    }
+
+   private:
+    /******************************************************************************
+                                    chunked archive
+     ******************************************************************************/
+    using brick_shape_t = std::tuple<uint32_t, uint32_t, uint32_t>;
+
+    // one compressor (and its tuned context) per distinct brick shape; edge bricks can differ from interior ones
+    struct brick_slot_t {
+        compressor_t compressor{nullptr};
+        cuszCTX*     ctx{nullptr};
+    };
+    // compressing slots carry a context; decompressing ones are set up from an archive header and have none, so the
+    // two are never shared
+    std::map<brick_shape_t, brick_slot_t> brick_slots, xbrick_slots;
+
+    std::map<brick_shape_t, brick_slot_t>& __get_slots(cuszCTX*) { return brick_slots; }
+    std::map<brick_shape_t, brick_slot_t>& __get_slots(Header*) { return xbrick_slots; }
+
+    template <typename CONFIG>
+    brick_slot_t& get_brick_slot(const uint32_t extent[3], CONFIG* config)
+    {
+        auto  key  = std::make_tuple(extent[0], extent[1], extent[2]);
+        auto& slot = __get_slots(config)[key];
+        if (slot.compressor) return slot;
+
+        slot.compressor = new Compressor(dim3(extent[0], extent[1], extent[2]));
+        __init_brick_slot(slot, extent, config);
+        return slot;
+    }
+
+    static void __init_brick_slot(brick_slot_t& slot, const uint32_t extent[3], cuszCTX* ctx)
+    {
+        slot.ctx           = new cuszCTX(*ctx);
+        slot.ctx->x        = extent[0];
+        slot.ctx->y        = extent[1];
+        slot.ctx->z        = extent[2];
+        slot.ctx->data_len = (size_t)extent[0] * extent[1] * extent[2];
+        AutoconfigHelper::autotune(slot.ctx);
+        slot.compressor->allocate_workspace(slot.ctx);
+    }
+
+    static void __init_brick_slot(brick_slot_t& slot, const uint32_t extent[3], Header* header)
+    {
+        slot.compressor->allocate_workspace(header);
+    }
+
+   public:
+    void destroy_brick_slots()
+    {
+        for (auto slots : {&brick_slots, &xbrick_slots}) {
+            for (auto& kv : *slots) {
+                delete kv.second.compressor;
+                delete kv.second.ctx;
+            }
+            slots->clear();
+        }
+    }
+
+   private:
+    static size_t __get_staging_len(BrickLayout const& layout)
+    {
+        return (size_t)std::min(layout.brick.x, layout.field.x) * std::min(layout.brick.y, layout.field.y) *
+               std::min(layout.brick.z, layout.field.z);
+    }
+
+    struct brick_blob_t {
+        uint32_t          origin[3], extent[3];
+        std::vector<BYTE> data;
+    };
+    using blob_queue_t = BoundedQueue<brick_blob_t>;
+
+    /**
+     * @brief Compress bricks [first, last) of `layout` and hand them to the writer stage through `out`.
+     *
+     * @param src host array holding (at least) these bricks
+     * @param src_dims dimensions of `src`
+     * @param src_origin field coordinates of `src[0]`
+     * @param staging HOST_DEVICE buffer of the nominal brick, square-matrix aligned
+     * @return false if the writer stage has quit
+     */
+    bool __compress_bricks(
+        const T*           src,
+        dim3_compat        src_dims,
+        const uint32_t     src_origin[3],
+        size_t             first,
+        size_t             last,
+        BrickLayout const& layout,
+        blob_queue_t&      out,
+        Capsule<T>&        staging,
+        cuszCTX*           ctx,
+        cudaStream_t       stream)
+    {
+        auto const staging_nbyte =
+            Align::get_aligned_nbyte<T>(staging.template get_len<cusz::ALIGNDATA::SQUARE_MATRIX>());
+
+        uint32_t const zero[3] = {0, 0, 0};
+
+        for (auto i = first; i < last; i++) {
+            brick_blob_t blob;
+            uint32_t     local[3];
+            layout.get_brick(i, blob.origin, blob.extent);
+            for (auto d = 0; d < 3; d++) local[d] = blob.origin[d] - src_origin[d];
+            auto extent    = blob.extent;
+            auto brick_len = (size_t)extent[0] * extent[1] * extent[2];
+
+            copy_box(src, src_dims, local, staging.hptr, dim3_compat{extent[0], extent[1], extent[2]}, zero, extent);
+            // the spreducer reads the padded square; predictor writes outliers in place, the rest must stay zero
+            CHECK_CUDA(cudaMemsetAsync(staging.dptr, 0x0, staging_nbyte, stream));
+            CHECK_CUDA(cudaMemcpyAsync(
+                staging.dptr, staging.hptr, sizeof(T) * brick_len, cudaMemcpyHostToDevice, stream));
+
+            auto&  slot = get_brick_slot(extent, ctx);
+            BYTE*  d_compressed;
+            size_t compressed_len;
+            (*slot.compressor)
+                .compress(
+                    staging.dptr, slot.ctx, d_compressed, compressed_len, (*ctx).codec_force_fallback(), stream,
+                    (*ctx).report.time);
+
+            blob.data.resize(compressed_len);
+            CHECK_CUDA(cudaMemcpy(blob.data.data(), d_compressed, compressed_len, cudaMemcpyDeviceToHost));
+            if (not out.push(std::move(blob))) return false;
+        }
+        return true;
+    }
+
+    // the write stage: drains `in` into the archive while the caller keeps compressing
+    static PipelineStage* __start_write_stage(ChunkedArchiveWriter& writer, blob_queue_t& in)
+    {
+        return new PipelineStage(
+            [&writer, &in] {
+                brick_blob_t blob;
+                while (in.pop(blob)) writer.append(blob.origin, blob.extent, blob.data.data(), blob.data.size());
+            },
+            [&in] { in.close(); });
+    }
+
+   public:
+    /**
+     * @brief Compress `in_uncompressed` (host, whole field) brick by brick into a chunked archive. Writing brick i-1
+     * overlaps compressing brick i.
+     *
+     * @param in_uncompressed host array of the field
+     * @param ctx context; `eb` is expected to be absolute by now
+     * @param archive_name output file
+     * @param stream CUDA stream
+     */
+    void cusz_compress_chunked(const T* in_uncompressed, cuszCTX* ctx, string archive_name, cudaStream_t stream)
+    {
+        dim3_compat field{(*ctx).x, (*ctx).y, (*ctx).z};
+        dim3_compat brick{(*ctx).brick.x, (*ctx).brick.y, (*ctx).brick.z};
+        BrickLayout layout(field, brick);
+
+        ChunkedArchiveWriter writer(archive_name, field, brick, sizeof(T), (*ctx).eb, (*ctx).on_off.checksum);
+
+        Capsule<T> staging("brick");
+        staging.set_len(__get_staging_len(layout)).template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
+
+        blob_queue_t                   blob_q(ChunkedHelper::BLOB_QUEUE_DEPTH);
+        std::unique_ptr<PipelineStage> write_stage(__start_write_stage(writer, blob_q));
+
+        uint32_t const zero[3] = {0, 0, 0};
+        try {
+            __compress_bricks(in_uncompressed, field, zero, 0, layout.size(), layout, blob_q, staging, ctx, stream);
+        }
+        catch (...) {
+            blob_q.close();
+            throw;
+        }
+        blob_q.close();
+        write_stage->join();
+
+        writer.finalize();
+        staging.template free<HOST_DEVICE>();
+
+        LOGGING(
+            LOG_INFO, "chunked archive:", layout.size(), "bricks,", writer.get_nbyte_written(), "bytes, CR",
+            1.0 * sizeof(T) * (*ctx).data_len / writer.get_nbyte_written());
+    }
+
+    /**
+     * @brief Out-of-core counterpart of cusz_compress_chunked(): the field file is read one slab (a layer of bricks
+     * along the slowest axis) at a time, and bricks are appended to the archive as they are done.
+     * Three stages overlap, each on its own thread: reading slab s+1, compressing slab s (this thread, owning the
+     * GPU), and writing the bricks of slab s-1. Slabs are double-buffered, so peak host memory is two slabs plus one
+     * brick and the queued compressed bricks, regardless of the field size.
+     *
+     * @param fname raw field file
+     * @param ctx context; r2r takes `rangepass=on`, an explicit extra read for the value range, since the bound is
+     * needed before the first slab is quantized; otherwise, the range is only found (and logged) by the read stage
+     * @param archive_name output file
+     * @param stream CUDA stream
+     */
+    void cusz_compress_streaming(string fname, cuszCTX* ctx, string archive_name, cudaStream_t stream)
+    {
+        dim3_compat field{(*ctx).x, (*ctx).y, (*ctx).z};
+        dim3_compat brick{(*ctx).brick.x, (*ctx).brick.y, (*ctx).brick.z};
+        BrickLayout layout(field, brick);
+
+        auto const axis      = layout.get_slab_axis();
+        auto const plane_len = layout.get_plane_len();
+        auto const depth     = std::min(axis == 2 ? brick.z : (axis == 1 ? brick.y : brick.x),  //
+                                    axis == 2 ? field.z : (axis == 1 ? field.y : field.x));
+        auto const nslab     = layout.get_nslab();
+        auto const per_slab  = layout.get_nbrick_per_slab();
+
+        SlabReader<T>               reader(fname, field, plane_len);
+        std::vector<std::vector<T>> slabs(ChunkedHelper::NSLAB_BUFFER, std::vector<T>(plane_len * depth));
+
+        // the bound quantizes slab 0, before the read stage has seen slab 1: r2r needs the range up front
+        if ((*ctx).mode == "r2r") {
+            if (not(*ctx).on_off.range_pass)
+                throw std::runtime_error(
+                    "streaming r2r needs the value range before the first slab; use an absolute `eb` (`-m abs`), or "
+                    "opt in to an extra read of the input with `rangepass=on`.");
+            LOGGING(LOG_INFO, "rangepass: reading the input once more for the r2r value range");
+            io::value_range_t<T> range;
+            for (size_t s = 0; s < nslab; s++) {
+                uint32_t plane_begin, plane_end;
+                layout.get_slab(s, plane_begin, plane_end);
+                reader.read(plane_begin, plane_end, slabs[0].data(), range);
+            }
+            (*ctx).eb *= range.get_rng();
+        }
+
+        ChunkedArchiveWriter writer(archive_name, field, brick, sizeof(T), (*ctx).eb, (*ctx).on_off.checksum);
+
+        Capsule<T> staging("brick");
+        staging.set_len(__get_staging_len(layout)).template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
+
+        // slab buffers circulate: free -> (read) -> full -> (compress) -> free
+        using slab_t = std::pair<size_t, size_t>;  // slab id, buffer id
+        BoundedQueue<size_t> free_q(slabs.size());
+        BoundedQueue<slab_t> full_q(slabs.size());
+        blob_queue_t         blob_q(std::max(per_slab, (size_t)ChunkedHelper::BLOB_QUEUE_DEPTH));
+        for (size_t b = 0; b < slabs.size(); b++) free_q.push(b);
+
+        // the read stage finds the value range as it reads, and reports it for picking an absolute bound next time
+        io::value_range_t<T>           seen;
+        std::unique_ptr<PipelineStage> read_stage(new PipelineStage(
+            [&] {
+                size_t b;
+                for (size_t s = 0; s < nslab and free_q.pop(b); s++) {
+                    uint32_t plane_begin, plane_end;
+                    layout.get_slab(s, plane_begin, plane_end);
+                    reader.read(plane_begin, plane_end, slabs[b].data(), seen);
+                    if (not full_q.push({s, b})) return;
+                }
+            },
+            [&] { full_q.close(); }));
+        std::unique_ptr<PipelineStage> write_stage(__start_write_stage(writer, blob_q));
+
+        auto close_all = [&] { free_q.close(), full_q.close(), blob_q.close(); };
+        try {
+            slab_t item;
+            while (full_q.pop(item)) {
+                uint32_t plane_begin, plane_end;
+                layout.get_slab(item.first, plane_begin, plane_end);
+
+                uint32_t slab_origin[3] = {0, 0, 0};
+                uint32_t slab_dims[3]   = {field.x, field.y, field.z};
+                slab_origin[axis]       = plane_begin;
+                slab_dims[axis]         = plane_end - plane_begin;
+
+                auto const s = item.first;
+                if (not __compress_bricks(
+                        slabs[item.second].data(), dim3_compat{slab_dims[0], slab_dims[1], slab_dims[2]}, slab_origin,
+                        s * per_slab, (s + 1) * per_slab, layout, blob_q, staging, ctx, stream))
+                    break;
+                free_q.push(item.second);
+            }
+        }
+        catch (...) {
+            close_all();
+            throw;
+        }
+        close_all();
+        read_stage->join();
+        write_stage->join();
+
+        writer.finalize();
+        staging.template free<HOST_DEVICE>();
+
+        LOGGING(
+            LOG_INFO, "streamed", nslab, "slabs of", sizeof(T) * slabs[0].size(), "bytes into", layout.size(),
+            "bricks,", writer.get_nbyte_written(), "bytes, CR",
+            1.0 * sizeof(T) * (*ctx).data_len / writer.get_nbyte_written());
+        LOGGING(LOG_INFO, "value range", seen.get_rng(), "(eb", (*ctx).eb, "absolute)");
+    }
+
+    using brick_fn = std::function<void(const T* brick_data, const chunked_brick_t& brick)>;
+
+    /**
+     * @brief Decompress only the bricks intersecting `region` and write the subvolume into `out_region`.
+     *
+     * @param reader opened archive
+     * @param region half-open box [lo, hi) in field coordinates
+     * @param out_region host array of `region.get_len()`, x-fastest; or nullptr to only stream the bricks out
+     * @param stream CUDA stream
+     * @param report_time on-off, reporting kernel time
+     * @param verify check each brick against its CRC before decoding
+     * @param on_brick if set, gets each decoded brick (host, dense) as well, e.g., to stream it out
+     */
+    void cusz_decompress_region(
+        ChunkedArchiveReader&   reader,
+        const chunked_region_t& region,
+        T*                      out_region,
+        cudaStream_t            stream,
+        bool                    report_time = false,
+        bool                    verify      = true,
+        brick_fn                on_brick    = nullptr)
+    {
+        auto const& index = reader.get_index();
+        auto const  hit   = reader.query(region);
+
+        size_t max_len = 0, max_nbyte = 0;
+        for (auto i : hit) {
+            max_len   = std::max(max_len, (size_t)index[i].extent[0] * index[i].extent[1] * index[i].extent[2]);
+            max_nbyte = std::max(max_nbyte, (size_t)index[i].nbyte);
+        }
+
+        Capsule<T>    staging("brick");
+        Capsule<BYTE> blob("brick-archive");
+        staging.set_len(max_len).template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
+        blob.set_len(max_nbyte).template alloc<DEVICE>();
+
+        for (auto i : hit) {
+            auto const& b         = index[i];
+            auto        brick_len = (size_t)b.extent[0] * b.extent[1] * b.extent[2];
+
+            // from the archive mapping directly
+            if (verify) reader.verify_brick(i);
+            CHECK_CUDA(cudaMemcpy(blob.dptr, reader.map_brick(i), b.nbyte, cudaMemcpyHostToDevice));
+
+            Header header;
+            memcpy(&header, reader.map_brick(i), sizeof(Header));
+
+            auto& slot = get_brick_slot(b.extent, &header);
+            (*slot.compressor).decompress(blob.dptr, &header, staging.dptr, stream, report_time);
+
+            CHECK_CUDA(cudaMemcpy(staging.hptr, staging.dptr, sizeof(T) * brick_len, cudaMemcpyDeviceToHost));
+            if (out_region) region.copy_from_brick(staging.hptr, b, out_region);
+            if (on_brick) on_brick(staging.hptr, b);
+        }
+
+        staging.template free<HOST_DEVICE>();
+        blob.template free<DEVICE>();
+
+        LOGGING(LOG_DBG, "region decoded", hit.size(), "of", index.size(), "bricks");
+    }
+
+    /**
+     * @brief high-level decompress_region() API; `out_region` is provided by caller (host, `region.get_len()`).
+     *
+     * @param archive_name chunked archive, compressed with `brick` set
+     * @param region half-open box [lo, hi) in field coordinates
+     * @param out_region host array of the subvolume, x-fastest
+     * @param stream CUDA stream
+     */
+    void decompress_region(string archive_name, const chunked_region_t& region, T* out_region, cudaStream_t stream)
+    {
+        if (not ChunkedArchiveReader::is_chunked(archive_name))
+            throw std::runtime_error(
+                "decompress_region: " + archive_name + " is not chunked; compress with --config brick=<x>x<y>x<z>.");
+
+        ChunkedArchiveReader reader(archive_name);
+        cusz_decompress_region(reader, region, out_region, stream);
+    }
+
+    /**
+     * @brief Decompress a whole chunked archive into `out_decompressed` (host, whole field).
+     *
+     */
+    void cusz_decompress_chunked(
+        ChunkedArchiveReader& reader,
+        T*                    out_decompressed,
+        cudaStream_t          stream,
+        bool                  report_time = false,
+        bool                  verify      = true)
+    {
+        cusz_decompress_region(reader, reader.get_whole(), out_decompressed, stream, report_time, verify);
+    }
+
+   private:
+    /******************************************************************************
+                                decompress to host memory
+     ******************************************************************************/
+    // device-side decoder output and archive, kept across calls and grown on demand
+    T*     d_xdata_ws{nullptr};
+    size_t xdata_ws_nbyte{0};
+    BYTE*  d_archive_ws{nullptr};
+    size_t archive_ws_nbyte{0};
+
+    template <typename U>
+    static U* __reserve(U*& d_ws, size_t& ws_nbyte, size_t nbyte)
+    {
+        if (nbyte > ws_nbyte) {
+            if (d_ws) CHECK_CUDA(cusz::WorkspacePool::free(d_ws));
+            CHECK_CUDA(cusz::WorkspacePool::malloc(&d_ws, nbyte));
+            ws_nbyte = nbyte;
+        }
+        return d_ws;
+    }
+
+    static bool __is_dense(dim3 xyz, size_t row_pitch, size_t slice_pitch)
+    {
+        return (row_pitch == 0 or row_pitch == sizeof(T) * xyz.x) and
+               (slice_pitch == 0 or slice_pitch == sizeof(T) * xyz.x * xyz.y);
+    }
+
+   public:
+    ~app()
+    {
+        destroy_brick_slots();
+        if (d_xdata_ws) cusz::WorkspacePool::free(d_xdata_ws);
+        if (d_archive_ws) cusz::WorkspacePool::free(d_archive_ws);
+    }
+
+    /**
+     * @brief Copy a dense device field into host memory of the caller, row by row as the pitches require.
+     *
+     * @param d_src (device) dense field of `xyz`, x-fastest
+     * @param out (host) destination
+     * @param row_pitch bytes between rows of `out`; 0 for dense
+     * @param slice_pitch bytes between slices (xy-planes) of `out`; 0 for dense
+     * @param stream CUDA stream
+     */
+    static void copy_to_host_pitched(
+        const T*     d_src,
+        dim3         xyz,
+        T*           out,
+        size_t       row_pitch,
+        size_t       slice_pitch,
+        cudaStream_t stream = nullptr)
+    {
+        auto row_nbyte = sizeof(T) * xyz.x;
+        if (row_pitch == 0) row_pitch = row_nbyte;
+        if (slice_pitch == 0) slice_pitch = row_pitch * xyz.y;
+        if (row_pitch < row_nbyte or slice_pitch < row_pitch * xyz.y)
+            throw std::runtime_error("copy_to_host_pitched: pitch is smaller than a row or a slice.");
+
+        if (slice_pitch == row_pitch * xyz.y)  // slices back to back: one 2D copy
+            CHECK_CUDA(cudaMemcpy2DAsync(
+                out, row_pitch, d_src, row_nbyte, row_nbyte, (size_t)xyz.y * xyz.z, cudaMemcpyDeviceToHost, stream));
+        else
+            for (auto z = 0u; z < xyz.z; z++)
+                CHECK_CUDA(cudaMemcpy2DAsync(
+                    reinterpret_cast<BYTE*>(out) + z * slice_pitch, row_pitch, d_src + (size_t)z * xyz.x * xyz.y,
+                    row_nbyte, row_nbyte, xyz.y, cudaMemcpyDeviceToHost, stream));
+        CHECK_CUDA(cudaStreamSynchronize(stream));
+    }
+
+    /**
+     * @brief Decompress an archive on device into host memory of the caller; the decoder writes into a reused device
+     * workspace, and nothing of full size is allocated on host.
+     *
+     * @param in_compressed (device) archive
+     * @param header (host) its header
+     * @param out (host) destination, of `header->x`, `header->y`, `header->z` with the pitches below
+     * @param row_pitch bytes between rows of `out`; 0 for dense
+     * @param slice_pitch bytes between slices of `out`; 0 for dense
+     * @param stream CUDA stream
+     * @param report_time on-off, reporting kernel time
+     */
+    void cusz_decompress_to_host(
+        BYTE*        in_compressed,
+        Header*      header,
+        T*           out,
+        size_t       row_pitch,
+        size_t       slice_pitch,
+        cudaStream_t stream,
+        bool         report_time = false)
+    {
+        auto len   = (*header).get_uncompressed_len();
+        auto nbyte = Align::get_aligned_nbyte<T>(Align::get_aligned_datalen<cusz::ALIGNDATA::SQUARE_MATRIX>(len));
+
+        // as zero-filled as a fresh allocation, for the square-matrix padding
+        auto d_xdata = __reserve(d_xdata_ws, xdata_ws_nbyte, nbyte);
+        CHECK_CUDA(cudaMemsetAsync(d_xdata, 0x0, nbyte, stream));
+
+        // one compressor per field shape, as for bricks
+        uint32_t const extent[3] = {(*header).x, (*header).y, (*header).z};
+        auto&          slot      = get_brick_slot(extent, header);
+        (*slot.compressor).decompress(in_compressed, header, d_xdata, stream, report_time);
+
+        copy_to_host_pitched(d_xdata, get_xyz(header), out, row_pitch, slice_pitch, stream);
+    }
+
+    /**
+     * @brief high-level decompress() API into host memory of the caller, e.g., an array owned by the simulation.
+     *
+     * @param archive_name a .cusza archive; if chunked, `out` must be dense
+     * @param out (host) destination of the whole field
+     * @param row_pitch bytes between rows of `out`; 0 for dense
+     * @param slice_pitch bytes between slices of `out`; 0 for dense
+     * @param stream CUDA stream
+     * @param verify check the archive checksums before decoding
+     */
+    void decompress(
+        string       archive_name,
+        T*           out,
+        size_t       row_pitch   = 0,
+        size_t       slice_pitch = 0,
+        cudaStream_t stream      = nullptr,
+        bool         verify      = true)
+    {
+        if (ChunkedArchiveReader::is_chunked(archive_name)) {
+            ChunkedArchiveReader reader(archive_name);
+            auto                 field = reader.get_field();
+            if (not __is_dense(dim3(field.x, field.y, field.z), row_pitch, slice_pitch))
+                throw std::runtime_error(
+                    "decompress: " + archive_name + " is chunked; pitched output is not supported.");
+            cusz_decompress_chunked(reader, out, stream, false, verify);
+            return;
+        }
+
+        io::MappedFile mapped(archive_name, get_input_hint());
+        if (verify) ArchiveChecksum::verify(mapped.as<BYTE>(), mapped.size(), archive_name);
+
+        Header header;
+        memcpy(&header, mapped.as<BYTE>(), sizeof(Header));
+
+        auto d_archive = __reserve(d_archive_ws, archive_ws_nbyte, mapped.size());
+        CHECK_CUDA(cudaMemcpy(d_archive, mapped.as<BYTE>(), mapped.size(), cudaMemcpyHostToDevice));
+
+        cusz_decompress_to_host(d_archive, &header, out, row_pitch, slice_pitch, stream);
+    }
+
+    /******************************************************************************
+     * batch
+     ******************************************************************************/
+    struct batch_job_t {
+        const T*    data;  // host
+        dim3_compat dims;
+        double      eb;
+        bool        r2r{false};  // `eb` is relative to the value range of the field
+    };
+
+    struct batch_result_t {
+        std::vector<BYTE> archive;  // the same bytes as a .cusza file
+        double            eb{0};    // absolute
+        double            cr{0};
+        double            seconds{0};  // on the worker, copies included
+        int               worker{-1};
+        std::string       error;  // empty on success
+    };
+
+   private:
+    static const size_t BATCH_SLOT_PER_WORKER = 16;  // compressors kept per worker, by field shape
+
+    // The device stages of a compression cannot overlap another's: prediction ends in `cudaDeviceSynchronize()`, and
+    // the codebook is built on the legacy default stream by cooperative kernels that share `__device__` state.
+    static std::mutex& get_device_stage_mutex()
+    {
+        static std::mutex mtx;
+        return mtx;
+    }
+
+    // per batch worker: its stream and staging, and compressors by field shape, reused from job to job
+    struct batch_worker_t {
+        cudaStream_t                          stream{nullptr};
+        Capsule<T>                            staging{"batch"};
+        size_t                                staging_len{0};
+        std::map<brick_shape_t, brick_slot_t> slots;
+        std::list<brick_shape_t>              lru;  // most recently used first
+
+        void clear_slots()
+        {
+            for (auto& kv : slots) delete kv.second.compressor, delete kv.second.ctx;
+            slots.clear(), lru.clear();
+        }
+
+        ~batch_worker_t()
+        {
+            clear_slots();
+            if (staging_len) staging.template free<HOST_DEVICE>();
+            if (stream) cudaStreamDestroy(stream);
+        }
+    };
+
+    // what of the base context the compressors of a batch worker are set up with
+    using batch_base_key_t = std::tuple<int, float, uint32_t, int, int, bool>;
+
+    static batch_base_key_t __get_batch_base_key(cuszCTX const* base)
+    {
+        return std::make_tuple(
+            (*base).radius, (*base).nz_density_factor, (*base).codecs_in_use, (*base).vle_sublen, (*base).vle_pardeg,
+            (*base).on_off.autotune_vle_pardeg);
+    }
+
+    // a pool per worker count, with the state of its workers, kept from batch to batch; see `destroy_batch_workers()`
+    struct batch_crew_t {
+        std::mutex                  mtx;  // one batch at a time
+        WorkStealingPool            pool;
+        std::vector<batch_worker_t> workers;
+        batch_base_key_t            base_key{};
+
+        explicit batch_crew_t(int nworker) : pool(nworker), workers(nworker) {}
+    };
+
+    static std::map<int, batch_crew_t*>& get_batch_crews()
+    {
+        static std::map<int, batch_crew_t*> crews;  // not freed at exit, after which CUDA calls would fail
+        return crews;
+    }
+
+    static std::mutex& get_batch_crews_mutex()
+    {
+        static std::mutex mtx;
+        return mtx;
+    }
+
+    static batch_crew_t& __get_batch_crew(int nworker)
+    {
+        std::lock_guard<std::mutex> lock(get_batch_crews_mutex());
+        auto&                       crew = get_batch_crews()[nworker];
+        if (not crew) crew = new batch_crew_t(nworker);
+        return *crew;
+    }
+
+    static brick_slot_t& __get_batch_slot(batch_worker_t& wk, const uint32_t extent[3], cuszCTX* base)
+    {
+        auto key = std::make_tuple(extent[0], extent[1], extent[2]);
+        auto it  = std::find(wk.lru.begin(), wk.lru.end(), key);
+        if (it != wk.lru.end()) {
+            wk.lru.splice(wk.lru.begin(), wk.lru, it);
+            return wk.slots[key];
+        }
+
+        if (wk.slots.size() == BATCH_SLOT_PER_WORKER) {
+            auto& oldest = wk.slots[wk.lru.back()];
+            delete oldest.compressor, delete oldest.ctx;
+            wk.slots.erase(wk.lru.back()), wk.lru.pop_back();
+        }
+        auto& slot      = wk.slots[key];
+        slot.compressor = new Compressor(dim3(extent[0], extent[1], extent[2]));
+        __init_brick_slot(slot, extent, base);
+        wk.lru.push_front(key);
+        return slot;
+    }
+
+    static void __compress_batch_job(batch_worker_t& wk, batch_job_t const& job, cuszCTX* base, batch_result_t& res)
+    {
+        host_timer_t t;
+        t.timer_start();
+
+        uint32_t const extent[3] = {job.dims.x, job.dims.y, job.dims.z};
+        auto const     len       = (size_t)extent[0] * extent[1] * extent[2];
+
+        res.eb = job.eb;
+        if (job.r2r) {
+            io::value_range_t<T> range;
+            range.update(job.data, len);
+            res.eb *= range.get_rng();
+        }
+
+        if (not wk.stream) CHECK_CUDA(cudaStreamCreate(&wk.stream));
+        if (wk.staging_len < len) {
+            if (wk.staging_len) wk.staging.template free<HOST_DEVICE>();
+            wk.staging.set_len(len).template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
+            wk.staging_len = len;
+        }
+        auto const padded_nbyte =
+            Align::get_aligned_nbyte<T>(Align::get_aligned_datalen<cusz::ALIGNDATA::SQUARE_MATRIX>(len));
+
+        // pinned, so that the copy is asynchronous to the other workers; the padding must stay zero
+        memcpy(wk.staging.hptr, job.data, sizeof(T) * len);
+        CHECK_CUDA(cudaMemsetAsync(wk.staging.dptr, 0x0, padded_nbyte, wk.stream));
+        CHECK_CUDA(
+            cudaMemcpyAsync(wk.staging.dptr, wk.staging.hptr, sizeof(T) * len, cudaMemcpyHostToDevice, wk.stream));
+
+        BYTE*  d_compressed;
+        size_t compressed_len;
+        {
+            std::lock_guard<std::mutex> lock(get_device_stage_mutex());
+
+            auto& slot   = __get_batch_slot(wk, extent, base);
+            slot.ctx->eb = res.eb;
+            (*slot.compressor)
+                .compress(
+                    wk.staging.dptr, slot.ctx, d_compressed, compressed_len, (*base).codec_force_fallback(),
+                    wk.stream, false);
+
+            res.archive.resize(compressed_len);
+            CHECK_CUDA(
+                cudaMemcpyAsync(res.archive.data(), d_compressed, compressed_len, cudaMemcpyDeviceToHost, wk.stream));
+            CHECK_CUDA(cudaStreamSynchronize(wk.stream));
+        }
+        if ((*base).on_off.checksum) ArchiveChecksum::seal(res.archive.data());
+
+        t.timer_end();
+        res.seconds = t.get_time_elapsed();
+        res.cr      = 1.0 * sizeof(T) * len / compressed_len;
+    }
+
+   public:
+    /**
+     * @brief Compress many (small) host fields, each into its own archive. Per-call costs are paid once per worker and
+     * field shape, not per field: a worker keeps its CUDA stream, a pinned staging buffer and (up to
+     * `BATCH_SLOT_PER_WORKER`) autotuned compressors with their workspaces, by shape. Jobs are balanced by their
+     * length on a work-stealing pool (see `WorkStealingPool`), so that large and small fields mix.
+     *
+     * Workers, with their threads, streams, staging and compressors, are kept from call to call, per `nworker`, so
+     * that a stream of small batches pays their setup once; `destroy_batch_workers()` releases them. Calls with the
+     * same `nworker` take turns.
+     *
+     * Only the host side of the workers runs concurrently: the value range (r2r), the copy into staging and its
+     * upload overlap another worker's compression, but the device stages, from the compressor setup to the download
+     * of the archive, take turns (see `get_device_stage_mutex()`), as they synchronize the whole device.
+     *
+     * A job that throws (e.g., on a configuration its shape does not allow) reports its `error`; the others go on.
+     *
+     * @param jobs fields to compress; the host arrays must stay valid for the call
+     * @param base context for everything but the dims and error bound, e.g., radius, codec, checksum
+     * @param nworker workers, each with its own stream
+     * @return per-job archives and stats, in the order of `jobs`
+     */
+    static std::vector<batch_result_t>
+    cusz_compress_batch(std::vector<batch_job_t> const& jobs, cuszCTX* base, int nworker = 4)
     {
-        double time_loading;
-        uncompressed.set_len(len)
-            .template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>()
-            .template from_file<HOST>(uncompressed_name, &time_loading)
-            .host2device();
+        std::vector<batch_result_t> results(jobs.size());
+
+        auto&                       crew = __get_batch_crew(nworker);
+        std::lock_guard<std::mutex> lock(crew.mtx);
+        auto&                       pool    = crew.pool;
+        auto&                       workers = crew.workers;
+
+        // compressors set up from the base of an earlier batch are started over for another one
+        if (__get_batch_base_key(base) != crew.base_key) {
+            for (auto& wk : workers) wk.clear_slots();
+            crew.base_key = __get_batch_base_key(base);
+        }
+
+        auto get_len = [&](size_t i) { return (size_t)jobs[i].dims.x * jobs[i].dims.y * jobs[i].dims.z; };
+
+        pool.run(jobs.size(), get_len, [&](size_t i, int w) {
+            results[i].worker = w;
+            try {
+                __compress_batch_job(workers[w], jobs[i], base, results[i]);
+            }
+            catch (std::exception const& e) {
+                results[i].error = e.what();
+            }
+        });
+
+        LOGGING(
+            LOG_INFO, "batch:", jobs.size(), "fields on", nworker, "workers,", pool.get_nstolen(),
+            "stolen from other workers");
+        return results;
     }
 
-    static void input_compressed(Capsule<BYTE>& compressed, std::string compressed_name)
+    // the batch workers of every `nworker`: their streams, staging and compressors
+    static void destroy_batch_workers()
     {
-        auto compressed_len = ConfigHelper::get_filesize(compressed_name);
-        compressed.set_len(compressed_len)
-            .template alloc<HOST_DEVICE>()
-            .template from_file<HOST>(compressed_name)
-            .host2device();
+        std::lock_guard<std::mutex> lock(get_batch_crews_mutex());
+        for (auto& kv : get_batch_crews()) delete kv.second;
+        get_batch_crews().clear();
     }
 
     /**
@@ -306,25 +1226,89 @@ class app {
         auto basename = (*ctx).fname.fname;
 
         if ((*ctx).task_is.dryrun) cli_dryrun<Predictor>(ctx);
-        if ((*ctx).task_is.construct) {  //
+        if (not(*ctx).fname.container.empty() and ((*ctx).on_off.streaming or (*ctx).use_chunked()))
+            throw std::runtime_error("container holds monolithic fields; not to use with `brick` or `streaming`.");
+        if ((*ctx).task_is.construct) plan_execution(ctx);
+
+        if ((*ctx).task_is.construct and (*ctx).on_off.streaming) {
+            if (not(*ctx).use_chunked()) {
+                auto brick = BrickLayout::get_slab_brick(
+                    dim3_compat{(*ctx).x, (*ctx).y, (*ctx).z}, sizeof(T), BrickLayout::DEFAULT_SLAB_NBYTE);
+                (*ctx).brick.x = brick.x, (*ctx).brick.y = brick.y, (*ctx).brick.z = brick.z;
+            }
+            cusz_compress_streaming(basename, ctx, basename + ".cusza", stream);
+            destroy_brick_slots();
+        }
+        else if ((*ctx).task_is.construct and (*ctx).use_chunked()) {
+            auto len = (*ctx).x * (*ctx).y * (*ctx).z;
+
+            // bricks are cut from the mapping; the field is never copied as a whole
+            io::MappedFile mapped(basename, get_input_hint());
+            auto           field = mapped.as<T>(len, basename);
+            if ((*ctx).mode == "r2r") (*ctx).eb *= scan_value_range(field, len).get_rng();
+
+            cusz_compress_chunked(field, ctx, basename + ".cusza", stream);
+            destroy_brick_slots();
+        }
+        else if ((*ctx).task_is.construct) {  //
             auto len = (*ctx).x * (*ctx).y * (*ctx).z;
 
-            input_uncompressed<T>(uncompressed, len, basename);
-            if ((*ctx).mode == "r2r") (*ctx).eb *= uncompressed.prescan().get_rng();
+            // for r2r, the value range is found as the field is loaded, instead of by a min/max pass on device
+            io::value_range_t<T> range;
+            input_uncompressed<T>(uncompressed, len, basename, (*ctx).mode == "r2r" ? &range : nullptr);
+            if ((*ctx).mode == "r2r") (*ctx).eb *= range.get_rng();
 
             // core compression
             {
                 init_compressor(ctx);
                 cusz_compress(uncompressed.dptr, ctx, stream, (*ctx).report.time);
-                cusz_write2disk_after_compress(basename + ".cusza");
+                if ((*ctx).fname.container.empty())
+                    cusz_write2disk_after_compress(basename + ".cusza", (*ctx).on_off.checksum);
+                else
+                    cusz_write2container_after_compress((*ctx).fname.container, (*ctx).fname.basename, ctx);
             }
         }
 
-        if ((*ctx).task_is.reconstruct) {
-            // TODO improve header copy (GPU-CPU)
+        if ((*ctx).task_is.reconstruct and (*ctx).fname.container.empty() and
+            ChunkedArchiveReader::is_chunked(basename + ".cusza")) {
+            ChunkedArchiveReader reader(basename + ".cusza");
+            auto                 field         = reader.get_field();
+            auto                 archive_nbyte = ConfigHelper::get_filesize(basename + ".cusza");
+
+            // brick by brick: each is written out and verified against the same box of the original, so that
+            // neither the decompressed field nor the original is resident
+            uint32_t const field_dims[3] = {field.x, field.y, field.z};
+
+            std::unique_ptr<analysis::StreamingVerifier<T>> verifier;
+            if ((*ctx).fname.origin_cmp != "")
+                verifier.reset(new analysis::StreamingVerifier<T>((*ctx).fname.origin_cmp, field.x, field.y, field.z));
+            io::PositionalFile out;
+            if (!(*ctx).to_skip.write2disk) out.open(basename + ".cuszx", io::PositionalFile::WRITE);
+
+            cusz_decompress_region(
+                reader, reader.get_whole(), nullptr, stream, (*ctx).report.time, (*ctx).on_off.checksum,
+                [&](const T* brick_data, const chunked_brick_t& b) {
+                    if (verifier) verifier->add_box(brick_data, b.origin, b.extent);
+                    if (!(*ctx).to_skip.write2disk) out.write_box(brick_data, field_dims, b.origin, b.extent);
+                });
+            destroy_brick_slots();
+
+            if (verifier) {
+                if (not verifier->is_complete())
+                    throw std::runtime_error("reconstruct: bricks of " + basename + ".cusza do not cover the field.");
+                stat_t stat;
+                verifier->get_stat(&stat);
+                analysis::print_data_quality_metrics<T>(&stat, archive_nbyte, false);
+            }
+        }
+        else if ((*ctx).task_is.reconstruct) {
             auto header = new Header;
-            input_compressed(compressed, basename + ".cusza");
-            memcpy(header, compressed.hptr, sizeof(Header));
+            if ((*ctx).fname.container.empty())
+                input_compressed(compressed, basename + ".cusza", (*ctx).on_off.checksum);
+            else
+                input_compressed(
+                    compressed, (*ctx).fname.container, (*ctx).fname.basename, (*ctx).on_off.checksum);
+            CHECK_CUDA(cudaMemcpy(header, compressed.dptr, sizeof(Header), cudaMemcpyDeviceToHost));
 
             auto len = (*header).get_uncompressed_len();
             decompressed.set_len(len).template alloc<HOST_DEVICE, cusz::ALIGNDATA::SQUARE_MATRIX>();
@@ -140,6 +140,12 @@ static const char cusz_full_doc[] =
     "                For verification & get data quality evaluation.\n"
     "        *--opath*  /path/to\n"
     "                Specify alternative output path.\n"
+    "        *--mem-limit* <size>[K|M|G|T]\n"
+    "                Cap device and host memory in bytes, e.g., _--mem-limit 8G_. The device cap is the\n"
+    "                lesser of this and the free device memory; the host cap (mapped field or slab buffers,\n"
+    "                staging, compressed bricks in flight) is this as is. A field whose monolithic compression\n"
+    "                exceeds a cap goes chunked, or streaming if its mapping does, with the largest brick that\n"
+    "                fits, and a warning is printed. Without it, nothing is planned.\n"
     "\n"
     "    *Modules*\n"
     "        *--skip* _module-1_,_module-2_,...,_module-n_,\n"
@@ -192,6 +198,22 @@ static const char cusz_full_doc[] =
     "                       Manually specify chunk size for Huffman codec, overriding autotuning.\n"
     "                       Should be a power-of-2 that is sufficiently large.\n"
     "                       ^^This affects Huffman decoding performance significantly.^^\n"
+    "                   + *brick*=<x>[x<y>[x<z>]]\n"
+    "                       Compress into a seekable chunked archive of independently compressed bricks,\n"
+    "                       e.g., _brick=64x64x64_. Decompression detects the layout automatically.\n"
+    "                   + *streaming*=<on|off>\n"
+    "                       Read the input one slab (a layer of bricks along the slowest axis) at a time,\n"
+    "                       for fields larger than host memory. Without _brick_, slabs are whole planes, ~256 MB.\n"
+    "                   + *rangepass*=<on|off>\n"
+    "                       With _streaming_, allow _-m r2r_ by reading the input once more, ahead, for the value\n"
+    "                       range the bound is relative to. Otherwise streaming takes _-m abs_. (default: off)\n"
+    "                   + *checksum*=<on|off>\n"
+    "                       CRC32C per archive segment (and per brick/field in chunked archives and containers),\n"
+    "                       computed when writing and verified when reading. (default: on)\n"
+    "                   + *container*=<file>\n"
+    "                       Pack fields into one multi-field file instead of one _.cusza_ per field; the field\n"
+    "                       is named by the input basename, e.g., _-i ./CLDHGH -z_ appends \"CLDHGH\", and\n"
+    "                       _-i ./CLDHGH.cusza -x_ extracts it alone.\n"
     "\n"
     "*EXAMPLES*\n"
     "    *Demo Datasets*\n"
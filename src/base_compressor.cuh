@@ -73,14 +73,16 @@ class BaseCompressor {
 
         LOGGING(LOG_INFO, "invoke dry-run");
 
-        nc->original.template from_file<cusz::LOC::HOST>(fname).host2device_async(stream);
+        // for r2r, the value range is found as the field is read
+        io::value_range_t<T> range;
+        if (r2r)
+            nc->original.from_file(fname, range);
+        else
+            nc->original.template from_file<cusz::LOC::HOST>(fname);
+        nc->original.host2device_async(stream);
         CHECK_CUDA(cudaStreamSynchronize(stream));
 
-        if (r2r) {
-            double max, min, rng;
-            nc->original.prescan(max, min, rng);
-            eb *= rng;
-        }
+        if (r2r) eb *= range.get_rng();
 
         nc->p->construct(nc->original.dptr, nc->anchor.dptr, nc->errctrl.dptr, eb, radius, stream, nc->outlier.dptr);
         nc->p->reconstruct(nc->anchor.dptr, nc->errctrl.dptr, nc->reconst.dptr, eb, radius, stream, nc->outlier.dptr);
@@ -107,14 +109,16 @@ class BaseCompressor {
     {
         auto len = nc->original.len;
 
-        nc->original.template from_file<cusz::LOC::HOST>(fname).host2device_async(stream);
+        // for r2r, the value range is found as the field is read
+        io::value_range_t<T> range;
+        if (r2r)
+            nc->original.from_file(fname, range);
+        else
+            nc->original.template from_file<cusz::LOC::HOST>(fname);
+        nc->original.host2device_async(stream);
         CHECK_CUDA(cudaStreamSynchronize(stream));
 
-        if (r2r) {
-            double max, min, rng;
-            nc->original.prescan(max, min, rng);
-            eb *= rng;
-        }
+        if (r2r) eb *= range.get_rng();
 
         auto ebx2_r = 1 / (eb * 2);
         auto ebx2   = eb * 2;
@@ -0,0 +1,488 @@
+/**
+ * @file chunked.hh
+ * @author Jiannan Tian
+ * @brief Seekable chunked container: independently compressed bricks, followed by a brick index and a fixed-size
+ * footer at the end of file. Each brick is a self-contained (.cusza) archive.
+ * @version 0.3
+ * @date 2022-03-14
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_CHUNKED_HH
+#define CUSZ_CHUNKED_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "header.hh"
+#include "utils/crc32c.hh"
+#include "utils/io.hh"
+#include "utils/thread_pool.hh"
+
+namespace cusz {
+
+struct ChunkedHelper {
+    static const size_t NSLAB_BUFFER     = 2;  // double-buffered slabs when streaming
+    static const size_t BLOB_QUEUE_DEPTH = 8;  // compressed bricks in flight to the writer, at least
+};
+
+/*
+ * layout of a chunked archive
+ *
+ *   | brick 0 | brick 1 | ... | brick n-1 | index: chunked_brick_t[n] | chunked_footer_t |
+ *
+ * Opening costs one seek to the footer and one read of the index; a brick is then one seek and one read.
+ */
+
+struct chunked_brick_t {
+    uint64_t offset;     // from the beginning of file
+    uint64_t nbyte;      // of the brick archive
+    uint32_t origin[3];  // x, y, z; x is the fastest-varying
+    uint32_t extent[3];
+    uint32_t crc;  // CRC32C of the brick archive, valid if the footer says has_crc
+    uint32_t reserved;
+};
+
+struct chunked_footer_t {
+    static const uint32_t VERSION = 3;  // 2: per-brick CRC32C; 3: CRC32C of the index and the footer
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t nbrick;
+    uint32_t x, y, z;                    // field
+    uint32_t brick_x, brick_y, brick_z;  // nominal brick; those at the far edges can be smaller
+    uint32_t dtype_nbyte;
+    uint32_t has_crc;
+    double   eb;  // absolute, shared by all bricks
+    uint64_t index_offset;
+    uint64_t index_nbyte;
+    uint32_t index_crc;   // CRC32C of the index, regardless of has_crc
+    uint32_t footer_crc;  // CRC32C of the footer up to this field
+
+    static const char* get_magic() { return "CUSZCHK1"; }
+    bool               check_magic() const { return memcmp(magic, get_magic(), 8) == 0; }
+
+    uint32_t get_footer_crc() const { return CRC32C::compute(this, offsetof(chunked_footer_t, footer_crc)); }
+};
+
+/**
+ * @brief Regular tiling of the field into bricks; brick `i` is (bx, by, bz) with `i = (bz * ny + by) * nx + bx`.
+ *
+ */
+struct BrickLayout {
+    static const size_t DEFAULT_SLAB_NBYTE = 256 << 20;  // for streaming without an explicit brick
+
+    dim3_compat field, brick, nbrick;
+
+    BrickLayout() = default;
+    BrickLayout(dim3_compat _field, dim3_compat _brick) : field(_field), brick(_brick)
+    {
+        if (brick.x == 0 or brick.y == 0 or brick.z == 0)
+            throw std::runtime_error("BrickLayout: brick has zero extent.");
+        nbrick.x = (field.x - 1) / brick.x + 1;
+        nbrick.y = (field.y - 1) / brick.y + 1;
+        nbrick.z = (field.z - 1) / brick.z + 1;
+    }
+
+    size_t size() const { return (size_t)nbrick.x * nbrick.y * nbrick.z; }
+
+    /*
+     * Slabs, for streaming: one layer of bricks along the slowest axis that is not degenerate (z, else y, else x).
+     * A slab is a contiguous run of both the raw field file and the brick index.
+     */
+    int get_slab_axis() const { return field.z > 1 ? 2 : (field.y > 1 ? 1 : 0); }
+
+    size_t get_nslab() const
+    {
+        uint32_t nb[3] = {nbrick.x, nbrick.y, nbrick.z};
+        return nb[get_slab_axis()];
+    }
+
+    size_t get_nbrick_per_slab() const { return size() / get_nslab(); }
+
+    size_t get_plane_len() const
+    {
+        uint32_t f[3] = {field.x, field.y, field.z};
+        size_t   len  = 1;
+        for (auto d = 0; d < get_slab_axis(); d++) len *= f[d];
+        return len;
+    }
+
+    void get_slab(size_t s, uint32_t& plane_begin, uint32_t& plane_end) const
+    {
+        uint32_t b[3] = {brick.x, brick.y, brick.z};
+        uint32_t f[3] = {field.x, field.y, field.z};
+        auto     axis = get_slab_axis();
+        plane_begin   = s * b[axis];
+        plane_end     = std::min(f[axis], plane_begin + b[axis]);
+    }
+
+    /**
+     * @brief Brick that spans whole planes, about `slab_nbyte` deep; the depth is rounded down to the Lorenzo block
+     * along the slab axis (8 in 3D, 16 in 2D, 256 in 1D) so that slicing does not split a prediction block.
+     *
+     */
+    static dim3_compat get_slab_brick(dim3_compat field, size_t dtype_nbyte, size_t slab_nbyte)
+    {
+        BrickLayout probe(field, field);
+        auto        axis        = probe.get_slab_axis();
+        auto        plane_nbyte = probe.get_plane_len() * dtype_nbyte;
+        size_t      pblock      = axis == 2 ? 8 : (axis == 1 ? 16 : 256);
+
+        uint32_t f[3]  = {field.x, field.y, field.z};
+        size_t   depth = std::max(slab_nbyte / plane_nbyte / pblock, (size_t)1) * pblock;
+        f[axis]        = std::min((size_t)f[axis], depth);
+        return {f[0], f[1], f[2]};
+    }
+
+    void get_brick(size_t i, uint32_t origin[3], uint32_t extent[3]) const
+    {
+        uint32_t idx[3] = {
+            static_cast<uint32_t>(i % nbrick.x), static_cast<uint32_t>(i / nbrick.x % nbrick.y),
+            static_cast<uint32_t>(i / nbrick.x / nbrick.y)};
+        uint32_t b[3] = {brick.x, brick.y, brick.z};
+        uint32_t f[3] = {field.x, field.y, field.z};
+        for (auto d = 0; d < 3; d++) {
+            origin[d] = idx[d] * b[d];
+            extent[d] = std::min(b[d], f[d] - origin[d]);
+        }
+    }
+};
+
+/**
+ * @brief Copy a box of `extent` from `src` at `src_origin` to `dst` at `dst_origin`; both are dense x-fastest arrays.
+ *
+ */
+template <typename T>
+void copy_box(
+    const T*       src,
+    dim3_compat    src_dims,
+    const uint32_t src_origin[3],
+    T*             dst,
+    dim3_compat    dst_dims,
+    const uint32_t dst_origin[3],
+    const uint32_t extent[3])
+{
+    auto nrow = (size_t)extent[1] * extent[2];
+
+    cusz::ThreadPool::get_default().parallel_for(nrow, [&](size_t begin, size_t end, int) {
+        for (auto r = begin; r < end; r++) {
+            auto y = r % extent[1], z = r / extent[1];
+            auto s = src + ((size_t)(src_origin[2] + z) * src_dims.y + src_origin[1] + y) * src_dims.x + src_origin[0];
+            auto d = dst + ((size_t)(dst_origin[2] + z) * dst_dims.y + dst_origin[1] + y) * dst_dims.x + dst_origin[0];
+            std::copy(s, s + extent[0], d);
+        }
+    });
+}
+
+/**
+ * @brief Read whole planes of a raw field file on demand, so that only a slab is resident at a time.
+ *
+ */
+template <typename T>
+class SlabReader {
+   private:
+    io::PositionalFile file;
+    size_t             plane_len;
+
+   public:
+    SlabReader(const std::string& fname, dim3_compat field, size_t _plane_len, bool direct = false) :
+        file(fname, io::PositionalFile::READ, direct), plane_len(_plane_len)
+    {
+        if (file.size() < sizeof(T) * field.x * field.y * field.z)
+            throw std::runtime_error("SlabReader: " + fname + " is smaller than the specified field.");
+    }
+
+    // a slab is read by parallel positional reads
+    void read(uint32_t plane_begin, uint32_t plane_end, T* out)
+    {
+        file.read(out, sizeof(T) * plane_len * (plane_end - plane_begin), sizeof(T) * plane_len * plane_begin);
+    }
+
+    // and the value range of the slab, found as it is read
+    void read(uint32_t plane_begin, uint32_t plane_end, T* out, io::value_range_t<T>& range)
+    {
+        io::read_with_range(file, out, plane_len * (plane_end - plane_begin), plane_len * plane_begin, range);
+    }
+};
+
+/**
+ * @brief Half-open box [lo, hi) in field coordinates.
+ *
+ */
+struct chunked_region_t {
+    uint32_t lo[3], hi[3];
+
+    dim3_compat get_dims() const { return {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]}; }
+    size_t      get_len() const { return (size_t)(hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]); }
+
+    bool is_valid_in(dim3_compat field) const
+    {
+        uint32_t f[3] = {field.x, field.y, field.z};
+        for (auto d = 0; d < 3; d++)
+            if (lo[d] >= hi[d] or hi[d] > f[d]) return false;
+        return true;
+    }
+
+    /**
+     * @brief Overlap of the brick and this region, as [ov_lo, ov_hi); false if they do not intersect.
+     *
+     */
+    bool intersect(const chunked_brick_t& b, uint32_t ov_lo[3], uint32_t ov_hi[3]) const
+    {
+        for (auto d = 0; d < 3; d++) {
+            ov_lo[d] = std::max(lo[d], b.origin[d]);
+            ov_hi[d] = std::min(hi[d], b.origin[d] + b.extent[d]);
+            if (ov_lo[d] >= ov_hi[d]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Copy the part of a decoded brick that falls in this region into `out`, a dense array of `get_dims()`.
+     *
+     */
+    template <typename T>
+    void copy_from_brick(const T* brick_data, const chunked_brick_t& b, T* out) const
+    {
+        uint32_t ov_lo[3], ov_hi[3];
+        if (not intersect(b, ov_lo, ov_hi)) return;
+
+        uint32_t src_origin[3], dst_origin[3], extent[3];
+        for (auto d = 0; d < 3; d++) {
+            src_origin[d] = ov_lo[d] - b.origin[d];
+            dst_origin[d] = ov_lo[d] - lo[d];
+            extent[d]     = ov_hi[d] - ov_lo[d];
+        }
+        copy_box(brick_data, {b.extent[0], b.extent[1], b.extent[2]}, src_origin, out, get_dims(), dst_origin, extent);
+    }
+};
+
+/**
+ * @brief Write bricks in any order as they become available; index and footer are written at `finalize()`. A writer
+ * destroyed before `finalize()`, e.g., on an error, removes its file rather than leave a partial archive.
+ *
+ */
+class ChunkedArchiveWriter {
+   private:
+    std::string                  fname;
+    std::ofstream                ofs;
+    std::vector<chunked_brick_t> index;
+    chunked_footer_t             footer;
+    uint64_t                     cursor{0};
+    bool                         finalized{false};
+
+   public:
+    /**
+     * @param checksum if set, each brick is sealed (per-segment CRC in its header) and checksummed as a whole as it
+     * is appended; the cost falls on whichever thread appends, typically the write stage
+     */
+    ChunkedArchiveWriter(
+        const std::string& _fname,
+        dim3_compat        field,
+        dim3_compat        brick,
+        int                dtype_nbyte,
+        double             eb,
+        bool               checksum = true) :
+        fname(_fname)
+    {
+        ofs.open(fname.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+        if (not ofs.is_open()) throw std::runtime_error("ChunkedArchiveWriter: fail to open " + fname);
+
+        memset(&footer, 0, sizeof(footer));
+        memcpy(footer.magic, chunked_footer_t::get_magic(), 8);
+        footer.version     = chunked_footer_t::VERSION;
+        footer.x           = field.x;
+        footer.y           = field.y;
+        footer.z           = field.z;
+        footer.brick_x     = brick.x;
+        footer.brick_y     = brick.y;
+        footer.brick_z     = brick.z;
+        footer.dtype_nbyte = dtype_nbyte;
+        footer.eb          = eb;
+        footer.has_crc     = checksum;
+    }
+
+    ~ChunkedArchiveWriter()
+    {
+        if (finalized) return;
+        if (ofs.is_open()) ofs.close();
+        std::remove(fname.c_str());
+    }
+
+    size_t get_nbyte_written() const { return cursor; }
+
+    /**
+     * @param blob brick archive; modified (sealed) in place if checksums are on
+     */
+    void append(const uint32_t origin[3], const uint32_t extent[3], uint8_t* blob, size_t nbyte)
+    {
+        chunked_brick_t b;
+        memset(&b, 0, sizeof(b));
+        b.offset = cursor;
+        b.nbyte  = nbyte;
+        std::copy(origin, origin + 3, b.origin);
+        std::copy(extent, extent + 3, b.extent);
+        if (footer.has_crc) {
+            ArchiveChecksum::seal(blob);
+            b.crc = CRC32C::compute(blob, nbyte);
+        }
+
+        ofs.write(reinterpret_cast<const char*>(blob), nbyte);
+        if (not ofs) throw std::runtime_error("ChunkedArchiveWriter: fail to write brick.");
+
+        cursor += nbyte;
+        index.push_back(b);
+    }
+
+    /**
+     * @brief Write the index and the footer; only a writer that has every brick of the layout can finalize.
+     *
+     */
+    void finalize()
+    {
+        BrickLayout layout({footer.x, footer.y, footer.z}, {footer.brick_x, footer.brick_y, footer.brick_z});
+        if (index.size() != layout.size())
+            throw std::runtime_error(
+                "ChunkedArchiveWriter: " + std::to_string(index.size()) + " of " + std::to_string(layout.size()) +
+                " bricks written.");
+
+        footer.nbrick       = index.size();
+        footer.index_offset = cursor;
+        footer.index_nbyte  = sizeof(chunked_brick_t) * index.size();
+        footer.index_crc    = CRC32C::compute(index.data(), footer.index_nbyte);
+        footer.footer_crc   = footer.get_footer_crc();
+
+        ofs.write(reinterpret_cast<const char*>(index.data()), footer.index_nbyte);
+        ofs.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+        cursor += footer.index_nbyte + sizeof(footer);
+
+        ofs.close();
+        if (ofs.fail()) throw std::runtime_error("ChunkedArchiveWriter: fail to write index.");
+        finalized = true;
+    }
+};
+
+/**
+ * @brief The archive is memory-mapped; a brick is handed out as a pointer into the mapping, without a host copy.
+ *
+ */
+class ChunkedArchiveReader {
+   private:
+    io::MappedFile               file;
+    chunked_footer_t             footer;
+    std::vector<chunked_brick_t> index;
+
+   public:
+    /**
+     * @brief Tell a chunked archive from a monolithic one by the trailing magic.
+     *
+     */
+    static bool is_chunked(const std::string& fname)
+    {
+        std::ifstream f(fname.c_str(), std::ios::binary | std::ios::in | std::ios::ate);
+        if (not f.is_open() or (size_t)f.tellg() < sizeof(chunked_footer_t)) return false;
+
+        chunked_footer_t tail;
+        f.seekg(-(std::streamoff)sizeof(tail), std::ios::end);
+        f.read(reinterpret_cast<char*>(&tail), sizeof(tail));
+        return f and tail.check_magic();
+    }
+
+    explicit ChunkedArchiveReader(const std::string& fname)
+    {
+        io::MappedFile::hint_t hint;
+        hint.sequential = false;  // bricks are visited in any order
+        file.open(fname, hint);
+
+        if (file.size() < sizeof(footer))
+            throw std::runtime_error("ChunkedArchiveReader: " + fname + " is not a chunked archive.");
+        memcpy(&footer, file.as<uint8_t>() + file.size() - sizeof(footer), sizeof(footer));
+        if (not footer.check_magic())
+            throw std::runtime_error("ChunkedArchiveReader: " + fname + " is not a chunked archive.");
+        if (footer.version != chunked_footer_t::VERSION)
+            throw std::runtime_error("ChunkedArchiveReader: unsupported version " + std::to_string(footer.version));
+        if (footer.get_footer_crc() != footer.footer_crc)
+            throw std::runtime_error("ChunkedArchiveReader: footer checksum mismatch.");
+
+        // the index sits right before the footer and holds exactly nbrick entries
+        auto const index_end = file.size() - sizeof(footer);
+        if (footer.index_nbyte != sizeof(chunked_brick_t) * (uint64_t)footer.nbrick or
+            footer.index_offset > index_end or footer.index_nbyte != index_end - footer.index_offset)
+            throw std::runtime_error("ChunkedArchiveReader: index does not match the footer.");
+
+        auto const src = file.as<uint8_t>() + footer.index_offset;
+        if (CRC32C::compute(src, footer.index_nbyte) != footer.index_crc)
+            throw std::runtime_error("ChunkedArchiveReader: index checksum mismatch.");
+
+        index.resize(footer.nbrick);
+        memcpy(index.data(), src, footer.index_nbyte);
+        for (auto const& b : index)
+            if (b.offset > footer.index_offset or b.nbyte > footer.index_offset - b.offset)
+                throw std::runtime_error("ChunkedArchiveReader: brick out of range.");
+    }
+
+    const chunked_footer_t&             get_footer() const { return footer; }
+    const std::vector<chunked_brick_t>& get_index() const { return index; }
+
+    dim3_compat get_field() const { return {footer.x, footer.y, footer.z}; }
+    dim3_compat get_brick() const { return {footer.brick_x, footer.brick_y, footer.brick_z}; }
+
+    chunked_region_t get_whole() const { return {{0, 0, 0}, {footer.x, footer.y, footer.z}}; }
+
+    /**
+     * @brief Indices of the bricks that intersect `region`, in file order.
+     *
+     */
+    std::vector<size_t> query(const chunked_region_t& region) const
+    {
+        if (not region.is_valid_in(get_field()))
+            throw std::runtime_error("ChunkedArchiveReader: region is empty or out of the field.");
+
+        std::vector<size_t> hit;
+        uint32_t            ov_lo[3], ov_hi[3];
+        for (size_t i = 0; i < index.size(); i++)
+            if (region.intersect(index[i], ov_lo, ov_hi)) hit.push_back(i);
+        return hit;
+    }
+
+    /**
+     * @brief Zero-copy access to brick `i`; valid as long as the reader is alive.
+     *
+     */
+    const uint8_t* map_brick(size_t i) const { return file.as<uint8_t>() + index.at(i).offset; }
+
+    /**
+     * @brief Check brick `i` against its CRC; on mismatch, the per-segment CRCs tell which segment is corrupt.
+     *
+     */
+    void verify_brick(size_t i) const
+    {
+        if (not footer.has_crc) return;
+        auto const& b = index.at(i);
+        if (CRC32C::compute(map_brick(i), b.nbyte) == b.crc) return;
+
+        auto note = "brick " + std::to_string(i);
+        ArchiveChecksum::verify(map_brick(i), b.nbyte, note);
+        throw std::runtime_error(note + ": checksum mismatch.");
+    }
+
+    void read_brick(size_t i, std::vector<uint8_t>& blob) const
+    {
+        auto const& b = index.at(i);
+        blob.assign(map_brick(i), map_brick(i) + b.nbyte);
+    }
+};
+
+}  // namespace cusz
+
+#endif
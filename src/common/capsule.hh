@@ -33,6 +33,7 @@
 #include "../utils/io.hh"
 #include "../utils/strhelper.hh"
 #include "../utils/timer.hh"
+#include "../utils/workspace_pool.hh"
 #include "configs.hh"
 #include "definition.hh"
 
@@ -201,6 +202,16 @@ class Capsule {
         return *this;
     }
 
+    // from_file<HOST>() that also finds the value range on the way in, for r2r without a second pass
+    Capsule& from_file(std::string fname, io::value_range_t<T>& range)
+    {
+        if (!hptr) throw std::runtime_error(ERRSTR_BUILDER("from_file", "hptr not set"));
+        if (len == 0) throw std::runtime_error(ERRSTR_BUILDER("from_file", "len == 0"));
+        io::read_binary_to_array<T>(fname, hptr, len, range);
+
+        return *this;
+    }
+
     template <cusz::LOC SRC, cusz::LOC VIA = cusz::LOC::NONE>
     Capsule& to_file(std::string fname)
     {
@@ -281,7 +292,7 @@ class Capsule {
             if (allocation_status.hptr)
                 LOGGING(LOG_WARN, "already allocated on host");
             else {
-                cudaMallocHost(&hptr, __memory_footprint);
+                cusz::WorkspacePool::malloc_host(&hptr, __memory_footprint);
                 cudaMemset(hptr, 0x00, __memory_footprint);
                 allocation_status.hptr = true;
             }
@@ -290,7 +301,7 @@ class Capsule {
             if (allocation_status.dptr)
                 LOGGING(LOG_WARN, "already allocated on device");
             else {
-                cudaMalloc(&dptr, __memory_footprint);
+                cusz::WorkspacePool::malloc(&dptr, __memory_footprint);
                 cudaMemset(dptr, 0x00, __memory_footprint);
                 allocation_status.dptr = true;
             }
@@ -328,13 +339,13 @@ class Capsule {
         auto free_host = [&]() {
             if (!hptr) throw std::runtime_error(ERRSTR_BUILDER("free", "hptr is null"));
 
-            cudaFreeHost(hptr);
+            cusz::WorkspacePool::free_host(hptr);
             allocation_status.hptr = false;
         };
         auto free_device = [&]() {
             if (!dptr) throw std::runtime_error(ERRSTR_BUILDER("free", "dptr is null"));
 
-            cudaFree(dptr);
+            cusz::WorkspacePool::free(dptr);
             allocation_status.dptr = false;
         };
 
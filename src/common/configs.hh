@@ -95,6 +95,13 @@ struct HuffmanHelper {
 
     static const int ENC_SEQUENTIALITY = 4;  // empirical
     static const int DEFLATE_CONSTANT  = 4;  // TODO -> deflate_chunk_constant
+
+    // host (CPU) codec
+    static const int HOST_CHUNK_PER_CORE   = 4;     // empirical, load balance under schedule(dynamic)
+    static const int HOST_MIN_CHUNK_US     = 20;    // per-chunk work to amortize scheduling overhead
+    static const int HOST_META_PERMILLE    = 10;    // par_nbit + par_entry <= 1% of estimated output
+    static const int HOST_SUBLEN_FLOOR     = 4096;  // lower clamp when calibration is unavailable
+    static const int HOST_CALIBRATION_SIZE = 1 << 18;
 };
 
 struct StringHelper {
@@ -0,0 +1,281 @@
+/**
+ * @file container.hh
+ * @author Jiannan Tian
+ * @brief Multi-field container: many compressed fields (e.g., all variables of a snapshot) in one file, with a
+ * directory at the end of file for lookup by name.
+ * @version 0.3
+ * @date 2022-03-16
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_CONTAINER_HH
+#define CUSZ_CONTAINER_HH
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils/crc32c.hh"
+#include "utils/io.hh"
+
+namespace cusz {
+
+/*
+ * layout of a container
+ *
+ *   | field 0 (.cusza) | field 1 | ... | field n-1 | directory: container_entry_t[n] | container_footer_t |
+ *
+ * Fields can be appended by later runs: new fields go after the old footer, which is never overwritten, and a new
+ * directory (old entries plus the new ones) and footer follow them. The old directory and footer stay behind as a few
+ * dead bytes; until the new footer is written, truncating the file to its old size gives back the old container.
+ */
+
+struct container_entry_t {
+    static const size_t NAME_LEN = 64;
+
+    char     name[NAME_LEN];  // null-terminated
+    uint64_t offset;          // from the beginning of file
+    uint64_t nbyte;
+    uint32_t x, y, z;
+    uint32_t dtype_nbyte;
+    double   eb;   // absolute
+    uint32_t crc;  // CRC32C of the field archive, valid if has_crc
+    uint32_t has_crc;
+    uint32_t reserved[2];
+
+    std::string get_name() const { return std::string(name, strnlen(name, NAME_LEN)); }
+};
+
+struct container_footer_t {
+    static const uint32_t VERSION = 1;
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t nfield;
+    uint64_t dir_offset;
+    uint64_t dir_nbyte;
+
+    static const char* get_magic() { return "CUSZMFC1"; }
+    bool               check_magic() const { return memcmp(magic, get_magic(), 8) == 0; }
+
+    // the directory holds exactly nfield entries and ends right at the footer of a file of `file_nbyte`
+    bool check_directory(uint64_t file_nbyte) const
+    {
+        if (file_nbyte < sizeof(container_footer_t)) return false;
+        auto const dir_end = file_nbyte - sizeof(container_footer_t);
+        return dir_nbyte == sizeof(container_entry_t) * (uint64_t)nfield and dir_offset <= dir_end and
+               dir_nbyte == dir_end - dir_offset;
+    }
+
+    // a field lies before the directory
+    bool check_entry(const container_entry_t& e) const
+    {
+        return e.offset <= dir_offset and e.nbyte <= dir_offset - e.offset;
+    }
+};
+
+/**
+ * @brief Add fields, then `finalize()` to write the directory. A writer destroyed before `finalize()`, e.g., on an
+ * error, rolls the file back: an appended container is truncated to its old size, a new one is removed.
+ *
+ */
+class ContainerWriter {
+   private:
+    std::string                    fname;
+    std::fstream                   fs;
+    std::vector<container_entry_t> dir;
+    uint64_t                       cursor{0};
+    uint64_t                       old_nbyte{0};  // of the container appended to; 0 for a new one
+    bool                           finalized{false};
+
+    static bool load_directory(const std::string& fname, std::vector<container_entry_t>& dir, uint64_t& file_nbyte)
+    {
+        std::ifstream f(fname.c_str(), std::ios::binary | std::ios::in | std::ios::ate);
+        if (not f.is_open() or (size_t)f.tellg() < sizeof(container_footer_t)) return false;
+        file_nbyte = f.tellg();
+
+        container_footer_t footer;
+        f.seekg(-(std::streamoff)sizeof(footer), std::ios::end);
+        f.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+        if (not f or not footer.check_magic()) return false;
+        if (footer.version > container_footer_t::VERSION)
+            throw std::runtime_error("ContainerWriter: unsupported version " + std::to_string(footer.version));
+        if (not footer.check_directory(file_nbyte))
+            throw std::runtime_error("ContainerWriter: directory does not match the footer in " + fname);
+
+        dir.resize(footer.nfield);
+        f.seekg(footer.dir_offset);
+        f.read(reinterpret_cast<char*>(dir.data()), footer.dir_nbyte);
+        if (not f) throw std::runtime_error("ContainerWriter: truncated directory in " + fname);
+        return true;
+    }
+
+   public:
+    /**
+     * @param append keep the fields of an existing container; otherwise (or if it is not a container) start over
+     */
+    ContainerWriter(const std::string& _fname, bool append = true) : fname(_fname)
+    {
+        if (append and load_directory(fname, dir, old_nbyte))
+            fs.open(fname.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        else
+            old_nbyte = 0, fs.open(fname.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+        if (not fs.is_open()) throw std::runtime_error("ContainerWriter: fail to open " + fname);
+        cursor = old_nbyte;
+        fs.seekp(cursor);
+    }
+
+    ~ContainerWriter()
+    {
+        if (finalized) return;
+        if (fs.is_open()) fs.close();
+        if (old_nbyte == 0)
+            std::remove(fname.c_str());
+        else if (truncate(fname.c_str(), old_nbyte) != 0)
+            fprintf(stderr, "ContainerWriter: fail to roll %s back to its old size.\n", fname.c_str());
+    }
+
+    const std::vector<container_entry_t>& get_directory() const { return dir; }
+
+    void add(
+        const std::string& name,
+        uint32_t           x,
+        uint32_t           y,
+        uint32_t           z,
+        uint32_t           dtype_nbyte,
+        double             eb,
+        uint8_t*           blob,
+        size_t             nbyte,
+        bool               checksum = true)
+    {
+        if (name.empty() or name.size() >= container_entry_t::NAME_LEN)
+            throw std::runtime_error("ContainerWriter: field name must be 1 to 63 characters: " + name);
+        for (auto const& e : dir)
+            if (e.get_name() == name) throw std::runtime_error("ContainerWriter: duplicate field " + name);
+
+        container_entry_t e;
+        memset(&e, 0, sizeof(e));
+        memcpy(e.name, name.c_str(), name.size());
+        e.offset      = cursor;
+        e.nbyte       = nbyte;
+        e.x           = x;
+        e.y           = y;
+        e.z           = z;
+        e.dtype_nbyte = dtype_nbyte;
+        e.eb          = eb;
+        if (checksum) {  // blob is sealed in place: per-segment CRC in its header
+            ArchiveChecksum::seal(blob);
+            e.crc     = CRC32C::compute(blob, nbyte);
+            e.has_crc = 1;
+        }
+
+        fs.write(reinterpret_cast<const char*>(blob), nbyte);
+        if (not fs) throw std::runtime_error("ContainerWriter: fail to write field " + name);
+
+        cursor += nbyte;
+        dir.push_back(e);
+    }
+
+    void finalize()
+    {
+        container_footer_t footer;
+        memset(&footer, 0, sizeof(footer));
+        memcpy(footer.magic, container_footer_t::get_magic(), 8);
+        footer.version    = container_footer_t::VERSION;
+        footer.nfield     = dir.size();
+        footer.dir_offset = cursor;
+        footer.dir_nbyte  = sizeof(container_entry_t) * dir.size();
+
+        fs.write(reinterpret_cast<const char*>(dir.data()), footer.dir_nbyte);
+        fs.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+        fs.close();
+        if (fs.fail()) throw std::runtime_error("ContainerWriter: fail to write directory.");
+        finalized = true;
+    }
+};
+
+/**
+ * @brief The container is memory-mapped; looking up a field reads the directory only, and a field is handed out as
+ * a pointer into the mapping, leaving other fields untouched.
+ *
+ */
+class ContainerReader {
+   private:
+    io::MappedFile                 file;
+    container_footer_t             footer;
+    std::vector<container_entry_t> dir;
+
+   public:
+    static bool is_container(const std::string& fname)
+    {
+        std::ifstream f(fname.c_str(), std::ios::binary | std::ios::in | std::ios::ate);
+        if (not f.is_open() or (size_t)f.tellg() < sizeof(container_footer_t)) return false;
+
+        container_footer_t tail;
+        f.seekg(-(std::streamoff)sizeof(tail), std::ios::end);
+        f.read(reinterpret_cast<char*>(&tail), sizeof(tail));
+        return f and tail.check_magic();
+    }
+
+    explicit ContainerReader(const std::string& fname)
+    {
+        io::MappedFile::hint_t hint;
+        hint.sequential = false;
+        file.open(fname, hint);
+
+        if (file.size() < sizeof(footer))
+            throw std::runtime_error("ContainerReader: " + fname + " is not a container.");
+        memcpy(&footer, file.as<uint8_t>() + file.size() - sizeof(footer), sizeof(footer));
+        if (not footer.check_magic()) throw std::runtime_error("ContainerReader: " + fname + " is not a container.");
+        if (footer.version > container_footer_t::VERSION)
+            throw std::runtime_error("ContainerReader: unsupported version " + std::to_string(footer.version));
+        if (not footer.check_directory(file.size()))
+            throw std::runtime_error("ContainerReader: directory does not match the footer.");
+
+        dir.resize(footer.nfield);
+        memcpy(dir.data(), file.as<uint8_t>() + footer.dir_offset, footer.dir_nbyte);
+        for (auto const& e : dir)
+            if (not footer.check_entry(e)) throw std::runtime_error("ContainerReader: field out of range.");
+    }
+
+    const std::vector<container_entry_t>& get_directory() const { return dir; }
+
+    const container_entry_t& find(const std::string& name) const
+    {
+        for (auto const& e : dir)
+            if (e.get_name() == name) return e;
+        throw std::runtime_error("ContainerReader: no field named " + name);
+    }
+
+    bool has(const std::string& name) const
+    {
+        for (auto const& e : dir)
+            if (e.get_name() == name) return true;
+        return false;
+    }
+
+    /**
+     * @brief Zero-copy access to a field archive; valid as long as the reader is alive.
+     *
+     */
+    const uint8_t* map(const container_entry_t& e) const { return file.as<uint8_t>() + e.offset; }
+    const uint8_t* map(const std::string& name) const { return map(find(name)); }
+
+    void verify(const container_entry_t& e) const
+    {
+        if (not e.has_crc or CRC32C::compute(map(e), e.nbyte) == e.crc) return;
+        ArchiveChecksum::verify(map(e), e.nbyte, e.get_name());
+        throw std::runtime_error(e.get_name() + ": checksum mismatch.");
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -122,6 +122,25 @@ void set_config(cuszCTX* ctx, const char* in_str)
         else if (kv.first == "gpuverify" && (kv.second == "on" || kv.second == "ON")) {
             ctx->on_off.use_gpu_verify = true;
         }
+        else if (kv.first == "checksum" && (kv.second == "off" || kv.second == "OFF")) {
+            ctx->on_off.checksum = false;
+        }
+        else if (kv.first == "container") {
+            ctx->fname.container = string(kv.second);
+        }
+        else if (kv.first == "streaming" && (kv.second == "on" || kv.second == "ON")) {
+            ctx->on_off.streaming = true;
+        }
+        else if (kv.first == "rangepass" && (kv.second == "on" || kv.second == "ON")) {
+            ctx->on_off.range_pass = true;
+        }
+        else if (kv.first == "brick") {
+            std::vector<string> dims;
+            ConfigHelper::parse_length_literal(kv.second.c_str(), dims);
+            ctx->brick.x = StrHelper::str2int(dims[0].c_str());
+            if (dims.size() >= 2) ctx->brick.y = StrHelper::str2int(dims[1].c_str());
+            if (dims.size() >= 3) ctx->brick.z = StrHelper::str2int(dims[2].c_str());
+        }
 
         // when to enable anchor
         if (ctx->str_predictor == "spline3") ctx->on_off.use_anchor = true;
@@ -288,6 +307,10 @@ cuszCTX::cuszCTX(int argc, char** argv)
                             this->opath = string(argv[++i]);  // TODO does !apply for preprocessed such as binning
                         break;
                     }
+                    if (long_opt == "--mem-limit") {
+                        if (i + 1 <= argc) mem_limit = StrHelper::str2nbyte(argv[++i]);
+                        break;
+                    }
                     if (long_opt == "--origin" || long_opt == "--compare") {
                         if (i + 1 <= argc) fname.origin_cmp = string(argv[++i]);
                         break;
@@ -518,6 +541,10 @@ cuszCTX::cuszCTX(const char* config_str, bool dbg_print)
         // decompress
         if (k == "origin" || k == "compare") { fname.origin_cmp = string(v); }
 
+        // optional
+        // compress/decompress; field named by the input basename
+        if (k == "container") { fname.container = string(v); }
+
         // future use
         /*
         if (k == "predictor" && ConfigHelper::check_predictor(v, true)) {
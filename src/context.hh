@@ -39,13 +39,13 @@ class cuszCTX {
     struct { bool binning{false}, logtransform{false}, prescan{false}; } preprocess;
     struct { bool gpu_nvcomp_cascade{false}, cpu_gzip{false}; } postcompress;
 
-    struct { bool use_demo{false}, use_anchor{false}, autotune_vle_pardeg{true}, release_input{false}, use_gpu_verify{false}; } on_off;
+    struct { bool use_demo{false}, use_anchor{false}, autotune_vle_pardeg{true}, release_input{false}, use_gpu_verify{false}, streaming{false}, range_pass{false}, checksum{true}; } on_off;
     struct { bool write2disk{false}, huffman{false}; } to_skip;
     struct { bool book{false}, quant{false}; } export_raw;
     struct { bool time{false}, cr{false}, compressibility{false}, dataseg{false}; } report;
 
     // filenames
-    struct { string fname, origin_cmp, path_basename, basename, compress_output; } fname;
+    struct { string fname, origin_cmp, path_basename, basename, compress_output, container; } fname;
     // clang-format on
 
     // sparsity related: init_nnz when setting up SpReducer
@@ -90,6 +90,14 @@ class cuszCTX {
     double eb{0.0};
     int    dict_size{1024}, radius{512};
 
+    // chunked archive; no bricking if x == 0
+    struct { unsigned int x{0}, y{1}, z{1}; } brick;
+
+    bool use_chunked() const { return brick.x != 0; }
+
+    // device and host memory cap in bytes for the compression planner; 0 for none
+    size_t mem_limit{0};
+
     void load_demo_sizes();
 
    private:
@@ -19,6 +19,7 @@
 #include "binding.hh"
 #include "header.hh"
 #include "wrapper.hh"
+#include "utils/workspace_pool.hh"
 #include "wrapper/spgs.cuh"
 
 #define DEFINE_DEV(VAR, TYPE) TYPE* d_##VAR{nullptr};
@@ -97,8 +98,9 @@ class DefaultPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR>
     {
         if (spreducer) delete spreducer;
         if (codec) delete codec;
-        if (fb_codec) delete codec;
+        if (fb_codec) delete fb_codec;
         if (predictor) delete predictor;
+        if (d_reserved_compressed) cusz::WorkspacePool::free(d_reserved_compressed);
     }
 
     DefaultPathCompressor& compress(bool optional_release_input = false);
@@ -161,7 +163,7 @@ class DefaultPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR>
         };
 
         allocate_predictor(), allocate_spreducer(), allocate_codec();
-        CHECK_CUDA(cudaMalloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
+        CHECK_CUDA(cusz::WorkspacePool::malloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
     }
 
     template <class CONFIG>
@@ -193,7 +195,7 @@ class DefaultPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR>
         };
 
         allocate_predictor(), allocate_spreducer(), allocate_codec();
-        CHECK_CUDA(cudaMalloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
+        CHECK_CUDA(cusz::WorkspacePool::malloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
     }
 
     void try_report_compression(size_t compressed_len)
@@ -377,6 +379,7 @@ class DefaultPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR>
             header.vle_pardeg = pardeg;
             header.eb         = eb;
             header.byte_vle   = use_fallback_codec ? 8 : 4;
+            header.has_crc    = 0;  // sealed on host when written out
         };
 
         auto subfile_collect = [&]() {
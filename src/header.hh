@@ -45,8 +45,10 @@ typedef struct alignas(128) header_t {
     size_t   data_len;
     size_t   errctrl_len;
     uint32_t radius : 16;
+    uint32_t has_crc : 1;
 
     uint32_t entry[END + 1];
+    uint32_t crc[END];  // CRC32C per segment, valid if has_crc; see ArchiveChecksum
 
     uint32_t file_size() const { return entry[END]; }
     size_t   get_uncompressed_len() const { return x * y * z; }
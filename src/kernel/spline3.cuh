@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <type_traits>
 
+#include "spline3_level.cuh"
+
 #define SPLINE3_COMPR true
 #define SPLINE3_DECOMPR false
 
@@ -97,7 +99,11 @@ __global__ void x_spline3d_infprecis_32x8x8data(
     STRIDE3 data_leap,     //
     FP      eb_r,
     FP      ebx2,
-    int     radius);
+    int     radius,
+    int     nlevel = Spline3Level::NLEVEL);
+
+template <typename E, bool SPLIT>
+__global__ void spline3_errctrl_relayout(E* dense, DIM3 size_aligned, E* level_major, int level, size_t len);
 
 namespace device_api {
 /********************************************************************************
@@ -115,7 +121,8 @@ __device__ void spline3d_layout2_interpolate(
     volatile T2 shm_errctrl[9][9][33],
     FP          eb_r,
     FP          ebx2,
-    int         radius);
+    int         radius,
+    int         nlevel = Spline3Level::NLEVEL);
 }  // namespace device_api
 
 }  // namespace cusz
@@ -323,6 +330,32 @@ shmem2global_32x8x8data(volatile Output shm_data[9][9][33], Output* data, DIM3 d
     __syncthreads();
 }
 
+// write the stride-`stride` subsampling of the block; `data_size` is the size of the subsampled (preview) field
+template <typename Output, int LINEAR_BLOCK_SIZE = 256>
+__device__ void shmem2global_32x8x8data_strided(
+    volatile Output shm_data[9][9][33],
+    Output*         data,
+    DIM3            data_size,
+    STRIDE3         data_leap,
+    int             stride)
+{
+    auto const NX = 32 / stride, NY = 8 / stride, NZ = 8 / stride, TOTAL = NX * NY * NZ;
+
+    for (auto _tix = TIX; _tix < TOTAL; _tix += LINEAR_BLOCK_SIZE) {
+        auto x   = (_tix % NX);
+        auto y   = (_tix / NX) % NY;
+        auto z   = (_tix / NX) / NY;
+        auto gx  = (x + BIX * NX);
+        auto gy  = (y + BIY * NY);
+        auto gz  = (z + BIZ * NZ);
+        auto gid = gx + gy * data_leap.y + gz * data_leap.z;
+
+        if (gx < data_size.x && gy < data_size.y && gz < data_size.z)
+            data[gid] = shm_data[z * stride][y * stride][x * stride];
+    }
+    __syncthreads();
+}
+
 template <
     typename T1,
     typename T2,
@@ -425,7 +458,8 @@ __device__ void cusz::device_api::spline3d_layout2_interpolate(
     volatile T2 shm_errctrl[9][9][33],
     FP          eb_r,
     FP          ebx2,
-    int         radius)
+    int         radius,
+    int         nlevel)
 {
     auto xblue = [] __device__(int _tix, int unit) -> int { return unit * (_tix * 2); };
     auto yblue = [] __device__(int _tiy, int unit) -> int { return unit * (_tiy * 2); };
@@ -444,6 +478,8 @@ __device__ void cusz::device_api::spline3d_layout2_interpolate(
     constexpr auto BORDER_INCLUSIVE = true;
     constexpr auto BORDER_EXCLUSIVE = false;
 
+    if (nlevel < 1) return;
+
     int unit = 4;
 
     // iteration 1
@@ -460,6 +496,9 @@ __device__ void cusz::device_api::spline3d_layout2_interpolate(
         false, false, true, LINEAR_BLOCK_SIZE, 9, 1, NO_COARSEN, 3, BORDER_INCLUSIVE, WORKFLOW>(
         shm_data, shm_errctrl, xhollow, yhollow, zhollow, unit, eb_r, ebx2, radius);
 
+    // progressive decompression stops here; block-uniform, no thread is left at a barrier
+    if (nlevel < 2) return;
+
     unit = 2;
 
     // iteration 2, TODO switch y-z order
@@ -476,6 +515,8 @@ __device__ void cusz::device_api::spline3d_layout2_interpolate(
         false, false, true, LINEAR_BLOCK_SIZE, 17, 2, NO_COARSEN, 5, BORDER_INCLUSIVE, WORKFLOW>(
         shm_data, shm_errctrl, xhollow, yhollow, zhollow, unit, eb_r, ebx2, radius);
 
+    if (nlevel < 3) return;
+
     unit = 1;
 
     // iteration 3
@@ -573,7 +614,8 @@ __global__ void cusz::x_spline3d_infprecis_32x8x8data(
     STRIDE3 data_leap,     //
     FP      eb_r,
     FP      ebx2,
-    int     radius)
+    int     radius,
+    int     nlevel)
 {
     // compile time variables
     using E = typename std::remove_pointer<EITER>::type;
@@ -587,8 +629,34 @@ __global__ void cusz::x_spline3d_infprecis_32x8x8data(
     x_reset_scratch_33x9x9data<T, E, LINEAR_BLOCK_SIZE>(shmem.data, shmem.errctrl, anchor, anchor_size, anchor_leap);
     global2shmem_33x9x9data<E, LINEAR_BLOCK_SIZE>(errctrl, errctrl_size, errctrl_leap, shmem.errctrl);
     cusz::device_api::spline3d_layout2_interpolate<T, E, FP, LINEAR_BLOCK_SIZE, SPLINE3_DECOMPR, false>(
-        shmem.data, shmem.errctrl, eb_r, ebx2, radius);
-    shmem2global_32x8x8data<T, LINEAR_BLOCK_SIZE>(shmem.data, data, data_size, data_leap);
+        shmem.data, shmem.errctrl, eb_r, ebx2, radius, nlevel);
+
+    if (nlevel == Spline3Level::NLEVEL)
+        shmem2global_32x8x8data<T, LINEAR_BLOCK_SIZE>(shmem.data, data, data_size, data_leap);
+    else  // a preview: only the points decoded so far, each within the error bound
+        shmem2global_32x8x8data_strided<T, LINEAR_BLOCK_SIZE>(
+            shmem.data, data, data_size, data_leap, Spline3Level::get_stride(nlevel));
+}
+
+/**
+ * @brief Gather (SPLIT) the codes of one level from the dense, aligned layout into its level-major segment, or
+ * scatter them back; one thread per code of that level.
+ */
+template <typename E, bool SPLIT>
+__global__ void
+cusz::spline3_errctrl_relayout(E* dense, DIM3 size_aligned, E* level_major, int level, size_t len)
+{
+    size_t rank = (size_t)BIX * BDX + TIX;
+    if (rank >= len) return;
+
+    unsigned int x, y, z;
+    Spline3Level::get_coord(level, rank, size_aligned.x, size_aligned.y, size_aligned.z, x, y, z);
+    auto id = x + (size_t)y * size_aligned.x + (size_t)z * size_aligned.x * size_aligned.y;
+
+    if CONSTEXPR (SPLIT)
+        level_major[rank] = dense[id];
+    else
+        dense[id] = level_major[rank];
 }
 
 #undef TIX
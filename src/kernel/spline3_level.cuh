@@ -0,0 +1,114 @@
+/**
+ * @file spline3_level.cuh
+ * @author Jiannan Tian
+ * @brief Level-major layout of the Spline3 error-control codes, for progressive (coarse-to-fine) decompression.
+ * @version 0.3
+ * @date 2022-03-17
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_KERNEL_SPLINE3_LEVEL_CUH
+#define CUSZ_KERNEL_SPLINE3_LEVEL_CUH
+
+#include <stddef.h>
+
+#ifndef __CUDACC__
+#define __device__
+#define __host__
+#define __forceinline__
+#endif
+
+namespace cusz {
+
+/*
+ * Spline3 reconstructs a 32x8x8 block from the anchors (stride 8, level 0) through three interpolation levels of
+ * unit 4, 2 and 1; the points decoded at level l lie on the stride-(8 >> l) grid but not on the coarser one.
+ *
+ * In the level-major layout, the codes of level l are contiguous, split in 7 parity classes of the stride-(8 >> l)
+ * grid coordinates (odd x; odd y; odd x and y; ...), each in row-major order. Coordinates are on the aligned field,
+ * whose dims are multiples of 8.
+ */
+struct Spline3Level {
+    static const int NLEVEL = 3;  // anchors excluded
+
+    __host__ __device__ static unsigned int get_stride(int level) { return 8u >> level; }
+
+    __host__ __device__ static int get_level(unsigned int x, unsigned int y, unsigned int z)
+    {
+        auto m = x | y | z;
+        return m % 8 == 0 ? 0 : m % 4 == 0 ? 1 : m % 2 == 0 ? 2 : 3;
+    }
+
+    /**
+     * @brief number of points up to and including `level`
+     */
+    __host__ __device__ static size_t get_grid_len(int level, unsigned int X, unsigned int Y, unsigned int Z)
+    {
+        auto s = get_stride(level);
+        return (size_t)(X / s) * (Y / s) * (Z / s);
+    }
+
+    __host__ __device__ static size_t get_len(int level, unsigned int X, unsigned int Y, unsigned int Z)
+    {
+        return level == 0 ? get_grid_len(0, X, Y, Z) : get_grid_len(level, X, Y, Z) - get_grid_len(level - 1, X, Y, Z);
+    }
+
+    __host__ __device__ static size_t
+    get_rank(unsigned int x, unsigned int y, unsigned int z, unsigned int X, unsigned int Y, unsigned int Z)
+    {
+        auto level = get_level(x, y, z);
+        auto s     = get_stride(level);
+        auto i = x / s, j = y / s, k = z / s;
+        if (level == 0) return i + (size_t)j * (X / 8) + (size_t)k * (X / 8) * (Y / 8);
+
+        auto   hx = X / (2 * s), hy = Y / (2 * s), hz = Z / (2 * s);
+        size_t parity = (i & 1) + ((j & 1) << 1) + ((k & 1) << 2);  // 1 to 7
+        return (parity - 1) * hx * hy * hz + (i >> 1) + (size_t)(j >> 1) * hx + (size_t)(k >> 1) * hx * hy;
+    }
+
+    __host__ __device__ static void get_coord(
+        int           level,
+        size_t        rank,
+        unsigned int  X,
+        unsigned int  Y,
+        unsigned int  Z,
+        unsigned int& x,
+        unsigned int& y,
+        unsigned int& z)
+    {
+        auto s = get_stride(level);
+        if (level == 0) {
+            x = rank % (X / 8) * 8, y = rank / (X / 8) % (Y / 8) * 8, z = rank / (X / 8) / (Y / 8) * 8;
+            return;
+        }
+
+        size_t hx = X / (2 * s), hy = Y / (2 * s), hz = Z / (2 * s);
+        auto   parity = rank / (hx * hy * hz) + 1;
+        auto   r      = rank % (hx * hy * hz);
+        x             = ((r % hx) * 2 + (parity & 1)) * s;
+        y             = ((r / hx % hy) * 2 + ((parity >> 1) & 1)) * s;
+        z             = ((r / hx / hy) * 2 + ((parity >> 2) & 1)) * s;
+    }
+
+    /**
+     * @brief dims of the preview decoded up to `level`: the stride-(8 >> level) subsampling of the original field
+     */
+    __host__ __device__ static void get_preview_dims(
+        int           level,
+        unsigned int  dimx,
+        unsigned int  dimy,
+        unsigned int  dimz,
+        unsigned int& x,
+        unsigned int& y,
+        unsigned int& z)
+    {
+        auto s = get_stride(level);
+        x = (dimx - 1) / s + 1, y = (dimy - 1) / s + 1, z = (dimz - 1) / s + 1;
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -34,7 +34,8 @@ const size_t DICT_SIZE = 1024;
 int main(int argc, char** argv)
 {
     std::string eb_mode, dataset, datum_path;
-    bool        if_blocking, if_dualquant;
+    bool        if_blocking, if_dualquant, if_lowmem{false}, if_graph{false};
+    auto        placement = cusz::NumaHelper::FIRST_TOUCH;
     double      mantissa, exponent;
 
 #if defined(_1D)
@@ -45,9 +46,9 @@ int main(int argc, char** argv)
     cout << "\e[46mThis program is working for 3D datasets.\e[0m" << endl;
 #endif
 
-    if (argc != 8) {
+    if (argc < 8) {
         cout << "./<program> <abs|rel2range OR r2r> <mantissa> <exponent> <if blocking> <if dualquant> <dataset> "
-                "<datum_path path>"
+                "<datum_path path> [lowmem] [graph] [pin] [interleave|serial]"
              << endl;
         cout << "supported dimension and datasets" << endl;
         cout << "\t1D\t./psz1d r2r 1.23 -4.56 <noblk|yesblk> <nodq|dq> <hacc> /path/to/vx.f32" << endl;
@@ -65,6 +66,17 @@ int main(int argc, char** argv)
         if_dualquant = std::string(argv[5]) == "dq";
         dataset      = std::string(argv[6]);
         datum_path   = std::string(argv[7]);
+        for (auto i = 8; i < argc; i++) {
+            std::string opt(argv[i]);
+            if (opt == "lowmem") if_lowmem = true;
+            if (opt == "graph") if_lowmem = true, if_graph = true;  // the lowmem stages as a task graph, traced
+            if (opt == "pin") {
+                auto npinned = cusz::NumaHelper::pin_threads();  // the pool workers place the pages and compute
+                cout << "pinned " << npinned << " pool workers" << endl;
+            }
+            if (opt == "interleave") placement = cusz::NumaHelper::INTERLEAVE;
+            if (opt == "serial") placement = cusz::NumaHelper::SERIAL;  // as before, for comparison
+        }
     }
 
     for_each(argv, argv + 8, [](auto i) { cout << i << " "; });
@@ -73,15 +85,26 @@ int main(int argc, char** argv)
     auto dims_L16  = InitializeDemoDims(dataset, DICT_SIZE);
     printf("%-20s%s\n", "filename", datum_path.c_str());
     printf("%-20s%lu\n", "filesize", dims_L16[LEN] * sizeof(float));
-    if (eb_mode == "r2r") {  // as of C++ 14, string is directly comparable?
-        double value_range = GetDatumValueRange<float>(datum_path, dims_L16[LEN]);
-        eb_config->ChangeToRelativeMode(value_range);
-    }
     eb_config->debug();
     //    size_t c_byteSize;
     size_t num_outlier = 0;  // for calculating compression ratio
 
     // cout << "block size:\t" << BLK << endl;
     auto ebs_L4 = InitializeErrorBoundFamily(eb_config);
-    fm::cx_sim<float, int>(datum_path, dims_L16, ebs_L4, num_outlier, if_dualquant, if_blocking, true);
+
+    // r2r: the value range is found as the workflow reads the field, rather than by reading the file once more
+    fm::r2r_fn to_r2r = nullptr;
+    if (eb_mode == "r2r")
+        to_r2r = [&](double value_range) {
+            eb_config->ChangeToRelativeMode(value_range);
+            eb_config->debug();
+            ebs_L4 = InitializeErrorBoundFamily(eb_config);
+            return ebs_L4;
+        };
+
+    if (if_lowmem)  // in place, dual-quant with blocking; verified against the file
+        fm::cx_lowmem<float>(datum_path, dims_L16, ebs_L4, true, placement, if_graph, to_r2r);
+    else
+        fm::cx_sim<float, int>(
+            datum_path, dims_L16, ebs_L4, num_outlier, if_dualquant, if_blocking, true, placement, to_r2r);
 }
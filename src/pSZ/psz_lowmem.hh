@@ -0,0 +1,832 @@
+#ifndef PSZ_LOWMEM_HH
+#define PSZ_LOWMEM_HH
+
+/**
+ * @file psz_lowmem.hh
+ * @author Jiannan Tian
+ * @brief Host (CPU) dual-quant Lorenzo + Huffman pipeline with a small memory footprint: quant-codes overwrite the
+ * consumed input, or are regenerated slab by slab, and are encoded one slab per Huffman chunk.
+ * @version 0.3
+ * @date 2022-03-19
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <mutex>
+
+#include "../common/types.hh"
+#include "../utils/autotune_cpu.hh"
+#include "../utils/task_graph.hh"
+#include "../utils/thread_pool.hh"
+#include "../utils/timer.hh"
+#include "../wrapper/huffman_coarse_cpu.hh"
+
+namespace psz {
+namespace lowmem {
+
+/**
+ * @brief Archive layout. The field is cut into slabs of whole Lorenzo blocks along its slowest axis; slab s is
+ * chunk s of the Huffman subfile, and its outliers are indexed from the start of the slab.
+ */
+struct header_t {
+    static const int HEADER      = 0;
+    static const int NOUTLIER    = 1;  // uint32 per slab
+    static const int OUTLIER_IDX = 2;  // uint32, offset in the slab
+    static const int OUTLIER_VAL = 3;  // prequantized value
+    static const int VLE         = 4;  // cpu::HuffmanCoarse subfile
+    static const int END         = 5;
+
+    uint32_t dims[3];
+    uint32_t ndim;
+    uint32_t block[3];  // Lorenzo block, as the GPU kernels use
+    uint32_t slab_nblk;  // blocks per slab along the slowest axis
+    uint32_t nslab;
+    int32_t  radius;
+    uint32_t vle_word_nbyte;  // Huffman word, 8 bytes if a codeword does not fit the narrower one
+    double   eb;              // absolute
+    uint64_t entry[END + 1];
+
+    size_t get_len() const { return (size_t)dims[0] * dims[1] * dims[2]; }
+    size_t file_size() const { return entry[END]; }
+
+    size_t get_plane_len() const
+    {
+        size_t n = 1;
+        for (auto d = 0u; d < ndim - 1; d++) n *= dims[d];
+        return n;
+    }
+
+    // [begin, end) along the slowest axis
+    void get_slab(uint32_t s, uint32_t& begin, uint32_t& end) const
+    {
+        auto h = slab_nblk * block[ndim - 1];
+        begin  = s * h;
+        end    = std::min(begin + h, dims[ndim - 1]);
+    }
+
+    size_t get_slab_offset(uint32_t s) const
+    {
+        uint32_t begin, end;
+        get_slab(s, begin, end);
+        return get_plane_len() * begin;
+    }
+
+    size_t get_slab_len(uint32_t s) const
+    {
+        uint32_t begin, end;
+        get_slab(s, begin, end);
+        return get_plane_len() * (end - begin);
+    }
+};
+
+static_assert(sizeof(header_t) <= 128, "the header segment takes 128 bytes");
+
+/**
+ * @brief Compress a host field while holding little more than the field itself.
+ *
+ * The histogram pass predicts and quantizes (dual-quant, as `psz::dualquant`, in the GPU Lorenzo blocks) a few slabs
+ * at a time, one per thread. In place, the slab codes are then copied over the front of the input, which those slabs
+ * have finished reading; otherwise they are dropped and regenerated for encoding. Each slab is deflated on its own as
+ * one Huffman chunk. Beyond the input, this holds a slab of codes per thread, the outliers and the archive.
+ *
+ * @tparam Data input type
+ * @tparam E quant-code type, no wider than Data
+ * @tparam H Huffman word type; 8-byte words are taken instead if a codeword does not fit, as on GPU
+ */
+template <typename Data = float, typename E = uint16_t, typename H = uint32_t>
+class Compressor {
+   public:
+    using BYTE = uint8_t;
+    template <typename W>
+    using CodecOf   = cusz::cpu::HuffmanCoarse<E, W>;
+    using Codec     = CodecOf<H>;
+    using WideCodec = CodecOf<uint64_t>;
+
+    // called concurrently for different ranges; fills `out` with `len` original values from `offset`
+    using reference_fn = std::function<void(size_t offset, size_t len, Data* out)>;
+
+    static_assert(sizeof(E) <= sizeof(Data), "codes are written over the input in place");
+
+   private:
+    header_t header;
+    double   ebx2, ebx2_r;
+
+    HostAutoconfigHelper::record_t tuned;  // how the slab length was chosen
+
+    size_t nbyte_live{0}, nbyte_peak{0};
+    float  milliseconds{0.0};
+
+    cusz::TaskGraph graph;
+
+    void __track(long long nbyte)
+    {
+        nbyte_live += nbyte;
+        nbyte_peak = std::max(nbyte_peak, nbyte_live);
+    }
+
+    static cusz::ThreadPool& get_pool() { return cusz::ThreadPool::get_default(); }
+    static int               get_nworker() { return get_pool().get_nworker(); }
+
+    struct slab_outlier_t {
+        std::vector<uint32_t> idx;
+        std::vector<Data>     val;
+    };
+
+    /**
+     * @brief Visit the Lorenzo blocks of slab `s`; `fn(lo[3], hi[3])` in field coordinates.
+     */
+    template <typename FN>
+    static void for_each_block(header_t const& h, uint32_t s, FN fn)
+    {
+        uint32_t lo[3] = {0, 0, 0}, hi[3] = {h.dims[0], h.dims[1], h.dims[2]};
+        h.get_slab(s, lo[h.ndim - 1], hi[h.ndim - 1]);
+
+        uint32_t b_lo[3], b_hi[3];
+        for (auto z = lo[2]; z < hi[2]; z += h.block[2])
+            for (auto y = lo[1]; y < hi[1]; y += h.block[1])
+                for (auto x = lo[0]; x < hi[0]; x += h.block[0]) {
+                    b_lo[0] = x, b_lo[1] = y, b_lo[2] = z;
+                    for (auto d = 0; d < 3; d++) b_hi[d] = std::min(b_lo[d] + h.block[d], hi[d]);
+                    fn(b_lo, b_hi);
+                }
+    }
+
+    /**
+     * @brief Quant-codes of slab `s` into `code` (slab-local); outliers go to `outlier` if given. `scratch` holds a
+     * block with its zero halo.
+     */
+    void c_lorenzo_slab(const Data* in, uint32_t s, E* code, slab_outlier_t* outlier, std::vector<Data>& scratch) const
+    {
+        auto const& h      = header;
+        auto        off    = h.get_slab_offset(s);
+        auto        radius = h.radius;
+        auto        sx = h.block[0] + 1, sxy = sx * (h.block[1] + 1);
+        size_t      stride1 = h.dims[0], stride2 = (size_t)h.dims[0] * h.dims[1];
+
+        for_each_block(h, s, [&](uint32_t* lo, uint32_t* hi) {
+            std::fill(scratch.begin(), scratch.end(), 0);
+            auto S = scratch.data();
+
+            // prequant
+            for (auto z = lo[2]; z < hi[2]; z++)
+                for (auto y = lo[1]; y < hi[1]; y++)
+                    for (auto x = lo[0]; x < hi[0]; x++) {
+                        auto id = x + y * stride1 + z * stride2;
+                        S[(x - lo[0] + 1) + (y - lo[1] + 1) * sx + (z - lo[2] + 1) * sxy] = round(in[id] * ebx2_r);
+                    }
+
+            // postquant; with a zero halo, the 3D predictor is the 2D/1D one on thinner fields
+            for (auto z = lo[2]; z < hi[2]; z++)
+                for (auto y = lo[1]; y < hi[1]; y++)
+                    for (auto x = lo[0]; x < hi[0]; x++) {
+                        auto i = (x - lo[0] + 1) + (y - lo[1] + 1) * sx + (z - lo[2] + 1) * sxy;
+
+                        Data pred = S[i - 1 - sx - sxy]                                  // +, dist=3
+                                    - S[i - sx - sxy] - S[i - 1 - sxy] - S[i - 1 - sx]  // -, dist=2
+                                    + S[i - sxy] + S[i - sx] + S[i - 1];                // +, dist=1
+                        Data delta       = S[i] - pred;
+                        bool quantizable = fabs(delta) < radius;
+                        auto local       = x + y * stride1 + z * stride2 - off;
+
+                        code[local] = quantizable ? static_cast<E>(delta + radius) : 0;
+                        if (not quantizable and outlier)
+                            outlier->idx.push_back(local), outlier->val.push_back(S[i]);
+                    }
+        });
+    }
+
+    /**
+     * @brief Reconstruct slab `s` into `out` (slab-local) from its codes; outlier values must already be in `out`.
+     */
+    static void x_lorenzo_slab(header_t const& h, uint32_t s, E* code, Data* out, std::vector<Data>& scratch)
+    {
+        auto   off    = h.get_slab_offset(s);
+        auto   radius = h.radius;
+        auto   ebx2   = h.eb * 2;
+        auto   sx = h.block[0] + 1, sxy = sx * (h.block[1] + 1);
+        size_t stride1 = h.dims[0], stride2 = (size_t)h.dims[0] * h.dims[1];
+
+        for_each_block(h, s, [&](uint32_t* lo, uint32_t* hi) {
+            std::fill(scratch.begin(), scratch.end(), 0);
+            auto S = scratch.data();
+
+            for (auto z = lo[2]; z < hi[2]; z++)
+                for (auto y = lo[1]; y < hi[1]; y++)
+                    for (auto x = lo[0]; x < hi[0]; x++) {
+                        auto i     = (x - lo[0] + 1) + (y - lo[1] + 1) * sx + (z - lo[2] + 1) * sxy;
+                        auto local = x + y * stride1 + z * stride2 - off;
+
+                        Data pred = S[i - 1 - sx - sxy]                                  // +, dist=3
+                                    - S[i - sx - sxy] - S[i - 1 - sxy] - S[i - 1 - sx]  // -, dist=2
+                                    + S[i - sxy] + S[i - sx] + S[i - 1];                // +, dist=1
+                        S[i] = code[local] == 0 ? out[local] : static_cast<Data>(pred + (code[local] - radius));
+                    }
+
+            for (auto z = lo[2]; z < hi[2]; z++)
+                for (auto y = lo[1]; y < hi[1]; y++)
+                    for (auto x = lo[0]; x < hi[0]; x++) {
+                        auto i = (x - lo[0] + 1) + (y - lo[1] + 1) * sx + (z - lo[2] + 1) * sxy;
+                        out[x + y * stride1 + z * stride2 - off] = S[i] * ebx2;
+                    }
+        });
+    }
+
+    static size_t get_scratch_len(header_t const& h)
+    {
+        return (size_t)(h.block[0] + 1) * (h.block[1] + 1) * (h.block[2] + 1);
+    }
+
+    static size_t get_max_slab_len(header_t const& h) { return h.nslab == 0 ? 0 : h.get_slab_len(0); }
+
+    /**
+     * @brief Section offsets of the archive, and the Huffman subfile header, laid out as cpu::HuffmanCoarse::encode()
+     * does.
+     */
+    void lay_out(
+        size_t                    noutlier,
+        size_t                    revbook_nbyte,
+        size_t                    total_ncell,
+        size_t                    total_nbit,
+        typename Codec::header_t& vle)
+    {
+        auto const& h = header;
+
+        memset(&vle, 0, sizeof(vle));
+        {
+            using VH = typename Codec::header_t;
+            vle.header_nbyte     = sizeof(VH);
+            vle.booklen          = 2 * h.radius;
+            vle.sublen           = get_max_slab_len(h);
+            vle.pardeg           = h.nslab;
+            vle.uncompressed_len = h.get_len();
+            vle.total_nbit       = total_nbit;
+            vle.total_ncell      = total_ncell;
+
+            uint32_t nbyte[VH::END];
+            nbyte[VH::HEADER]    = 128;
+            nbyte[VH::REVBOOK]   = revbook_nbyte;
+            nbyte[VH::PAR_NBIT]  = sizeof(uint32_t) * h.nslab;
+            nbyte[VH::PAR_ENTRY] = sizeof(uint32_t) * h.nslab;
+            nbyte[VH::BITSTREAM] = h.vle_word_nbyte * total_ncell;
+
+            vle.entry[0] = 0;
+            for (auto i = 1; i < VH::END + 1; i++) vle.entry[i] = vle.entry[i - 1] + nbyte[i - 1];
+        }
+        {
+            uint64_t nbyte[header_t::END];
+            nbyte[header_t::HEADER]      = 128;
+            nbyte[header_t::NOUTLIER]    = sizeof(uint32_t) * h.nslab;
+            nbyte[header_t::OUTLIER_IDX] = sizeof(uint32_t) * noutlier;
+            nbyte[header_t::OUTLIER_VAL] = sizeof(Data) * noutlier;
+            nbyte[header_t::VLE]         = vle.subfile_size();
+
+            header.entry[0] = 0;
+            for (auto i = 1; i < header_t::END + 1; i++) header.entry[i] = header.entry[i - 1] + nbyte[i - 1];
+        }
+    }
+
+    /**
+     * @brief Codebook of `freq` in H words; if the longest codeword does not fit, in 8-byte words instead, as the GPU
+     * path falls back. The word width taken goes to the header.
+     */
+    void build_codebook(
+        cusz::FREQ*            freq,
+        std::vector<H>&        book,
+        std::vector<uint64_t>& wide_book,
+        std::vector<BYTE>&     revbook)
+    {
+        auto booklen = 2 * header.radius;
+        try {
+            book.resize(booklen), revbook.assign(Codec::get_revbook_nbyte(booklen), 0);
+            Codec::build_codebook(freq, booklen, book.data(), revbook.data());
+            header.vle_word_nbyte = sizeof(H);
+        }
+        catch (const std::runtime_error&) {
+            if (sizeof(H) == sizeof(uint64_t)) throw;
+            if (get_max_slab_len(header) * (sizeof(uint64_t) * 8 - 8) > std::numeric_limits<uint32_t>::max())
+                throw std::runtime_error("psz::lowmem: a slab is too large for 32-bit chunk metadata of 8-byte words.");
+            wide_book.resize(booklen), revbook.assign(WideCodec::get_revbook_nbyte(booklen), 0);
+            WideCodec::build_codebook(freq, booklen, wide_book.data(), revbook.data());
+            header.vle_word_nbyte = sizeof(uint64_t);
+        }
+    }
+
+    // `fn(book)` with the codebook of the word width in the header
+    template <typename FN>
+    void with_codebook(std::vector<H>& book, std::vector<uint64_t>& wide_book, FN fn) const
+    {
+        if (header.vle_word_nbyte == sizeof(H))
+            fn(book.data());
+        else
+            fn(wide_book.data());
+    }
+
+    /**
+     * @brief Decode slab `s` of `archive` into `out` (slab-local), with `code` as slab-sized workspace.
+     */
+    static void decode_slab(BYTE const* archive, uint32_t s, E* code, Data* out, std::vector<Data>& scratch)
+    {
+        header_t h;
+        memcpy(&h, archive, sizeof(h));
+
+        typename Codec::header_t vle;
+        memcpy(&vle, archive + h.entry[header_t::VLE], sizeof(vle));
+
+        auto vle_base  = const_cast<BYTE*>(archive + h.entry[header_t::VLE]);
+        auto revbook   = vle_base + vle.entry[Codec::header_t::REVBOOK];
+        auto par_nbit  = reinterpret_cast<uint32_t*>(vle_base + vle.entry[Codec::header_t::PAR_NBIT]);
+        auto par_entry = reinterpret_cast<uint32_t*>(vle_base + vle.entry[Codec::header_t::PAR_ENTRY]);
+        auto bitstream = vle_base + vle.entry[Codec::header_t::BITSTREAM] + h.vle_word_nbyte * par_entry[s];
+        if (h.vle_word_nbyte == sizeof(H))
+            Codec::inflate_chunk(reinterpret_cast<H*>(bitstream), code, par_nbit[s], revbook);
+        else if (h.vle_word_nbyte == sizeof(uint64_t))
+            WideCodec::inflate_chunk(reinterpret_cast<uint64_t*>(bitstream), code, par_nbit[s], revbook);
+        else
+            throw std::runtime_error(
+                "psz::lowmem: unsupported Huffman word of " + std::to_string(h.vle_word_nbyte) + " bytes.");
+
+        auto noutlier = reinterpret_cast<uint32_t const*>(archive + h.entry[header_t::NOUTLIER]);
+        auto idx      = reinterpret_cast<uint32_t const*>(archive + h.entry[header_t::OUTLIER_IDX]);
+        auto val      = reinterpret_cast<Data const*>(archive + h.entry[header_t::OUTLIER_VAL]);
+
+        size_t start = 0;
+        for (auto i = 0u; i < s; i++) start += noutlier[i];
+        for (auto i = start; i < start + noutlier[s]; i++) out[idx[i]] = val[i];
+
+        x_lorenzo_slab(h, s, code, out, scratch);
+    }
+
+   public:
+    /**
+     * @param x, y, z field dims; trailing 1s lower the dimensionality
+     * @param eb absolute error bound
+     * @param radius quant-code radius; codes take [0, 2 * radius)
+     */
+    Compressor(uint32_t x, uint32_t y, uint32_t z, double eb, int radius = 512)
+    {
+        if (2 * radius > std::numeric_limits<E>::max())
+            throw std::runtime_error("psz::lowmem: radius does not fit the quant-code type.");
+
+        memset(&header, 0, sizeof(header));
+        header.dims[0] = x, header.dims[1] = y, header.dims[2] = z;
+        header.ndim    = z != 1 ? 3 : y != 1 ? 2 : 1;
+        header.radius  = radius;
+        header.eb      = eb;
+        ebx2 = eb * 2, ebx2_r = 1 / ebx2;
+
+        uint32_t const block[3][3] = {{256, 1, 1}, {16, 16, 1}, {32, 8, 8}};
+        for (auto d = 0; d < 3; d++) header.block[d] = block[header.ndim - 1][d];
+
+        auto a            = header.ndim - 1;
+        auto blockrow_len = header.get_plane_len() * header.block[a];
+        auto nblk_along   = (header.dims[a] - 1) / header.block[a] + 1;
+        // a slab is a Huffman chunk: it takes about the host-tuned sublen, and at least one block row
+        size_t target_len =
+            HostAutoconfigHelper::tune_coarse_huffman_sublen<E, H>(header.get_len(), 2 * radius, &tuned);
+        header.slab_nblk  = std::min<size_t>(nblk_along, std::max<size_t>(1, target_len / blockrow_len));
+        header.nslab      = (nblk_along - 1) / header.slab_nblk + 1;
+
+        if (get_max_slab_len(header) * (sizeof(H) * 8 - 8) > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("psz::lowmem: a slab is too large for 32-bit chunk metadata.");
+    }
+
+    header_t const&                       get_header() const { return header; }
+    HostAutoconfigHelper::record_t const& get_tune_record() const { return tuned; }
+
+    // e.g., for r2r, once the value range is known
+    void set_eb(double eb)
+    {
+        header.eb = eb;
+        ebx2 = eb * 2, ebx2_r = 1 / ebx2;
+    }
+
+    // bytes held beyond the input at the peak of the last compress(), archive included
+    size_t get_peak_nbyte() const { return nbyte_peak; }
+    float  get_time_elapsed() const { return milliseconds; }
+
+    /**
+     * @brief Compress `data` into `archive`.
+     *
+     * @param data (host array) input; consumed if `in_place`
+     * @param archive output, resized to fit
+     * @param in_place write the codes over `data` to predict once; otherwise `data` is kept and predicted twice
+     * @return number of outliers
+     */
+    size_t compress(Data* data, std::vector<BYTE>& archive, bool in_place = true)
+    {
+        auto const& h       = header;
+        auto        booklen = 2 * h.radius;
+        auto        nworker = get_nworker();
+
+        host_timer_t t;
+        t.timer_start();
+        nbyte_live = nbyte_peak = 0;
+
+        // per-worker workspace, first touched by its worker (the waves below deal slab i of a wave to worker i)
+        std::vector<std::vector<E>>          ws(nworker);
+        std::vector<std::vector<Data>>       scratch(nworker);
+        std::vector<std::vector<cusz::FREQ>> local_freq(nworker, std::vector<cusz::FREQ>(booklen, 0));
+        get_pool().for_each_worker([&](int w) {
+            ws[w].resize(get_max_slab_len(h)), scratch[w].resize(get_scratch_len(h));
+        });
+        __track(nworker * (get_max_slab_len(h) * sizeof(E) + get_scratch_len(h) * sizeof(Data)));
+        __track(nworker * booklen * sizeof(cusz::FREQ));
+
+        // pass 1: codes, outliers and histogram, a wave of one slab per worker at a time
+        std::vector<slab_outlier_t> outlier(h.nslab);
+        auto                        codes = reinterpret_cast<E*>(data);
+
+        for (uint32_t wave = 0; wave < h.nslab; wave += nworker) {
+            auto wave_end = std::min<uint32_t>(wave + nworker, h.nslab);
+
+            get_pool().for_each_worker([&](int w) {
+                auto s = wave + w;
+                if (s >= wave_end) return;
+                auto code = ws[w].data();
+                c_lorenzo_slab(data, s, code, &outlier[s], scratch[w]);
+                auto n = h.get_slab_len(s);
+                for (size_t i = 0; i < n; i++) local_freq[w][code[i]]++;
+            });
+
+            // the wave has read all it needs; its codes land in slabs at or before it
+            if (in_place)
+                for (auto s = wave; s < wave_end; s++)
+                    memmove(codes + h.get_slab_offset(s), ws[s - wave].data(), sizeof(E) * h.get_slab_len(s));
+        }
+
+        size_t noutlier = 0;
+        for (auto const& o : outlier) noutlier += o.idx.size();
+        __track(noutlier * (sizeof(uint32_t) + sizeof(Data)));
+
+        std::vector<cusz::FREQ> freq(booklen, 0);
+        for (auto const& f : local_freq)
+            for (auto k = 0; k < booklen; k++) freq[k] += f[k];
+
+        std::vector<H>        book;
+        std::vector<uint64_t> wide_book;
+        std::vector<BYTE>     revbook;
+        build_codebook(freq.data(), book, wide_book, revbook);
+
+        auto release_ws = [&]() {
+            __track(-(long long)(nworker * get_max_slab_len(h) * sizeof(E))), std::vector<std::vector<E>>().swap(ws);
+        };
+        if (in_place) release_ws();
+
+        with_codebook(book, wide_book, [&](auto* book) {
+            using W              = std::remove_pointer_t<decltype(book)>;
+            using C              = CodecOf<W>;
+            auto const cell_nbit = sizeof(W) * 8;
+
+            // pass 2: one Huffman chunk per slab. In place, the codes stay until the archive is laid out and deflate
+            // straight into it; otherwise they are regenerated and deflated now.
+            std::vector<std::vector<W>> bitstream(in_place ? 0 : h.nslab);
+            std::vector<uint32_t>       par_nbit(h.nslab), par_ncell(h.nslab), par_entry(h.nslab);
+
+            get_pool().parallel_for(
+                h.nslab,
+                [&](size_t begin, size_t end, int w) {
+                    for (uint32_t s = begin; s < end; s++) {
+                        auto n = h.get_slab_len(s);
+
+                        E* slab_code = codes + h.get_slab_offset(s);
+                        if (not in_place)
+                            c_lorenzo_slab(data, s, ws[w].data(), nullptr, scratch[w]), slab_code = ws[w].data();
+
+                        uint64_t nbit = 0;
+#pragma omp simd reduction(+ : nbit)
+                        for (size_t i = 0; i < n; i++) nbit += C::get_bits(book[slab_code[i]]);
+                        par_nbit[s]  = nbit;
+                        par_ncell[s] = (nbit + cell_nbit - 1) / cell_nbit;
+
+                        if (not in_place) {
+                            bitstream[s].assign(par_ncell[s], 0);
+                            C::deflate_chunk(slab_code, n, book, bitstream[s].data());
+                        }
+                    }
+                },
+                1);
+
+            size_t total_ncell = 0, total_nbit = 0;
+            for (uint32_t s = 0; s < h.nslab; s++) {
+                par_entry[s] = total_ncell;
+                total_ncell += par_ncell[s], total_nbit += par_nbit[s];
+            }
+            if (not in_place) __track(total_ncell * sizeof(W)), release_ws();
+
+            typename Codec::header_t vle;
+            lay_out(noutlier, revbook.size(), total_ncell, total_nbit, vle);
+
+            // assemble; the slab pieces are freed once copied
+            archive.assign(h.file_size(), 0);
+            __track(h.file_size());
+
+            auto dst = archive.data();
+            memcpy(dst, &header, sizeof(header));
+
+            auto d_noutlier = reinterpret_cast<uint32_t*>(dst + h.entry[header_t::NOUTLIER]);
+            auto d_idx      = reinterpret_cast<uint32_t*>(dst + h.entry[header_t::OUTLIER_IDX]);
+            auto d_val      = reinterpret_cast<Data*>(dst + h.entry[header_t::OUTLIER_VAL]);
+            for (uint32_t s = 0; s < h.nslab; s++) {
+                auto n        = outlier[s].idx.size();
+                d_noutlier[s] = n;
+                std::copy(outlier[s].idx.begin(), outlier[s].idx.end(), d_idx);
+                std::copy(outlier[s].val.begin(), outlier[s].val.end(), d_val);
+                d_idx += n, d_val += n;
+                slab_outlier_t().idx.swap(outlier[s].idx), slab_outlier_t().val.swap(outlier[s].val);
+            }
+
+            auto d_vle = dst + h.entry[header_t::VLE];
+            memcpy(d_vle, &vle, sizeof(vle));
+            memcpy(d_vle + vle.entry[Codec::header_t::REVBOOK], revbook.data(), revbook.size());
+            memcpy(d_vle + vle.entry[Codec::header_t::PAR_NBIT], par_nbit.data(), sizeof(uint32_t) * h.nslab);
+            memcpy(d_vle + vle.entry[Codec::header_t::PAR_ENTRY], par_entry.data(), sizeof(uint32_t) * h.nslab);
+            auto d_bitstream = reinterpret_cast<W*>(d_vle + vle.entry[Codec::header_t::BITSTREAM]);
+            if (in_place) {
+                get_pool().parallel_for(
+                    h.nslab,
+                    [&](size_t begin, size_t end, int) {
+                        for (uint32_t s = begin; s < end; s++)
+                            C::deflate_chunk(
+                                codes + h.get_slab_offset(s), h.get_slab_len(s), book, d_bitstream + par_entry[s]);
+                    },
+                    1);
+            }
+            else {
+                for (uint32_t s = 0; s < h.nslab; s++) {
+                    std::copy(bitstream[s].begin(), bitstream[s].end(), d_bitstream + par_entry[s]);
+                    std::vector<W>().swap(bitstream[s]);
+                }
+            }
+        });
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+        return noutlier;
+    }
+
+    /**
+     * @brief Compress `data` into `archive` as a task graph over slabs (see `cusz::TaskGraph`), byte for byte as
+     * `compress(data, archive, false)` does. The histogram of slab s runs as soon as slab s is predicted, beside the
+     * prediction of the next slabs; the outliers are compacted while the codebook is built; slab s is encoded as soon
+     * as the codebook is ready. Unlike `compress()`, this holds the codes of the whole field, and predicts once
+     * without consuming `data`. The trace of the run is in `get_task_graph()`.
+     *
+     * @param data (host array) input, kept
+     * @param archive output, resized to fit
+     * @param nworker threads; 0 for as many as OpenMP would use
+     * @return number of outliers
+     */
+    size_t compress_graph(const Data* data, std::vector<BYTE>& archive, int nworker = 0)
+    {
+        auto const& h       = header;
+        auto        booklen = 2 * h.radius;
+        if (nworker < 1) nworker = get_nworker();
+
+        host_timer_t t;
+        t.timer_start();
+        nbyte_live = nbyte_peak = 0;
+
+        std::vector<E>                       codes(h.get_len());
+        std::vector<std::vector<Data>>       scratch(nworker, std::vector<Data>(get_scratch_len(h)));
+        std::vector<std::vector<cusz::FREQ>> local_freq(nworker, std::vector<cusz::FREQ>(booklen, 0));
+        __track(h.get_len() * sizeof(E) + nworker * get_scratch_len(h) * sizeof(Data));
+        __track(nworker * booklen * sizeof(cusz::FREQ));
+
+        std::vector<slab_outlier_t>    outlier(h.nslab);
+        std::vector<uint32_t>          outlier_idx, d_noutlier(h.nslab);
+        std::vector<Data>              outlier_val;
+        std::vector<H>                 book;
+        std::vector<uint64_t>          wide_book;
+        std::vector<BYTE>              revbook;
+        std::vector<std::vector<BYTE>> bitstream(h.nslab);  // in whichever word the codebook takes
+        std::vector<uint32_t>          par_nbit(h.nslab), par_ncell(h.nslab), par_entry(h.nslab);
+
+        auto slab_code = [&](uint32_t s) { return codes.data() + h.get_slab_offset(s); };
+
+        using node_t = cusz::TaskGraph::node_t;
+        graph.clear();
+        std::vector<node_t> predict(h.nslab), hist(h.nslab), encode(h.nslab);
+
+        for (uint32_t s = 0; s < h.nslab; s++) {
+            predict[s] = graph.add("predict", s, [&, s](int w) {  //
+                c_lorenzo_slab(data, s, slab_code(s), &outlier[s], scratch[w]);
+            });
+            hist[s] = graph.add(
+                "histogram", s,
+                [&, s](int w) {
+                    auto code = slab_code(s);
+                    auto n    = h.get_slab_len(s);
+                    for (size_t i = 0; i < n; i++) local_freq[w][code[i]]++;
+                },
+                {predict[s]});
+        }
+
+        auto codebook = graph.add(
+            "codebook", 0,
+            [&](int) {
+                std::vector<cusz::FREQ> freq(booklen, 0);
+                for (auto const& f : local_freq)
+                    for (auto k = 0; k < booklen; k++) freq[k] += f[k];
+                build_codebook(freq.data(), book, wide_book, revbook);
+            },
+            hist);
+
+        // no dependence on the codebook: the two run at once
+        auto gather = graph.add(
+            "outlier", 0,
+            [&](int) {
+                size_t noutlier = 0;
+                for (auto const& o : outlier) noutlier += o.idx.size();
+                outlier_idx.reserve(noutlier), outlier_val.reserve(noutlier);
+                for (uint32_t s = 0; s < h.nslab; s++) {
+                    d_noutlier[s] = outlier[s].idx.size();
+                    outlier_idx.insert(outlier_idx.end(), outlier[s].idx.begin(), outlier[s].idx.end());
+                    outlier_val.insert(outlier_val.end(), outlier[s].val.begin(), outlier[s].val.end());
+                    slab_outlier_t().idx.swap(outlier[s].idx), slab_outlier_t().val.swap(outlier[s].val);
+                }
+            },
+            predict);
+
+        for (uint32_t s = 0; s < h.nslab; s++)
+            encode[s] = graph.add(
+                "encode", s,
+                [&, s](int) {
+                    with_codebook(book, wide_book, [&](auto* book) {
+                        using W              = std::remove_pointer_t<decltype(book)>;
+                        auto const cell_nbit = sizeof(W) * 8;
+
+                        auto     code = slab_code(s);
+                        auto     n    = h.get_slab_len(s);
+                        uint64_t nbit = 0;
+                        for (size_t i = 0; i < n; i++) nbit += CodecOf<W>::get_bits(book[code[i]]);
+                        par_nbit[s]  = nbit;
+                        par_ncell[s] = (nbit + cell_nbit - 1) / cell_nbit;
+                        bitstream[s].assign(sizeof(W) * par_ncell[s], 0);
+                        CodecOf<W>::deflate_chunk(code, n, book, reinterpret_cast<W*>(bitstream[s].data()));
+                    });
+                },
+                {codebook});
+
+        auto deps = encode;
+        deps.push_back(gather);
+        graph.add(
+            "concatenate", 0,
+            [&](int) {
+                size_t total_ncell = 0, total_nbit = 0;
+                for (uint32_t s = 0; s < h.nslab; s++) {
+                    par_entry[s] = total_ncell;
+                    total_ncell += par_ncell[s], total_nbit += par_nbit[s];
+                }
+
+                typename Codec::header_t vle;
+                lay_out(outlier_idx.size(), revbook.size(), total_ncell, total_nbit, vle);
+                archive.assign(h.file_size(), 0);
+
+                auto dst = archive.data();
+                memcpy(dst, &header, sizeof(header));
+                memcpy(dst + h.entry[header_t::NOUTLIER], d_noutlier.data(), sizeof(uint32_t) * h.nslab);
+                memcpy(dst + h.entry[header_t::OUTLIER_IDX], outlier_idx.data(), sizeof(uint32_t) * outlier_idx.size());
+                memcpy(dst + h.entry[header_t::OUTLIER_VAL], outlier_val.data(), sizeof(Data) * outlier_val.size());
+
+                auto d_vle = dst + h.entry[header_t::VLE];
+                memcpy(d_vle, &vle, sizeof(vle));
+                memcpy(d_vle + vle.entry[Codec::header_t::REVBOOK], revbook.data(), revbook.size());
+                memcpy(d_vle + vle.entry[Codec::header_t::PAR_NBIT], par_nbit.data(), sizeof(uint32_t) * h.nslab);
+                memcpy(d_vle + vle.entry[Codec::header_t::PAR_ENTRY], par_entry.data(), sizeof(uint32_t) * h.nslab);
+                auto d_bitstream = d_vle + vle.entry[Codec::header_t::BITSTREAM];
+                for (uint32_t s = 0; s < h.nslab; s++)
+                    std::copy(bitstream[s].begin(), bitstream[s].end(), d_bitstream + h.vle_word_nbyte * par_entry[s]);
+            },
+            deps);
+
+        graph.run(nworker);
+
+        // all pieces are alive at the end
+        size_t total_ncell = 0;
+        for (auto n : par_ncell) total_ncell += n;
+        __track(
+            outlier_idx.size() * (sizeof(uint32_t) + sizeof(Data)) + total_ncell * h.vle_word_nbyte + archive.size());
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+        return outlier_idx.size();
+    }
+
+    // of the last compress_graph()
+    cusz::TaskGraph const& get_task_graph() const { return graph; }
+
+    /**
+     * @brief Decompress `archive` into `out`, slab by slab; `out` is the only field-sized buffer.
+     */
+    static void decompress(BYTE const* archive, Data* out)
+    {
+        header_t h;
+        memcpy(&h, archive, sizeof(h));
+        auto nworker = get_nworker();
+
+        std::vector<std::vector<E>>    ws(nworker, std::vector<E>(get_max_slab_len(h)));
+        std::vector<std::vector<Data>> scratch(nworker, std::vector<Data>(get_scratch_len(h)));
+
+        get_pool().parallel_for(
+            h.nslab,
+            [&](size_t begin, size_t end, int w) {
+                for (uint32_t s = begin; s < end; s++)
+                    decode_slab(archive, s, ws[w].data(), out + h.get_slab_offset(s), scratch[w]);
+            },
+            1);
+    }
+
+    /**
+     * @brief Decompress and compare slab by slab, without a decompressed field; the original comes from
+     * `reference`, e.g., re-read from the input file when the input was compressed in place.
+     *
+     * Fills the error fields of `stat` (max error and its index, MSE, NRMSE, PSNR) and the original range; the
+     * moments (std, correlation) are not computed.
+     */
+    static void verify(BYTE const* archive, reference_fn reference, stat_t& stat)
+    {
+        header_t h;
+        memcpy(&h, archive, sizeof(h));
+        auto nworker = get_nworker();
+        auto max_len = get_max_slab_len(h);
+
+        std::vector<std::vector<E>>    ws(nworker, std::vector<E>(max_len));
+        std::vector<std::vector<Data>> xdata(nworker, std::vector<Data>(max_len)), odata(xdata);
+        std::vector<std::vector<Data>> scratch(nworker, std::vector<Data>(get_scratch_len(h)));
+
+        double min_odata = std::numeric_limits<double>::max(), max_odata = std::numeric_limits<double>::lowest();
+        double min_xdata = min_odata, max_xdata = max_odata;
+        double max_abserr = -1, sum_err2 = 0;
+        size_t max_abserr_index = 0;
+
+        std::mutex mtx;
+        get_pool().parallel_for(
+            h.nslab,
+            [&](size_t begin, size_t end, int w) {
+                for (uint32_t s = begin; s < end; s++) {
+                    auto n   = h.get_slab_len(s);
+                    auto off = h.get_slab_offset(s);
+                    auto x = xdata[w].data(), o = odata[w].data();
+
+                    decode_slab(archive, s, ws[w].data(), x, scratch[w]);
+                    reference(off, n, o);
+
+                    double s_min_o = o[0], s_max_o = o[0], s_min_x = x[0], s_max_x = x[0], s_max_err = -1, s_err2 = 0;
+                    size_t s_max_idx = 0;
+                    for (size_t i = 0; i < n; i++) {
+                        double err = fabs((double)x[i] - o[i]);
+                        s_min_o = std::min<double>(s_min_o, o[i]), s_max_o = std::max<double>(s_max_o, o[i]);
+                        s_min_x = std::min<double>(s_min_x, x[i]), s_max_x = std::max<double>(s_max_x, x[i]);
+                        if (err > s_max_err) s_max_err = err, s_max_idx = off + i;
+                        s_err2 += err * err;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        min_odata = std::min(min_odata, s_min_o), max_odata = std::max(max_odata, s_max_o);
+                        min_xdata = std::min(min_xdata, s_min_x), max_xdata = std::max(max_xdata, s_max_x);
+                        if (s_max_err > max_abserr) max_abserr = s_max_err, max_abserr_index = s_max_idx;
+                        sum_err2 += s_err2;
+                    }
+                }
+            },
+            1);
+
+        auto len = h.get_len();
+
+        stat                   = stat_t();
+        stat.len               = len;
+        stat.min_odata         = min_odata;
+        stat.max_odata         = max_odata;
+        stat.rng_odata         = max_odata - min_odata;
+        stat.min_xdata         = min_xdata;
+        stat.max_xdata         = max_xdata;
+        stat.rng_xdata         = max_xdata - min_xdata;
+        stat.user_set_eb       = h.eb;
+        stat.max_abserr        = max_abserr;
+        stat.max_abserr_index  = max_abserr_index;
+        stat.max_abserr_vs_rng = max_abserr / stat.rng_odata;
+        stat.MSE               = sum_err2 / len;
+        stat.NRMSE             = sqrt(stat.MSE) / stat.rng_odata;
+        stat.PSNR              = 20 * log10(stat.rng_odata) - 10 * log10(stat.MSE);
+    }
+
+    // end of class definition
+};
+
+}  // namespace lowmem
+}  // namespace psz
+
+#endif
@@ -13,12 +13,17 @@
  *
  */
 
+#include <functional>
+
 #include "../analysis.hh"
 #include "../utils/io.hh"
+#include "../utils/numa.hh"
+#include "../utils/thread_pool.hh"
 #include "../utils/verify.hh"
 #include "psz_14.hh"
 #include "psz_14blocked.hh"
 #include "psz_dualquant.hh"
+#include "psz_lowmem.hh"
 
 const int LOCAL_B_1d = 32;
 const int LOCAL_B_2d = 16;
@@ -32,19 +37,69 @@ namespace psz {
 
 namespace FineMassiveSimulation {
 
+/**
+ * @brief Run `fn(b0, b1, b2)` for every block of the field on the host pool. Blocks are indexed flat, x fastest, and
+ * dealt to workers in contiguous runs, the same on every call (see `NumaHelper::for_each_chunk()`): a field of few
+ * blocks along its slowest axis (e.g., 3600x1800x26, 4 z-blocks) still spreads over every worker, and a worker
+ * computes the blocks whose pages it touched in `allocate_blocked()`.
+ */
+template <typename FN>
+void for_each_block(size_t const* const dims, FN fn)
+{
+    auto n0 = dims[nBLK0], n1 = dims[nDIM] >= 2 ? dims[nBLK1] : 1, n2 = dims[nDIM] == 3 ? dims[nBLK2] : 1;
+    cusz::NumaHelper::for_each_chunk(n0 * n1 * n2, [&](size_t i) { fn(i % n0, i / n0 % n1, i / (n0 * n1)); });
+}
+
+/**
+ * @brief Zero-filled array of the field, placed by `placement`; under FIRST_TOUCH, each block is zero-filled by the
+ * worker that computes it in `for_each_block()`.
+ */
+template <typename T>
+T* allocate_blocked(size_t const* const dims, cusz::NumaHelper::policy_t placement)
+{
+    size_t const B  = dims[nDIM] == 3 ? LOCAL_B_3d : (dims[nDIM] == 2 ? LOCAL_B_2d : LOCAL_B_1d);
+    size_t const d0 = dims[DIM0], d1 = dims[nDIM] >= 2 ? dims[DIM1] : 1, d2 = dims[nDIM] == 3 ? dims[DIM2] : 1;
+
+    return cusz::NumaHelper::allocate_with<T>(dims[LEN], placement, [&](T* a) {
+        for_each_block(dims, [&](size_t b0, size_t b1, size_t b2) {
+            auto x0 = b0 * B, nx = std::min(B, d0 - x0);
+            for (auto z = b2 * B; z < std::min((b2 + 1) * B, d2); z++)
+                for (auto y = b1 * B; y < std::min((b1 + 1) * B, d1); y++)
+                    memset(a + x0 + d0 * (y + d1 * z), 0, sizeof(T) * nx);
+        });
+    });
+}
+
+/**
+ * @brief For r2r: given the value range of the field, found as the field is read, the error bounds to compress with.
+ */
+using r2r_fn = std::function<double const*(double value_range)>;
+
 template <typename Data, typename Quant>
 void cx_sim(
-    std::string&        finame,  //
-    size_t const* const dims,
-    double const* const eb_variants,
-    size_t&             num_outlier,
-    bool                fine_massive = false,
-    bool                blocked      = false,
-    bool                show_histo   = false)
+    std::string&               finame,  //
+    size_t const* const        dims,
+    double const*              eb_variants,
+    size_t&                    num_outlier,
+    bool                       fine_massive = false,
+    bool                       blocked      = false,
+    bool                       show_histo   = false,
+    cusz::NumaHelper::policy_t placement    = cusz::NumaHelper::FIRST_TOUCH,
+    r2r_fn                     to_r2r       = nullptr)
 {
+    using numa = cusz::NumaHelper;
+
     size_t len = dims[LEN];
 
-    auto data     = io::read_binary_to_new_array<Data>(finame, len);
+    auto data = allocate_blocked<Data>(dims, placement);
+    if (to_r2r) {
+        io::value_range_t<Data> range;
+        io::read_binary_to_array(finame, data, len, range);
+        eb_variants = to_r2r(range.get_rng());
+    }
+    else {
+        io::read_binary_to_array(finame, data, len);
+    }
     auto data_cmp = io::read_binary_to_new_array<Data>(finame, len);
 
     Data* pred_err = nullptr;
@@ -54,9 +109,9 @@ void cx_sim(
     comp_err = new T[len]();
 #endif
 
-    auto xdata   = new Data[len]();
-    auto outlier = new Data[len]();
-    auto code    = new Quant[len]();
+    auto xdata   = allocate_blocked<Data>(dims, placement);
+    auto outlier = allocate_blocked<Data>(dims, placement);
+    auto code    = allocate_blocked<Quant>(dims, placement);
 
     if (fine_massive)
         cout << "\e[46musing (blocked) dualquant\e[0m" << endl;
@@ -67,18 +122,16 @@ void cx_sim(
     ////////////////////////////////////////////////////////////////////////////////
     // start of compression
     ////////////////////////////////////////////////////////////////////////////////
-    // TODO omp version
     if (dims[nDIM] == 1) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
+            for_each_block(dims, [&](size_t b0, size_t, size_t) {
                 if (fine_massive)
                     PdQ::c_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(
                         data, outlier, code, dims, eb_variants, pred_err, comp_err, b0);
                 else
                     PQRb::c_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(
                         data, outlier, code, dims, eb_variants, pred_err, comp_err, b0);
-            }
+            });
         }
         else {
             PQRs::c_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(data, outlier, code, dims, eb_variants, pred_err, comp_err);
@@ -86,17 +139,14 @@ void cx_sim(
     }
     else if (dims[nDIM] == 2) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b1 = 0; b1 < dims[nBLK1]; b1++) {
-                for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
-                    if (fine_massive)
-                        PdQ::c_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
-                            data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1);
-                    else
-                        PQRb::c_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
-                            data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1);
-                }
-            }
+            for_each_block(dims, [&](size_t b0, size_t b1, size_t) {
+                if (fine_massive)
+                    PdQ::c_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
+                        data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1);
+                else
+                    PQRb::c_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
+                        data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1);
+            });
         }
         else {
             PQRs::c_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(data, outlier, code, dims, eb_variants, pred_err, comp_err);
@@ -104,19 +154,14 @@ void cx_sim(
     }
     else if (dims[nDIM] == 3) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b2 = 0; b2 < dims[nBLK2]; b2++) {
-                for (size_t b1 = 0; b1 < dims[nBLK1]; b1++) {
-                    for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
-                        if (fine_massive)
-                            PdQ::c_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
-                                data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1, b2);
-                        else
-                            PQRb::c_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
-                                data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1, b2);
-                    }
-                }
-            }
+            for_each_block(dims, [&](size_t b0, size_t b1, size_t b2) {
+                if (fine_massive)
+                    PdQ::c_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
+                        data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1, b2);
+                else
+                    PQRb::c_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
+                        data, outlier, code, dims, eb_variants, pred_err, comp_err, b0, b1, b2);
+            });
         }
         else {
             PQRs::c_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(data, outlier, code, dims, eb_variants, pred_err, comp_err);
@@ -139,14 +184,13 @@ void cx_sim(
     ////////////////////////////////////////////////////////////////////////////////
     if (dims[nDIM] == 1) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
+            for_each_block(dims, [&](size_t b0, size_t, size_t) {
                 if (fine_massive)
                     PdQ::x_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(xdata, outlier, code, dims, eb_variants[EBx2], b0);
                 else
                     PQRb::x_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(
                         xdata, outlier, code, dims, eb_variants, b0);  // TODO __2EB
-            }
+            });
         }
         else {
             PQRs::x_lorenzo_1d1l<Data, Quant, LOCAL_B_1d>(xdata, outlier, code, dims, eb_variants);  // TODO __2EB
@@ -154,17 +198,13 @@ void cx_sim(
     }
     if (dims[nDIM] == 2) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b1 = 0; b1 < dims[nBLK1]; b1++) {
-                for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
-                    if (fine_massive)
-                        PdQ::x_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
-                            xdata, outlier, code, dims, eb_variants[EBx2], b0, b1);
-                    else
-                        PQRb::x_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
-                            xdata, outlier, code, dims, eb_variants, b0, b1);  // TODO __2EB
-                }
-            }
+            for_each_block(dims, [&](size_t b0, size_t b1, size_t) {
+                if (fine_massive)
+                    PdQ::x_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(xdata, outlier, code, dims, eb_variants[EBx2], b0, b1);
+                else
+                    PQRb::x_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(
+                        xdata, outlier, code, dims, eb_variants, b0, b1);  // TODO __2EB
+            });
         }
         else {
             PQRs::x_lorenzo_2d1l<Data, Quant, LOCAL_B_2d>(xdata, outlier, code, dims, eb_variants);  // TODO __2EB
@@ -172,19 +212,14 @@ void cx_sim(
     }
     else if (dims[nDIM] == 3) {
         if (blocked) {
-#pragma omp parallel for
-            for (size_t b2 = 0; b2 < dims[nBLK2]; b2++) {
-                for (size_t b1 = 0; b1 < dims[nBLK1]; b1++) {
-                    for (size_t b0 = 0; b0 < dims[nBLK0]; b0++) {
-                        if (fine_massive)
-                            PdQ::x_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
-                                xdata, outlier, code, dims, eb_variants[EBx2], b0, b1, b2);
-                        else
-                            PQRb::x_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
-                                xdata, outlier, code, dims, eb_variants, b0, b1, b2);  // TODO __2EB
-                    }
-                }
-            }
+            for_each_block(dims, [&](size_t b0, size_t b1, size_t b2) {
+                if (fine_massive)
+                    PdQ::x_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
+                        xdata, outlier, code, dims, eb_variants[EBx2], b0, b1, b2);
+                else
+                    PQRb::x_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(
+                        xdata, outlier, code, dims, eb_variants, b0, b1, b2);  // TODO __2EB
+            });
         }
         else {
             PQRs::x_lorenzo_3d1l<Data, Quant, LOCAL_B_3d>(xdata, outlier, code, dims, eb_variants);  // TODO __2EB
@@ -212,6 +247,73 @@ void cx_sim(
     stat_t stat;
     analysis::verify_data(&stat, xdata, data_cmp, len);
     analysis::print_data_quality_metrics<Data>(&stat);
+
+    numa::deallocate(data, len), numa::deallocate(xdata, len), numa::deallocate(outlier, len);
+    numa::deallocate(code, len);
+    delete[] data_cmp;
+}
+
+/**
+ * @brief Production counterpart of `cx_sim`: the field is held once and compressed in place (see
+ * `psz::lowmem::Compressor`); the optional verification decompresses slab by slab against the file. With `graph`,
+ * the stages run as a task graph instead, holding the codes of the field as well, and the trace of the stages is
+ * printed and written next to the archive for chrome://tracing. With `to_r2r`, the error bound follows from the value
+ * range found as the field is read.
+ */
+template <typename Data, typename Quant = uint16_t>
+void cx_lowmem(
+    std::string&               finame,
+    size_t const* const        dims,
+    double const* const        eb_variants,
+    bool                       verify    = true,
+    cusz::NumaHelper::policy_t placement = cusz::NumaHelper::FIRST_TOUCH,
+    bool                       graph     = false,
+    r2r_fn                     to_r2r    = nullptr)
+{
+    using numa = cusz::NumaHelper;
+
+    size_t len = dims[LEN];
+
+    psz::lowmem::Compressor<Data, Quant> cx(dims[DIM0], dims[DIM1], dims[DIM2], eb_variants[EB], dims[RADIUS]);
+    std::vector<uint8_t>                 archive;
+
+    size_t num_outlier;
+    {
+        // slabs are dealt to workers in turn
+        auto data = numa::allocate<Data>(len, placement, cx.get_header().get_slab_len(0), true);
+        if (to_r2r) {
+            io::value_range_t<Data> range;
+            io::read_binary_to_array(finame, data, len, range);
+            cx.set_eb(to_r2r(range.get_rng())[EB]);
+        }
+        else {
+            io::read_binary_to_array(finame, data, len);
+        }
+        num_outlier = graph ? cx.compress_graph(data, archive) : cx.compress(data, archive, true);
+        numa::deallocate(data, len);
+    }
+    io::write_array_to_binary(finame + ".psz.lowmem", archive.data(), archive.size());
+    if (graph) {
+        cx.get_task_graph().print_summary(cout);
+        cx.get_task_graph().write_chrome_trace(finame + ".psz.trace.json");
+    }
+
+    cout << "\e[46mnum.outlier:\t" << num_outlier << "\e[0m" << endl;
+    cout << "slab (sublen tuned):\t" << cx.get_header().get_slab_len(0) << " (" << cx.get_tune_record().sublen
+         << ")" << endl;
+    cout << "compress time (ms):\t" << cx.get_time_elapsed() << endl;
+    cout << "peak beyond input:\t" << cx.get_peak_nbyte() * 1.0 / (sizeof(Data) * len) << "x input" << endl;
+
+    if (verify) {
+        io::PositionalFile file(finame, io::PositionalFile::READ);
+
+        stat_t stat;
+        psz::lowmem::Compressor<Data, Quant>::verify(
+            archive.data(),
+            [&](size_t offset, size_t n, Data* out) { file.read(out, sizeof(Data) * n, sizeof(Data) * offset); },
+            stat);
+        analysis::print_data_quality_metrics<Data>(&stat, archive.size());
+    }
 }
 
 }  // namespace FineMassiveSimulation
@@ -0,0 +1,307 @@
+/**
+ * @file planner.hh
+ * @author Jiannan Tian
+ * @brief Memory-budgeted compression planner: estimates the device and host footprint of a compression, and picks
+ * monolithic, chunked or streaming execution (and the brick) that fits a memory cap.
+ * @version 0.3
+ * @date 2022-03-20
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_PLANNER_HH
+#define CUSZ_PLANNER_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "chunked.hh"
+
+namespace cusz {
+
+/**
+ * @brief Bytes held at the peak of a compression, by stage. Device sizes follow the `allocate_workspace()` of the
+ * default path: predictor (Lorenzo or Spline3), spreducer (CSR11), coarse Huffman codec(s) and the output reservation.
+ */
+struct footprint_t {
+    size_t data{0};       // input or brick staging, padded to a square matrix
+    size_t predictor{0};  // anchor and quant-codes; level-major codes for Spline3
+    size_t spreducer{0};  // outliers in CSR; nnz is sized by the density factor
+    size_t codec{0};      // histogram, codebooks, partition metadata, bitstream; per codec in use
+    size_t reserved{0};   // compressor output
+    size_t host{0};       // mapped field or slab buffers, host staging, compressed bricks in flight, codec metadata
+    size_t largest{0};    // largest single device buffer; component workspaces count bytes in 32 bits
+
+    size_t get_device_nbyte() const { return data + predictor + spreducer + codec + reserved; }
+
+    footprint_t& operator+=(footprint_t const& other)
+    {
+        data += other.data, predictor += other.predictor, spreducer += other.spreducer, codec += other.codec;
+        reserved += other.reserved, host += other.host, largest = std::max(largest, other.largest);
+        return *this;
+    }
+};
+
+struct MemoryPlan {
+    enum mode_t { MONOLITHIC, CHUNKED, STREAMING };
+
+    mode_t      mode{MONOLITHIC};
+    dim3_compat brick{0, 1, 1};  // for CHUNKED and STREAMING
+    footprint_t footprint;
+
+    static const char* get_mode_name(mode_t m)
+    {
+        return m == MONOLITHIC ? "monolithic" : (m == CHUNKED ? "chunked" : "streaming");
+    }
+};
+
+/**
+ * @brief A monolithic compression holds the whole field, its quant-codes, outliers, the Huffman bitstream and the
+ * output reservation on device at once, over 4x the field for f32. When that exceeds the cap, the field is cut
+ * into bricks (chunked, the field is mapped in host memory) or, when the mapped field itself is over the cap,
+ * streamed one slab at a time. Bricks are the largest that fit; their extents are multiples of the Lorenzo block.
+ *
+ * A cap of 0 is no cap.
+ */
+class MemoryPlanner {
+   public:
+    struct setup_t {
+        size_t      dtype_nbyte{4};
+        size_t      quant_nbyte{2};
+        uint32_t    codecs_in_use{0b01};  // 0b01: 4-byte codec, 0b10: 8-byte (fallback) codec
+        int         radius{512};
+        int         vle_sublen{512};
+        float       density_factor{4};
+        std::string predictor{"lorenzo"};
+    };
+
+    template <class CONFIG>
+    static setup_t get_setup(CONFIG* ctx, size_t dtype_nbyte)
+    {
+        setup_t s;
+        s.dtype_nbyte    = dtype_nbyte;
+        s.quant_nbyte    = (*ctx).quant_bytewidth;
+        s.codecs_in_use  = (*ctx).codecs_in_use;
+        s.radius         = (*ctx).radius;
+        s.vle_sublen     = (*ctx).vle_sublen;
+        s.density_factor = (*ctx).nz_density_factor;
+        s.predictor      = (*ctx).str_predictor;
+        return s;
+    }
+
+   private:
+    setup_t setup;
+    size_t  device_cap, host_cap;
+
+    static size_t square(size_t len)
+    {
+        auto m = (size_t)ceil(sqrt((double)len));
+        return m * m;
+    }
+
+    static size_t get_len(dim3_compat xyz) { return (size_t)xyz.x * xyz.y * xyz.z; }
+
+    static int get_ndim(dim3_compat xyz) { return xyz.z > 1 ? 3 : (xyz.y > 1 ? 2 : 1); }
+
+    // along any axis; the same as the slab depth in BrickLayout::get_slab_brick()
+    static uint32_t get_block(int ndim) { return ndim == 3 ? 8 : (ndim == 2 ? 16 : 256); }
+
+    static void track(footprint_t& fp, size_t nbyte) { fp.largest = std::max(fp.largest, nbyte); }
+
+    bool fits(footprint_t const& fp) const
+    {
+        return (device_cap == 0 or fp.get_device_nbyte() <= device_cap) and (host_cap == 0 or fp.host <= host_cap) and
+               fp.largest <= UINT32_MAX;
+    }
+
+    /**
+     * @brief Footprint of the chunked (or streaming) run: one staging brick, and one compressor per distinct brick
+     * shape, since the slots live until the end of the run; edge bricks make up to 2^ndim shapes.
+     */
+    footprint_t get_chunked(dim3_compat field, dim3_compat brick, bool streaming) const
+    {
+        uint32_t f[3] = {field.x, field.y, field.z}, b[3] = {brick.x, brick.y, brick.z};
+        uint32_t shape[3][2];
+        int      nshape[3];
+        for (auto d = 0; d < 3; d++) {
+            b[d]        = std::min(b[d], f[d]);
+            shape[d][0] = b[d], shape[d][1] = f[d] % b[d];
+            nshape[d]   = shape[d][1] ? 2 : 1;
+        }
+
+        footprint_t fp;
+        for (auto i = 0; i < nshape[0]; i++)
+            for (auto j = 0; j < nshape[1]; j++)
+                for (auto k = 0; k < nshape[2]; k++) fp += get_workspace({shape[0][i], shape[1][j], shape[2][k]});
+
+        BrickLayout layout(field, {b[0], b[1], b[2]});
+        auto        brick_len = get_len({b[0], b[1], b[2]});
+        auto        staging   = setup.dtype_nbyte * square(brick_len);
+        auto        blob      = setup.dtype_nbyte * brick_len / 2;  // compressed brick, at most the reservation
+        auto        depth     = b[layout.get_slab_axis()];
+
+        fp.data = staging;
+        track(fp, staging);
+        fp.host += staging;
+        if (streaming) {
+            auto nblob = std::max(layout.get_nbrick_per_slab(), (size_t)ChunkedHelper::BLOB_QUEUE_DEPTH);
+            fp.host += ChunkedHelper::NSLAB_BUFFER * layout.get_plane_len() * depth * setup.dtype_nbyte;
+            fp.host += nblob * blob;
+        }
+        else {
+            fp.host += get_len(field) * setup.dtype_nbyte;  // mapped, and all of it is touched
+            fp.host += ChunkedHelper::BLOB_QUEUE_DEPTH * blob;
+        }
+        return fp;
+    }
+
+    /**
+     * @brief The largest brick that fits, if any; a zero brick otherwise. The slowest axis is cut first, then, if a
+     * brick one block deep still does not fit, the next faster one, and so on. Along the axis being cut, the
+     * footprint grows with the extent, so the extent is bisected in blocks.
+     */
+    dim3_compat search_brick(dim3_compat field, bool streaming) const
+    {
+        auto     block = get_block(get_ndim(field));
+        uint32_t f[3]  = {field.x, field.y, field.z}, b[3] = {field.x, field.y, field.z};
+
+        auto fits_with = [&](int axis, uint32_t extent) {
+            b[axis] = extent;
+            return fits(get_chunked(field, {b[0], b[1], b[2]}, streaming));
+        };
+
+        for (auto axis = BrickLayout(field, field).get_slab_axis(); axis >= 0; axis--) {
+            size_t lo = 1, hi = (f[axis] - 1) / block + 1;  // in blocks
+            if (not fits_with(axis, std::min(f[axis], block))) {
+                b[axis] = std::min(f[axis], block);
+                continue;
+            }
+            while (lo < hi) {
+                auto mid = (lo + hi + 1) / 2;
+                if (fits_with(axis, std::min((size_t)f[axis], mid * block)))
+                    lo = mid;
+                else
+                    hi = mid - 1;
+            }
+            b[axis] = std::min((size_t)f[axis], lo * block);
+            return {b[0], b[1], b[2]};
+        }
+        return {0, 0, 0};
+    }
+
+   public:
+    MemoryPlanner(setup_t _setup, size_t _device_cap, size_t _host_cap = 0) :
+        setup(_setup), device_cap(_device_cap), host_cap(_host_cap)
+    {
+        if (setup.codecs_in_use == 0b00) throw std::runtime_error("[planner] codecs_in_use must have set bit(s).");
+    }
+
+    /**
+     * @brief Workspace of one compressor for a field (or brick) of `xyz`, without the input.
+     */
+    footprint_t get_workspace(dim3_compat xyz) const
+    {
+        footprint_t fp;
+
+        auto len       = get_len(xyz);
+        auto codec_len = len;
+        if (setup.predictor == "spline3") {
+            // padded to whole 32x8x8 blocks, as in the Spline3 constructor
+            auto aligned = ((size_t)xyz.x + 31) / 32 * 32 * ((xyz.y + 7) / 8 * 8) * ((xyz.z + 7) / 8 * 8);
+            codec_len    = square(aligned);
+            auto anchor  = setup.dtype_nbyte * (xyz.x / 8 + 1) * (xyz.y / 8 + 1) * (xyz.z / 8 + 1);
+            fp.predictor = anchor + 2 * setup.quant_nbyte * codec_len;  // quant-codes, and the same again by level
+        }
+        else {
+            fp.predictor = setup.quant_nbyte * len;  // outliers overlap the input
+        }
+        track(fp, setup.quant_nbyte * codec_len);
+
+        auto density_factor = std::max((int)setup.density_factor, 1);
+        auto nnz            = len / density_factor;
+        fp.spreducer        = setup.dtype_nbyte * nnz                        // compacted
+                       + sizeof(int) * (size_t)(sqrt((double)len) + 2)  // rowptr
+                       + sizeof(int) * nnz + setup.dtype_nbyte * nnz;   // colidx, val
+        track(fp, setup.dtype_nbyte * nnz);
+
+        auto booklen = (size_t)setup.radius * 2;
+        auto pardeg  = (len - 1) / std::max(setup.vle_sublen, 1) + 1;
+        for (size_t h : {(size_t)4, (size_t)8}) {
+            if (not(setup.codecs_in_use & (h == 4 ? 0b01 : 0b10))) continue;
+            auto book    = sizeof(uint32_t) * booklen + h * booklen;       // freq, book
+            auto revbook = h * (2 * h * 8) + setup.quant_nbyte * booklen;  // as in get_revbook_nbyte()
+            auto par     = 3 * sizeof(size_t) * pardeg;                    // nbit, ncell, entry
+            auto scratch = h * codec_len + h * (codec_len / 2);            // tmp, bitstream
+            fp.codec += book + revbook + par + scratch;
+            fp.host += book + revbook + par;  // mirrored on host
+            track(fp, h * codec_len);
+        }
+
+        fp.reserved = setup.dtype_nbyte * len / 2;
+        return fp;
+    }
+
+    /**
+     * @brief Whole field in one compressor: input on device, and on host the mapped field plus the archive copy.
+     */
+    footprint_t get_monolithic(dim3_compat field) const
+    {
+        auto fp  = get_workspace(field);
+        auto len = get_len(field);
+        fp.data  = setup.dtype_nbyte * square(len);
+        track(fp, fp.data);
+        fp.host += setup.dtype_nbyte * len + fp.reserved;
+        return fp;
+    }
+
+    footprint_t get_footprint(dim3_compat field, MemoryPlan::mode_t mode, dim3_compat brick) const
+    {
+        if (mode == MemoryPlan::MONOLITHIC) return get_monolithic(field);
+        return get_chunked(field, brick, mode == MemoryPlan::STREAMING);
+    }
+
+    /**
+     * @brief Monolithic if it fits, else chunked with the largest brick that fits, else streaming.
+     * @throw std::runtime_error if even the smallest streaming brick is over the cap
+     */
+    MemoryPlan plan(dim3_compat field) const
+    {
+        MemoryPlan p;
+        p.footprint = get_monolithic(field);
+        if (fits(p.footprint)) return p;
+
+        for (auto streaming : {false, true}) {
+            auto brick = search_brick(field, streaming);
+            if (brick.x == 0) continue;
+            p.mode      = streaming ? MemoryPlan::STREAMING : MemoryPlan::CHUNKED;
+            p.brick     = brick;
+            p.footprint = get_chunked(field, brick, streaming);
+            return p;
+        }
+        throw std::runtime_error(
+            "[planner] no execution fits in the memory cap of " + std::to_string(device_cap) + " (device), " +
+            std::to_string(host_cap) + " (host) bytes.");
+    }
+
+    /**
+     * @brief Streaming is asked for without a brick: the deepest slab brick that fits.
+     */
+    MemoryPlan plan_streaming(dim3_compat field) const
+    {
+        MemoryPlan p;
+        p.mode  = MemoryPlan::STREAMING;
+        p.brick = search_brick(field, true);
+        if (p.brick.x == 0) throw std::runtime_error("[planner] no slab fits in the memory cap.");
+        p.footprint = get_chunked(field, p.brick, true);
+        return p;
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -30,6 +30,8 @@
 
 #define ACCESSOR(SYM, TYPE) reinterpret_cast<TYPE*>(in_compressed + header.entry[HEADER::SYM])
 
+#define LEVEL_ACCESSOR(LEVEL, TYPE) reinterpret_cast<TYPE*>(in_compressed + header.entry[HEADER::SPFMT + LEVEL - 1])
+
 /******************************************************************************
                                class definition
 ******************************************************************************/
@@ -43,20 +45,26 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     using E    = typename Predictor::ErrCtrl;  // wrong in type inference
     using BYTE = uint8_t;                      // non-interpreted type; bytestream
 
+    static const int NLEVEL = Predictor::NLEVEL;
+
     unsigned int len;
     dim3         data_size;
 
     Predictor* predictor;
-    SpReducer* spreducer;
+    SpReducer* spreducer[NLEVEL];  // one per level, each sized to it
 
     BYTE* d_reserved_compressed{nullptr};
 
    public:
+    /*
+     * The error-control codes are in NLEVEL sparse segments, coarse to fine, following the anchors: a preview up to
+     * level l needs only the archive prefix of `get_preview_nbyte(header, l)` bytes.
+     */
     struct header_t {
         static const int HEADER = 0;
         static const int ANCHOR = 1;
-        static const int SPFMT  = 2;
-        static const int END    = 3;
+        static const int SPFMT  = 2;  // level 1; level l at SPFMT + l - 1
+        static const int END    = SPFMT + NLEVEL;
 
         int      header_nbyte : 16;
         uint32_t entry[END + 1];
@@ -69,7 +77,18 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     uint32_t get_data_len() { return data_size.x * data_size.y * data_size.z; }
     uint32_t get_anchor_len() { return predictor->get_anchor_len(); }
 
+    dim3 get_preview_size(int nlevel) { return predictor->get_preview_size(nlevel); }
+
+    static uint32_t get_preview_nbyte(HEADER const& header, int nlevel) { return header.entry[HEADER::SPFMT + nlevel]; }
+
    private:
+    float get_spreducer_time(int nlevel)
+    {
+        float time = 0;
+        for (auto l = 1; l <= nlevel; l++) time += spreducer[l - 1]->get_time_elapsed();
+        return time;
+    }
+
    public:
     SpPathCompressor() = default;
 
@@ -81,18 +100,18 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     void allocate_workspace(dim3 xyz, int dummy_coarse_pardeg = -1, int sp_factor = 4, bool dbg_print = false)
     {
         predictor = new Predictor(xyz);
-        spreducer = new SpReducer;
 
         data_size = xyz;
 
         (*predictor).allocate_workspace(/*TODO*/);
 
         // TODO encapsulate more
-        auto spreducer_in_len = (*predictor).get_quant_footprint();
-
-        (*spreducer).allocate_workspace(spreducer_in_len, sp_factor, dbg_print);
+        for (auto l = 1; l <= NLEVEL; l++) {
+            spreducer[l - 1] = new SpReducer;
+            (*spreducer[l - 1]).allocate_workspace((*predictor).get_level_footprint(l), sp_factor, dbg_print);
+        }
 
-        CHECK_CUDA(cudaMalloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
+        CHECK_CUDA(cusz::WorkspacePool::malloc(&d_reserved_compressed, (*predictor).get_data_len() * sizeof(T) / 2));
     }
 
     /**
@@ -115,8 +134,8 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     {
         T*     d_anchor{nullptr};
         E*     d_errctrl{nullptr};
-        BYTE*  d_spreducer_out{nullptr};
-        size_t spreducer_out_len{0};
+        BYTE*  d_spreducer_out[NLEVEL];
+        size_t spreducer_out_len[NLEVEL];
 
         HEADER header;
 
@@ -126,7 +145,7 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
             uint32_t nbyte[HEADER::END];
             nbyte[HEADER::HEADER] = 128;
             nbyte[HEADER::ANCHOR] = sizeof(T) * (*predictor).get_anchor_len();
-            nbyte[HEADER::SPFMT]  = sizeof(BYTE) * spreducer_out_len;
+            for (auto l = 1; l <= NLEVEL; l++) nbyte[HEADER::SPFMT + l - 1] = sizeof(BYTE) * spreducer_out_len[l - 1];
 
             header.entry[0] = 0;
             // *.END + 1; need to know the ending position
@@ -142,14 +161,22 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
             CHECK_CUDA(cudaMemcpyAsync(d_reserved_compressed, &header, sizeof(header), cudaMemcpyHostToDevice, stream));
 
             D2D_CPY(anchor, ANCHOR)
-            D2D_CPY(spreducer_out, SPFMT)
+            for (auto l = 1; l <= NLEVEL; l++) {
+                auto dst = d_reserved_compressed + header.entry[HEADER::SPFMT + l - 1];
+                CHECK_CUDA(cudaMemcpyAsync(
+                    dst, d_spreducer_out[l - 1], nbyte[HEADER::SPFMT + l - 1], cudaMemcpyDeviceToDevice, stream));
+            }
 
             /* debug */ CHECK_CUDA(cudaStreamSynchronize(stream));
         };
 
         (*predictor).construct(uncompressed, eb, radius, d_anchor, d_errctrl, stream);
-        auto spreducer_in_len = (*predictor).get_quant_footprint();
-        (*spreducer).gather(d_errctrl, spreducer_in_len, d_spreducer_out, spreducer_out_len, stream);
+        (*predictor).split_levels(stream);
+        for (auto l = 1; l <= NLEVEL; l++)
+            (*spreducer[l - 1])
+                .gather(
+                    (*predictor).expose_errctrl(l), (*predictor).get_level_footprint(l), d_spreducer_out[l - 1],
+                    spreducer_out_len[l - 1], stream);
 
         /* debug */ CHECK_CUDA(cudaStreamSynchronize(stream));
 
@@ -167,7 +194,7 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
             auto time_p = predictor->get_time_elapsed();
             auto tp_p   = byte_to_gbyte(bytes) / ms_to_s(time_p);
 
-            auto time_s = spreducer->get_time_elapsed();
+            auto time_s = get_spreducer_time(NLEVEL);
             auto tp_s   = byte_to_gbyte(bytes) / ms_to_s(time_s);
 
             auto tp_total = byte_to_gbyte(bytes) / ms_to_s(time_p + time_s);
@@ -190,52 +217,61 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     void clear_buffer()
     {  //
         (*predictor).clear_buffer();
-        (*spreducer).clear_buffer();
+        for (auto l = 1; l <= NLEVEL; l++) (*spreducer[l - 1]).clear_buffer();
     }
 
     /**
      * @brief High-level decompress method for this compressor
      *
-     * @param in_compressed device pointer, the cusz archive bianry
+     * @param in_compressed device pointer, the cusz archive bianry; for a preview, its prefix of
+     * `get_preview_nbyte(header, nlevel)` bytes suffices
      * @param eb host variable, error bound
      * @param radius host variable, in this case, it is 0
-     * @param out_decompressed device pointer, output decompressed data
+     * @param out_decompressed device pointer, output decompressed data, or the preview of `get_preview_size(nlevel)`
      * @param stream CUDA stream
+     * @param nlevel host variable, decode up to this level (0, anchors only, to NLEVEL, in full)
      */
     void decompress(
         BYTE*        in_compressed,
         double const eb,
         int const    radius,
         T*           out_decompressed,
-        cudaStream_t stream = nullptr)
+        cudaStream_t stream = nullptr,
+        int const    nlevel = NLEVEL)
     {
+        if (nlevel < 0 or nlevel > NLEVEL)
+            throw std::runtime_error("SpPathCompressor: level must be 0 to " + std::to_string(NLEVEL));
+
         HEADER header;
         CHECK_CUDA(cudaMemcpyAsync(&header, in_compressed, sizeof(header), cudaMemcpyDeviceToHost, stream));
         CHECK_CUDA(cudaStreamSynchronize(stream));
 
-        auto d_anchor       = ACCESSOR(ANCHOR, T);
-        auto d_spreducer_in = ACCESSOR(SPFMT, BYTE);
+        auto d_anchor = ACCESSOR(ANCHOR, T);
 
         auto d_errctrl = (*predictor).expose_quant();  // reuse
 
-        (*spreducer).scatter(d_spreducer_in, d_errctrl, stream);
-        (*predictor).reconstruct(d_anchor, d_errctrl, eb, radius, out_decompressed, stream);
+        for (auto l = 1; l <= nlevel; l++)
+            (*spreducer[l - 1]).scatter(LEVEL_ACCESSOR(l, BYTE), (*predictor).expose_errctrl(l), stream);
+        (*predictor).merge_levels(nlevel, stream);
+        (*predictor).reconstruct(d_anchor, d_errctrl, eb, radius, out_decompressed, stream, nlevel);
 
         auto decompress_report = [&]() {
             auto byte_to_gbyte = [&](double bytes) { return bytes / 1024 / 1024 / 1024; };
             auto ms_to_s       = [&](double ms) { return ms / 1000; };
 
-            auto bytes = get_data_len() * sizeof(T);
+            auto out_size = get_preview_size(nlevel);
+            auto bytes    = 1.0 * out_size.x * out_size.y * out_size.z * sizeof(T);
 
             auto time_p = predictor->get_time_elapsed();
             auto tp_p   = byte_to_gbyte(bytes) / ms_to_s(time_p);
 
-            auto time_s = spreducer->get_time_elapsed();
+            auto time_s = get_spreducer_time(nlevel);
             auto tp_s   = byte_to_gbyte(bytes) / ms_to_s(time_s);
 
             auto tp_total = byte_to_gbyte(bytes) / ms_to_s(time_p + time_s);
 
             printf("\n(d) deCOMPRESSION REPORT\n");
+            if (nlevel < NLEVEL) printf("%-*s: %d of %d\n", 20, "preview level", nlevel, NLEVEL);
             printf("%-*s: %4.3f ms\tthroughput  : %4.2f GiB/s\n", 20, "spreducer time", time_s, tp_s);
             printf("%-*s: %4.3f ms\tthroughput  : %4.2f GiB/s\n", 20, "predictor time", time_p, tp_p);
             printf("%-*s: %4.3f ms\tthroughput  : %4.2f GiB/s\n", 20, "total time", time_p + time_s, tp_total);
@@ -248,7 +284,8 @@ class SpPathCompressor : public BaseCompressor<typename BINDING::PREDICTOR> {
     ~SpPathCompressor()
     {
         delete predictor;
-        delete spreducer;
+        for (auto l = 1; l <= NLEVEL; l++) delete spreducer[l - 1];
+        if (d_reserved_compressed) cusz::WorkspacePool::free(d_reserved_compressed);
     }
 };
 
@@ -277,6 +314,7 @@ struct SparsityAwarePath {
     using FallbackCompressor = class SpPathCompressor<FallbackBinding>;
 };
 
+#undef LEVEL_ACCESSOR
 #undef ACCESSOR
 #undef D2D_CPY
 
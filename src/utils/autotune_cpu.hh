@@ -0,0 +1,189 @@
+/**
+ * @file autotune_cpu.hh
+ * @author Jiannan Tian
+ * @brief Host counterpart of AutoconfigHelper: derive Huffman sublen/pardeg from core count, L2 size and a
+ * calibration run of the host deflate.
+ * @version 0.3
+ * @date 2022-03-10
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef UTILS_AUTOTUNE_CPU_HH
+#define UTILS_AUTOTUNE_CPU_HH
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "../common/configs.hh"
+#include "../common/type_traits.hh"
+#include "../wrapper/huffman_coarse_cpu.hh"
+#include "timer.hh"
+
+struct HostAutoconfigHelper {
+    /**
+     * @brief what the tuner saw and decided; kept for reporting and reproducibility
+     *
+     */
+    struct record_t {
+        int    ncore{1};
+        size_t l2_nbyte{0};
+        double ns_per_symbol{0};
+        size_t sublen_lower{0}, sublen_upper{0};
+        int    sublen{0};
+        int    pardeg{0};
+    };
+
+    static int get_ncore()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        auto n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+#endif
+    }
+
+    static size_t get_l2_nbyte()
+    {
+        long nbyte = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        nbyte = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        if (nbyte > 0) return nbyte;
+
+        // fallback: sysfs reports e.g. "2048K"
+        std::ifstream ifs("/sys/devices/system/cpu/cpu0/cache/index2/size");
+        std::string   s;
+        if (ifs >> s and not s.empty()) {
+            auto unit = s.back();
+            nbyte     = std::atol(s.c_str());
+            if (unit == 'K') nbyte <<= 10;
+            if (unit == 'M') nbyte <<= 20;
+        }
+        return nbyte > 0 ? nbyte : (1 << 20);  // conservative default
+    }
+
+    /**
+     * @brief Time the single-thread host deflate on a synthetic, quant-code-like (peaked at radius) sample.
+     *
+     * @return nanoseconds per symbol; 0 if calibration failed
+     */
+    template <typename E, typename H>
+    static double calibrate(int booklen)
+    {
+        using Codec = cusz::cpu::HuffmanCoarse<E, H, uint32_t>;
+
+        auto const n      = HuffmanHelper::HOST_CALIBRATION_SIZE;
+        auto const radius = booklen / 2;
+
+        std::vector<E> sample(n);
+        uint32_t       seed = 0x2545F491;
+        for (auto i = 0; i < n; i++) {
+            seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;  // xorshift32
+            auto offset = __builtin_ctz(seed | (1u << 12));             // geometric, most mass near the center
+            sample[i]   = static_cast<E>(std::min(radius + ((seed >> 31) ? offset : -offset), booklen - 1));
+        }
+
+        std::vector<cusz::FREQ> freq(booklen);
+        std::vector<H>          book(booklen);
+        std::vector<uint8_t>    revbook(Codec::get_revbook_nbyte(booklen));
+        std::vector<H>          out(n);
+
+        try {
+            Codec::get_frequency(sample.data(), n, freq.data(), booklen);
+            Codec::build_codebook(freq.data(), booklen, book.data(), revbook.data());
+        }
+        catch (const std::runtime_error&) {
+            return 0;
+        }
+
+        double       best = 1e30;
+        host_timer_t t;
+        for (auto rep = 0; rep < 3; rep++) {
+            t.timer_start();
+            Codec::get_chunk_nbit(sample.data(), n, book.data());
+            Codec::deflate_chunk(sample.data(), n, book.data(), out.data());
+            t.timer_end();
+            best = std::min(best, t.get_time_elapsed());
+        }
+        return best * 1e9 / n;
+    }
+
+    /**
+     * @brief `calibrate()`, run once per process for each booklen; a given len thus always gets the same sublen,
+     * however the timing of a repeat would come out.
+     */
+    template <typename E, typename H>
+    static double get_ns_per_symbol(int booklen)
+    {
+        static std::mutex            mtx;
+        static std::map<int, double> measured;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto                        it = measured.find(booklen);
+        if (it == measured.end()) it = measured.emplace(booklen, calibrate<E, H>(booklen)).first;
+        return it->second;
+    }
+
+    /**
+     * @brief Chunk size is bounded
+     * (lower) by metadata overhead (2 x sizeof(M) per chunk vs. estimated output) and by per-chunk work
+     * that amortizes scheduling (from calibration);
+     * (upper) by L2 residency of a chunk's input and output, and by load balance (HOST_CHUNK_PER_CORE chunks per
+     * core). The largest sublen within bounds is taken; if the bounds conflict, the lower one wins.
+     *
+     * @param record if not null, what the tuner saw and decided
+     */
+    template <typename E = ErrCtrlTrait<2>::type, typename H = HuffTrait<4>::type, typename M = uint32_t>
+    static int tune_coarse_huffman_sublen(size_t len, int booklen, record_t* record = nullptr)
+    {
+        record_t r;
+        r.ncore         = get_ncore();
+        r.l2_nbyte      = get_l2_nbyte();
+        r.ns_per_symbol = get_ns_per_symbol<E, H>(booklen);
+
+        auto const est_bits_per_symbol = 2;  // typical for quant-codes at moderate eb
+        auto const meta_nbyte_per_chunk = 2 * sizeof(M);
+        auto const meta_bound =
+            meta_nbyte_per_chunk * 8 * 1000 / (est_bits_per_symbol * HuffmanHelper::HOST_META_PERMILLE);
+        auto const work_bound =
+            r.ns_per_symbol > 0 ? (size_t)(HuffmanHelper::HOST_MIN_CHUNK_US * 1000 / r.ns_per_symbol)
+                                : (size_t)HuffmanHelper::HOST_SUBLEN_FLOOR;
+        r.sublen_lower = std::max(meta_bound, work_bound);
+
+        auto const l2_bound      = r.l2_nbyte / (sizeof(E) + sizeof(H));
+        auto const balance_bound = ConfigHelper::get_npart(len, r.ncore * HuffmanHelper::HOST_CHUNK_PER_CORE);
+        r.sublen_upper           = std::min(l2_bound, balance_bound);
+
+        auto sublen = std::max(r.sublen_lower, r.sublen_upper);
+
+        // round down to a power of 2 (never below the lower bound); a short input takes one chunk, the smallest
+        // power of 2 that holds it
+        size_t p2 = 1;
+        while ((p2 << 1) <= sublen) p2 <<= 1;
+        if (p2 < r.sublen_lower) p2 <<= 1;
+        while (p2 > 1 and (p2 >> 1) >= len) p2 >>= 1;
+        sublen = p2;
+
+        r.sublen = sublen;
+        r.pardeg = ConfigHelper::get_npart(len, sublen);
+        if (record) *record = r;
+
+        return r.sublen;
+    }
+};
+
+#endif
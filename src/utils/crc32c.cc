@@ -0,0 +1,167 @@
+/**
+ * @file crc32c.cc
+ * @author Jiannan Tian
+ * @brief CRC32C implementation; built by the host compiler so that the SSE4.2 path can be target-specific.
+ * @version 0.3
+ * @date 2022-03-16
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include "crc32c.hh"
+
+#include <algorithm>
+#include <vector>
+
+#include "thread_pool.hh"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_X86
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+const uint32_t POLY = 0x82f63b78;  // reflected Castagnoli polynomial
+
+// slicing-by-8
+struct table_t {
+    uint32_t t[8][256];
+
+    table_t()
+    {
+        for (uint32_t n = 0; n < 256; n++) {
+            auto c = n;
+            for (auto k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+            t[0][n] = c;
+        }
+        for (uint32_t n = 0; n < 256; n++)
+            for (auto k = 1; k < 8; k++) t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+    }
+};
+
+const table_t& get_table()
+{
+    static const table_t table;
+    return table;
+}
+
+// a * b mod POLY, bit-reflected
+uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+// x^(n * 2^k) mod POLY
+uint32_t x2nmodp(size_t n, unsigned k)
+{
+    static const std::vector<uint32_t> x2n = [] {
+        std::vector<uint32_t> t(32);
+        t[0] = 1u << 30;  // x^1
+        for (auto i = 1; i < 32; i++) t[i] = multmodp(t[i - 1], t[i - 1]);
+        return t;
+    }();
+
+    uint32_t p = 1u << 31;  // x^0
+    while (n) {
+        if (n & 1) p = multmodp(x2n[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+#ifdef CRC32C_X86
+__attribute__((target("sse4.2"))) uint32_t extend_hw(uint32_t crc, const uint8_t* p, size_t nbyte)
+{
+    uint64_t c = ~crc;
+    for (; nbyte and (reinterpret_cast<uintptr_t>(p) & 7); nbyte--) c = _mm_crc32_u8(c, *p++);
+    for (; nbyte >= 8; nbyte -= 8, p += 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    for (; nbyte; nbyte--) c = _mm_crc32_u8(c, *p++);
+    return ~(uint32_t)c;
+}
+#endif
+
+const size_t PIECE_NBYTE = 1 << 20;  // per thread; below this, one thread
+
+}  // namespace
+
+namespace cusz {
+
+uint32_t CRC32C::extend_sw(uint32_t crc, const void* data, size_t nbyte)
+{
+    auto const& t = get_table().t;
+    auto        p = reinterpret_cast<const uint8_t*>(data);
+    uint32_t    c = ~crc;
+
+    for (; nbyte and (reinterpret_cast<uintptr_t>(p) & 7); nbyte--) c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+    for (; nbyte >= 8; nbyte -= 8, p += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= c;
+        c = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^  //
+            t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; nbyte; nbyte--) c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+    return ~c;
+}
+
+bool CRC32C::has_hw()
+{
+#ifdef CRC32C_X86
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+    return hw;
+#else
+    return false;
+#endif
+}
+
+uint32_t CRC32C::extend(uint32_t crc, const void* data, size_t nbyte)
+{
+#ifdef CRC32C_X86
+    if (has_hw()) return extend_hw(crc, reinterpret_cast<const uint8_t*>(data), nbyte);
+#endif
+    return extend_sw(crc, data, nbyte);
+}
+
+uint32_t CRC32C::combine(uint32_t crc_a, uint32_t crc_b, size_t len_b)
+{
+    return multmodp(x2nmodp(len_b, 3), crc_a) ^ crc_b;
+}
+
+uint32_t CRC32C::compute(const void* data, size_t nbyte)
+{
+    auto const npiece = (nbyte + PIECE_NBYTE - 1) / PIECE_NBYTE;
+    if (npiece <= 1) return extend(0, data, nbyte);
+
+    auto                  p = reinterpret_cast<const uint8_t*>(data);
+    std::vector<uint32_t> crc(npiece);
+
+    ThreadPool::get_default().parallel_for(npiece, [&](size_t first, size_t last, int) {
+        for (auto i = first; i < last; i++) {
+            auto begin = i * PIECE_NBYTE;
+            crc[i]     = extend(0, p + begin, std::min(PIECE_NBYTE, nbyte - begin));
+        }
+    });
+
+    auto c = crc[0];
+    for (size_t i = 1; i < npiece; i++) c = combine(c, crc[i], std::min(PIECE_NBYTE, nbyte - i * PIECE_NBYTE));
+    return c;
+}
+
+}  // namespace cusz
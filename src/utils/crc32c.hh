@@ -0,0 +1,96 @@
+/**
+ * @file crc32c.hh
+ * @author Jiannan Tian
+ * @brief CRC32C (Castagnoli), with the SSE4.2 instruction where available, and the per-segment archive checksums.
+ * @version 0.3
+ * @date 2022-03-16
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef UTILS_CRC32C_HH
+#define UTILS_CRC32C_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "../header.hh"
+
+namespace cusz {
+
+struct CRC32C {
+    /**
+     * @brief Continue `crc` over `data`; `extend(0, ...)` starts afresh. Uses the `crc32` instruction if the CPU has
+     * it (checked once at runtime), or slicing-by-8 tables otherwise.
+     *
+     */
+    static uint32_t extend(uint32_t crc, const void* data, size_t nbyte);
+
+    static uint32_t extend_sw(uint32_t crc, const void* data, size_t nbyte);
+
+    /**
+     * @brief CRC of A|B from crc(A), crc(B) and the length of B, in O(log len_b).
+     *
+     */
+    static uint32_t combine(uint32_t crc_a, uint32_t crc_b, size_t len_b);
+
+    /**
+     * @brief CRC of a large buffer: pieces checksummed on the host pool, then combined.
+     *
+     */
+    static uint32_t compute(const void* data, size_t nbyte);
+
+    static bool has_hw();
+};
+
+/**
+ * @brief Per-segment checksums of a (host) archive, in `cuszHEADER::crc`. The HEADER segment is checksummed with
+ * `crc[]` zeroed, so that the header itself is covered.
+ *
+ */
+struct ArchiveChecksum {
+    static uint32_t header_crc(const cuszHEADER& h)
+    {
+        auto copy = h;
+        memset(copy.crc, 0, sizeof(copy.crc));
+        return CRC32C::extend(0, &copy, sizeof(copy));
+    }
+
+    static void seal(uint8_t* archive)
+    {
+        auto h = reinterpret_cast<cuszHEADER*>(archive);
+        for (auto i = cuszHEADER::HEADER + 1; i < cuszHEADER::END; i++)
+            h->crc[i] = CRC32C::compute(archive + h->entry[i], h->entry[i + 1] - h->entry[i]);
+        h->has_crc                 = 1;
+        h->crc[cuszHEADER::HEADER] = header_crc(*h);
+    }
+
+    /**
+     * @brief Throw on the first mismatching segment; archives written without checksums pass as-is.
+     *
+     */
+    static void verify(const uint8_t* archive, size_t nbyte, const std::string& note = "archive")
+    {
+        if (nbyte < sizeof(cuszHEADER)) throw std::runtime_error(note + ": truncated header.");
+
+        cuszHEADER h;
+        memcpy(&h, archive, sizeof(h));
+        if (not h.has_crc) return;
+
+        const char* name[] = {"header", "anchor", "vle", "spformat"};
+        if (header_crc(h) != h.crc[cuszHEADER::HEADER])
+            throw std::runtime_error(note + ": checksum mismatch in segment header.");
+        if (h.file_size() > nbyte) throw std::runtime_error(note + ": truncated, expecting more bytes.");
+        for (auto i = cuszHEADER::HEADER + 1; i < cuszHEADER::END; i++)
+            if (CRC32C::compute(archive + h.entry[i], h.entry[i + 1] - h.entry[i]) != h.crc[i])
+                throw std::runtime_error(note + ": checksum mismatch in segment " + name[i] + ".");
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -4,8 +4,8 @@
 /**
  * @file io.hh
  * @author Jiannan Tian
- * @brief Read and write binary.
- * @version 0.2
+ * @brief Read and write binary; parallel positional I/O; memory-mapped input.
+ * @version 0.3
  * @date 2020-09-20
  * Created on 2019-08-27
  *
@@ -14,11 +14,233 @@
  *
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "thread_pool.hh"
 
 namespace io {
 
+/**
+ * @brief Positional I/O on a file split into ranges, each range a `pread`/`pwrite` issued by a worker of the host pool.
+ * Range boundaries sit at multiples of `RANGE_NBYTE` in file offset, so with `O_DIRECT` every range whose buffer is
+ * also aligned goes direct; the rest (the unaligned head/tail, or when the filesystem refuses) falls back to buffered.
+ *
+ */
+class PositionalFile {
+   public:
+    static const size_t ALIGN       = 4096;      // O_DIRECT granularity: offset, length and buffer address
+    static const size_t RANGE_NBYTE = 8 << 20;  // per request; large enough to keep each thread streaming
+    static const size_t MIN_NBYTE   = 32 << 20;  // below this, one call from one thread
+    static const size_t PIECE_NBYTE = 1 << 20;   // of a read that is reduced on the way, to fit in cache
+
+    enum mode_t { READ, WRITE };
+
+   private:
+    int         fd{-1}, fd_direct{-1};
+    std::string fname;
+
+    std::string errstr(const std::string& what) const
+    {
+        return "PositionalFile: " + what + " " + fname + " (" + std::strerror(errno) + ")";
+    }
+
+    static bool is_aligned(const void* p, size_t offset, size_t nbyte)
+    {
+        return reinterpret_cast<uintptr_t>(p) % ALIGN == 0 and offset % ALIGN == 0 and nbyte % ALIGN == 0;
+    }
+
+    // retry short transfers and EINTR; a direct transfer refused with EINVAL is redone buffered
+    template <bool WRITE_OP, typename PTR>
+    void transfer(PTR buf, size_t nbyte, size_t offset)
+    {
+        auto use_direct = fd_direct >= 0 and is_aligned(buf, offset, nbyte);
+        while (nbyte > 0) {
+            auto    f = use_direct ? fd_direct : fd;
+            ssize_t n = WRITE_OP ? ::pwrite(f, (const void*)buf, nbyte, offset) : ::pread(f, (void*)buf, nbyte, offset);
+            if (n < 0 and errno == EINTR) continue;
+            if (n < 0 and errno == EINVAL and use_direct) {
+                use_direct = false;
+                continue;
+            }
+            if (n < 0) throw std::runtime_error(errstr(WRITE_OP ? "fail to write" : "fail to read"));
+            if (n == 0) throw std::runtime_error("PositionalFile: unexpected end of " + fname);
+            buf += n, nbyte -= n, offset += n;
+        }
+    }
+
+    // `range(buf, nbyte, offset)` for each range, in parallel; the first error stops the others and is rethrown
+    template <typename PTR, typename RANGE>
+    void for_each_range(PTR buf, size_t nbyte, size_t offset, RANGE range)
+    {
+        if (nbyte < MIN_NBYTE) return range(buf, nbyte, offset);
+
+        // boundaries at multiples of RANGE_NBYTE in file offset; the first range runs up to the first boundary
+        size_t const first_boundary = (offset / RANGE_NBYTE + 1) * RANGE_NBYTE;
+        size_t const nrange         = (offset + nbyte - first_boundary - 1) / RANGE_NBYTE + 2;
+
+        cusz::ThreadPool::get_default().parallel_for(
+            nrange,
+            [&](size_t first, size_t last, int) {
+                for (auto r = first; r < last; r++) {
+                    auto begin = r == 0 ? offset : first_boundary + (r - 1) * RANGE_NBYTE;
+                    auto end   = std::min(offset + nbyte, r == 0 ? first_boundary : begin + RANGE_NBYTE);
+                    if (begin < end) range(buf + (begin - offset), end - begin, begin);
+                }
+            },
+            1);  // a range is a large request already
+    }
+
+    template <bool WRITE_OP, typename PTR>
+    void transfer_parallel(PTR buf, size_t nbyte, size_t offset)
+    {
+        for_each_range(buf, nbyte, offset, [&](PTR b, size_t n, size_t off) { transfer<WRITE_OP>(b, n, off); });
+    }
+
+    // a box as few runs as its shape allows: one if it spans whole planes, one per plane if whole rows, else per row
+    template <bool WRITE_OP, typename PTR>
+    void transfer_box(
+        PTR            buf,
+        size_t         dtype_nbyte,
+        const uint32_t field[3],
+        const uint32_t origin[3],
+        const uint32_t extent[3])
+    {
+        for (auto d = 0; d < 3; d++)
+            if (extent[d] == 0 or origin[d] + extent[d] > field[d])
+                throw std::runtime_error("PositionalFile: box out of the field in " + fname);
+
+        auto whole_row = extent[0] == field[0], whole_plane = whole_row and extent[1] == field[1];
+        auto run_len   = (size_t)extent[0] * (whole_row ? extent[1] : 1) * (whole_plane ? extent[2] : 1);
+        auto nrun      = (size_t)extent[1] * extent[2] / (run_len / extent[0]);
+        auto offset    = [&](size_t r) {
+            auto y = whole_row ? 0 : r % extent[1], z = whole_row ? r : r / extent[1];
+            return (((size_t)(origin[2] + z) * field[1] + origin[1] + y) * field[0] + origin[0]) * dtype_nbyte;
+        };
+        if (nrun == 1) return transfer_parallel<WRITE_OP>(buf, run_len * dtype_nbyte, offset(0));
+
+        cusz::ThreadPool::get_default().parallel_for(nrun, [&](size_t first, size_t last, int) {
+            for (auto r = first; r < last; r++)
+                transfer<WRITE_OP>(buf + r * run_len * dtype_nbyte, run_len * dtype_nbyte, offset(r));
+        });
+    }
+
+   public:
+    PositionalFile() = default;
+    PositionalFile(const std::string& fname, mode_t mode, bool direct = false) { open(fname, mode, direct); }
+
+    PositionalFile(const PositionalFile&) = delete;
+    PositionalFile& operator=(const PositionalFile&) = delete;
+
+    ~PositionalFile() { close(); }
+
+    void open(const std::string& _fname, mode_t mode, bool direct = false)
+    {
+        close();
+        fname      = _fname;
+        auto flags = mode == READ ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+        fd         = ::open(fname.c_str(), flags, 0644);
+        if (fd < 0) throw std::runtime_error(errstr("fail to open"));
+#ifdef O_DIRECT
+        // best effort; not every filesystem supports it (e.g., tmpfs)
+        if (direct) fd_direct = ::open(fname.c_str(), (mode == READ ? O_RDONLY : O_WRONLY) | O_DIRECT);
+#endif
+    }
+
+    void close()
+    {
+        if (fd >= 0) ::close(fd);
+        if (fd_direct >= 0) ::close(fd_direct);
+        fd = fd_direct = -1;
+    }
+
+    bool is_direct() const { return fd_direct >= 0; }
+
+    size_t size() const
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0) throw std::runtime_error(errstr("fail to stat"));
+        return st.st_size;
+    }
+
+    void read(void* buf, size_t nbyte, size_t offset = 0)
+    {
+        transfer_parallel<false>(reinterpret_cast<uint8_t*>(buf), nbyte, offset);
+    }
+
+    /**
+     * @brief `read()` that runs `fn(piece, piece_nbyte)` on each piece of at most `PIECE_NBYTE` right after it lands,
+     * on the thread that read it, while the piece is still in cache; e.g., to reduce the data on the way in rather
+     * than in a second pass. `fn` runs concurrently, on pieces in any order.
+     */
+    template <typename FN>
+    void read(void* buf, size_t nbyte, size_t offset, FN fn)
+    {
+        for_each_range(reinterpret_cast<uint8_t*>(buf), nbyte, offset, [&](uint8_t* b, size_t n, size_t off) {
+            for (size_t done = 0; done < n; done += PIECE_NBYTE) {
+                auto piece = n - done < PIECE_NBYTE ? n - done : PIECE_NBYTE;
+                transfer<false>(b + done, piece, off + done);
+                fn(b + done, piece);
+            }
+        });
+    }
+
+    void write(const void* buf, size_t nbyte, size_t offset = 0)
+    {
+        transfer_parallel<true>(reinterpret_cast<const uint8_t*>(buf), nbyte, offset);
+    }
+
+    /**
+     * @brief Box of `extent` at `origin` in a raw field of `field` elements (x-fastest), from or to `buf`, a dense
+     * array of `extent`; e.g., a brick of a chunked archive.
+     */
+    template <typename T>
+    void read_box(T* buf, const uint32_t field[3], const uint32_t origin[3], const uint32_t extent[3])
+    {
+        transfer_box<false>(reinterpret_cast<uint8_t*>(buf), sizeof(T), field, origin, extent);
+    }
+
+    template <typename T>
+    void write_box(const T* buf, const uint32_t field[3], const uint32_t origin[3], const uint32_t extent[3])
+    {
+        transfer_box<true>(reinterpret_cast<const uint8_t*>(buf), sizeof(T), field, origin, extent);
+    }
+};
+
+
+/**
+ * @brief Min and max of data pieces, merged in any order; e.g., the value range of a field for r2r, found as the field
+ * is read.
+ */
+template <typename T>
+struct value_range_t {
+    T min{std::numeric_limits<T>::max()}, max{std::numeric_limits<T>::lowest()};
+
+    void update(T const* a, size_t n)
+    {
+        T lo = min, hi = max;
+#pragma omp simd reduction(min : lo) reduction(max : hi)
+        for (size_t i = 0; i < n; i++) lo = a[i] < lo ? a[i] : lo, hi = a[i] > hi ? a[i] : hi;
+        min = lo, max = hi;
+    }
+
+    void merge(value_range_t const& b) { min = std::min(min, b.min), max = std::max(max, b.max); }
+
+    double get_rng() const { return (double)max - (double)min; }
+};
+
 template <typename T>
 T* read_binary_to_new_array(const std::string& fname, size_t dtype_len)
 {
@@ -36,24 +258,159 @@ T* read_binary_to_new_array(const std::string& fname, size_t dtype_len)
 template <typename T>
 void read_binary_to_array(const std::string& fname, T* _a, size_t dtype_len)
 {
-    std::ifstream ifs(fname.c_str(), std::ios::binary | std::ios::in);
-    if (!ifs.is_open()) {
+    PositionalFile f;
+    try {
+        f.open(fname, PositionalFile::READ);
+    }
+    catch (std::exception& e) {
         std::cerr << "fail to open " << fname << std::endl;
         exit(1);
     }
-    ifs.read(reinterpret_cast<char*>(_a), std::streamsize(dtype_len * sizeof(T)));
-    ifs.close();
+    f.read(_a, dtype_len * sizeof(T));
+}
+
+/**
+ * @brief Read `len` elements at element `offset` and find their value range, a piece at a time as they are read, so
+ * that r2r does not cost a second pass over the field.
+ */
+template <typename T>
+void read_with_range(PositionalFile& f, T* _a, size_t len, size_t offset, value_range_t<T>& range)
+{
+    // pieces hold whole elements: their boundaries are at the offset, or at multiples of PIECE_NBYTE or RANGE_NBYTE
+    std::mutex mtx;
+    f.read(_a, len * sizeof(T), offset * sizeof(T), [&](void* piece, size_t nbyte) {
+        value_range_t<T> r;
+        r.update(reinterpret_cast<T*>(piece), nbyte / sizeof(T));
+        std::lock_guard<std::mutex> lock(mtx);
+        range.merge(r);
+    });
+}
+
+template <typename T>
+void read_binary_to_array(const std::string& fname, T* _a, size_t dtype_len, value_range_t<T>& range)
+{
+    PositionalFile f;
+    try {
+        f.open(fname, PositionalFile::READ);
+    }
+    catch (std::exception& e) {
+        std::cerr << "fail to open " << fname << std::endl;
+        exit(1);
+    }
+    read_with_range(f, _a, dtype_len, 0, range);
 }
 
 template <typename T>
 void write_array_to_binary(const std::string& fname, T* const _a, size_t const dtype_len)
 {
-    std::ofstream ofs(fname.c_str(), std::ios::binary | std::ios::out);
-    if (!ofs.is_open()) return;
-    ofs.write(reinterpret_cast<const char*>(_a), std::streamsize(dtype_len * sizeof(T)));
-    ofs.close();
+    PositionalFile f;
+    try {
+        f.open(fname, PositionalFile::WRITE);
+    }
+    catch (std::exception& e) {
+        return;
+    }
+    f.write(_a, dtype_len * sizeof(T));
 }
 
+/**
+ * @brief Read-only, RAII memory mapping of a whole file. The mapped range is handed out as a pointer, so the data
+ * is paged in from the page cache on first touch instead of being copied into a separately allocated buffer.
+ *
+ */
+class MappedFile {
+   public:
+    struct hint_t {
+        bool sequential{true};  // MADV_SEQUENTIAL: aggressive read-ahead, pages dropped behind
+        bool hugepage{false};   // MADV_HUGEPAGE: fewer TLB misses, honored where the page cache supports it
+        bool populate{false};   // MAP_POPULATE: fault everything in at mmap(), trading latency for no later faults
+    };
+
+   private:
+    void*  addr{nullptr};
+    size_t nbyte{0};
+
+    static std::string errstr(const std::string& what, const std::string& fname)
+    {
+        return "MappedFile: " + what + " " + fname + " (" + std::strerror(errno) + ")";
+    }
+
+   public:
+    MappedFile() = default;
+    MappedFile(const std::string& fname, hint_t hint) { open(fname, hint); }
+    explicit MappedFile(const std::string& fname) { open(fname, hint_t()); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() { close(); }
+
+    void open(const std::string& fname, hint_t hint)
+    {
+        close();
+
+        auto fd = ::open(fname.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(errstr("fail to open", fname));
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error(errstr("fail to stat", fname));
+        }
+        nbyte = st.st_size;
+        if (nbyte == 0) {  // mmap() of zero length is an error; an empty mapping is not
+            ::close(fd);
+            return;
+        }
+
+        auto flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if (hint.populate) flags |= MAP_POPULATE;
+#endif
+        addr = mmap(nullptr, nbyte, PROT_READ, flags, fd, 0);
+        ::close(fd);  // the mapping holds its own reference
+        if (addr == MAP_FAILED) {
+            addr  = nullptr;
+            nbyte = 0;
+            throw std::runtime_error(errstr("fail to map", fname));
+        }
+
+        if (hint.sequential) madvise(addr, nbyte, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        if (hint.hugepage) madvise(addr, nbyte, MADV_HUGEPAGE);
+#endif
+    }
+
+    void close()
+    {
+        if (addr) munmap(addr, nbyte);
+        addr  = nullptr;
+        nbyte = 0;
+    }
+
+    size_t size() const { return nbyte; }
+
+    template <typename T = uint8_t>
+    const T* as() const
+    {
+        return reinterpret_cast<const T*>(addr);
+    }
+
+    /**
+     * @brief Check that the file holds at least `len` elements of `T` before it is interpreted as such.
+     *
+     */
+    template <typename T>
+    const T* as(size_t len, const std::string& note = "") const
+    {
+        if (nbyte < len * sizeof(T))
+            throw std::runtime_error(
+                "MappedFile: " + note + " has " + std::to_string(nbyte) + " bytes, expecting " +
+                std::to_string(len * sizeof(T)));
+        return as<T>();
+    }
+};
+
 }  // namespace io
 
 #endif  // IO_HH
@@ -0,0 +1,222 @@
+/**
+ * @file numa.hh
+ * @author Jiannan Tian
+ * @brief NUMA-aware placement of host arrays and thread pinning for the host thread pool.
+ * @version 0.3
+ * @date 2022-03-21
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_UTILS_NUMA_HH
+#define CUSZ_UTILS_NUMA_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "thread_pool.hh"
+
+namespace cusz {
+
+/**
+ * @brief Linux places a page on the node of the thread that first writes it. `new T[len]()` writes every page from
+ * the calling thread, so a later parallel loop runs half of its workers over remote memory on a dual-socket node.
+ * `allocate()` instead zero-fills on the workers of `cusz::ThreadPool::get_default()`, chunk by chunk, dealing chunks
+ * to workers as the compute loop does (see `for_each_chunk()`), so that each worker finds its chunks local; or
+ * interleaves pages over all nodes, for arrays accessed without a fixed decomposition. Workers must stay where they
+ * touched: see `pin_threads()`.
+ *
+ * Without Linux, placement falls back to a plain zero-filled allocation.
+ */
+struct NumaHelper {
+    enum policy_t {
+        SERIAL,       // as `new T[len]()`: all pages on the node of the calling thread
+        FIRST_TOUCH,  // chunk i on the node of the thread that runs chunk i
+        INTERLEAVE    // pages round-robin over all nodes
+    };
+
+    /**
+     * @brief Online NUMA nodes, as listed in sysfs, e.g., "0-1" or "0,2-3"; node ids beyond 63 are ignored.
+     */
+    static uint64_t get_node_mask()
+    {
+        std::ifstream ifs("/sys/devices/system/node/online");
+        std::string   list;
+        if (not(ifs >> list)) return 1;
+
+        uint64_t mask = 0;
+        size_t   pos  = 0;
+        while (pos < list.size()) {
+            auto end   = list.find(',', pos);
+            auto range = list.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            auto dash  = range.find('-');
+            auto first = std::stoi(range.substr(0, dash));
+            auto last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (auto n = first; n <= last and n < 64; n++) mask |= 1ull << n;
+            if (end == std::string::npos) break;
+            pos = end + 1;
+        }
+        return mask ? mask : 1;
+    }
+
+    static int get_nnode() { return __builtin_popcountll(get_node_mask()); }
+
+    /**
+     * @brief Zero-filled array of `len`, placed by `policy`; free with `deallocate()`.
+     *
+     * @param chunk_len elements per unit of work of the compute loop, e.g., one slab
+     * @param cyclic chunks are dealt to workers one at a time in turn; otherwise in contiguous runs
+     */
+    template <typename T>
+    static T* allocate(size_t len, policy_t policy = FIRST_TOUCH, size_t chunk_len = 0, bool cyclic = false)
+    {
+        return allocate_with<T>(len, policy, [&](T* a) { first_touch(a, len, chunk_len, cyclic); });
+    }
+
+    /**
+     * @brief As `allocate()`, for a compute loop whose units are not contiguous, e.g., blocks of a 3D field: under
+     * FIRST_TOUCH, `touch(a)` zero-fills `a` as the loop maps its units to workers.
+     */
+    template <typename T, typename TOUCH>
+    static T* allocate_with(size_t len, policy_t policy, TOUCH touch)
+    {
+        auto nbyte = std::max(sizeof(T) * len, (size_t)1);
+#ifdef __linux__
+        // pages are not backed until touched
+        auto p = mmap(nullptr, nbyte, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+
+        auto mask = get_node_mask();
+        if (policy == INTERLEAVE and __builtin_popcountll(mask) > 1) {
+            int const MPOL_INTERLEAVE_ = 3;  // <numaif.h>, without depending on libnuma
+            syscall(SYS_mbind, p, nbyte, MPOL_INTERLEAVE_, &mask, 65, 0);  // best effort, as placement is a hint
+        }
+#else
+        auto p = ::operator new(nbyte);
+#endif
+        auto a = static_cast<T*>(p);
+        if (policy == FIRST_TOUCH)
+            touch(a);
+        else
+            memset(a, 0, sizeof(T) * len);  // mmap'ed pages are zero already; the write is what places them
+        return a;
+    }
+
+    template <typename T>
+    static void deallocate(T* a, size_t len)
+    {
+        if (not a) return;
+#ifdef __linux__
+        munmap(a, std::max(sizeof(T) * len, (size_t)1));
+#else
+        ::operator delete(a);
+#endif
+    }
+
+    /**
+     * @brief Run `fn(i)` for chunks 0 to `nchunk - 1` on the default pool, chunk i always on the same worker: in
+     * contiguous runs of about `nchunk / nworker`, or, if `cyclic`, on worker `i % nworker`. A loop over the chunks of
+     * an array placed by `first_touch()` with the same `cyclic` thus finds every chunk local. Not from within a loop
+     * of the pool.
+     */
+    template <typename FN>
+    static void for_each_chunk(size_t nchunk, FN fn, bool cyclic = false)
+    {
+        auto& pool    = ThreadPool::get_default();
+        auto  nworker = (size_t)pool.get_nworker();
+        pool.for_each_worker([&](int w) {
+            if (cyclic)
+                for (auto i = (size_t)w; i < nchunk; i += nworker) fn(i);
+            else
+                for (auto i = nchunk * w / nworker; i < nchunk * (w + 1) / nworker; i++) fn(i);
+        });
+    }
+
+    /**
+     * @brief Zero-fill `a` in chunks of `chunk_len`, with the worker-to-chunk mapping of `for_each_chunk()`.
+     */
+    template <typename T>
+    static void first_touch(T* a, size_t len, size_t chunk_len = 0, bool cyclic = false)
+    {
+        if (len == 0) return;
+        if (chunk_len == 0) chunk_len = len;
+        for_each_chunk(
+            (len - 1) / chunk_len + 1,
+            [&](size_t i) {
+                auto begin = i * chunk_len;
+                memset(a + begin, 0, sizeof(T) * std::min(chunk_len, len - begin));
+            },
+            cyclic);
+    }
+
+    /**
+     * @brief Pin the calling thread to the `i`-th CPU of the process's allowed set (wrapping around).
+     */
+    static bool pin_current_thread(int i)
+    {
+#ifdef __linux__
+        auto const& cpus = get_allowed_cpus();
+        if (cpus.empty()) return false;
+
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[i % cpus.size()], &one);
+        return sched_setaffinity(0, sizeof(one), &one) == 0;  // 0: the calling thread
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Pin each worker of the default pool to one CPU of the process's allowed set, worker w to the w-th CPU
+     * (wrapping around), so that neighboring chunks stay on the same socket and a worker does not migrate away from
+     * the pages it touched. Call before the first array is placed; the calling thread stays pinned as worker 0.
+     *
+     * @return number of workers pinned
+     */
+    static int pin_threads()
+    {
+        if (get_allowed_cpus().empty()) return 0;
+
+        std::atomic<int> npinned{0};
+        ThreadPool::get_default().for_each_worker([&](int w) { npinned += pin_current_thread(w); });
+        return npinned;
+    }
+
+   private:
+    // as of the first call, before any pinning narrows the mask that new threads inherit
+    static std::vector<int> const& get_allowed_cpus()
+    {
+        static std::vector<int> const cpus = []() {
+            std::vector<int> list;
+#ifdef __linux__
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return list;
+            for (auto c = 0; c < CPU_SETSIZE; c++)
+                if (CPU_ISSET(c, &allowed)) list.push_back(c);
+#endif
+            return list;
+        }();
+        return cpus;
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file pipeline.hh
+ * @author Jiannan Tian
+ * @brief Bounded queue and stage thread for overlapping host I/O with compression.
+ * @version 0.3
+ * @date 2022-03-15
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef UTILS_PIPELINE_HH
+#define UTILS_PIPELINE_HH
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace cusz {
+
+/**
+ * @brief Blocking FIFO of bounded capacity; a full queue stalls the producer, which is what bounds memory.
+ * `close()` wakes everyone up: pending items can still be popped, pushes are refused.
+ *
+ */
+template <typename T>
+class BoundedQueue {
+   private:
+    std::deque<T>           q;
+    size_t                  capacity;
+    bool                    closed{false};
+    std::mutex              mtx;
+    std::condition_variable not_full, not_empty;
+
+   public:
+    explicit BoundedQueue(size_t _capacity) : capacity(_capacity) {}
+
+    /**
+     * @return false if the queue is closed, and the item is dropped
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [&] { return closed or q.size() < capacity; });
+        if (closed) return false;
+        q.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * @return false if the queue is closed and drained
+     */
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [&] { return closed or not q.empty(); });
+        if (q.empty()) return false;
+        item = std::move(q.front());
+        q.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+};
+
+/**
+ * @brief A pipeline stage on its own thread. An exception thrown by the stage is kept and rethrown from `join()`;
+ * `on_exit` runs either way (typically, closing the queues the stage talks to, so that no neighbor blocks forever).
+ *
+ */
+class PipelineStage {
+   private:
+    std::thread        th;
+    std::exception_ptr err{nullptr};
+
+   public:
+    PipelineStage(std::function<void()> body, std::function<void()> on_exit)
+    {
+        th = std::thread([this, body, on_exit] {
+            try {
+                body();
+            }
+            catch (...) {
+                err = std::current_exception();
+            }
+            on_exit();
+        });
+    }
+
+    ~PipelineStage()
+    {
+        if (th.joinable()) th.join();
+    }
+
+    void join()
+    {
+        if (th.joinable()) th.join();
+        if (err) std::rethrow_exception(err);
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -12,6 +12,7 @@
 #ifndef CUSZ_UTILS_STRHELPER_HH
 #define CUSZ_UTILS_STRHELPER_HH
 
+#include <cmath>
 #include <iostream>
 #include <regex>
 #include <sstream>
@@ -72,6 +73,24 @@ struct StrHelper {
         return res;
     };
 
+    /**
+     * @brief size in bytes, with an optional binary suffix: K, M, G or T, e.g., "512M", "1.5G"
+     */
+    static size_t str2nbyte(std::string s)
+    {
+        char*             end;
+        auto              res   = std::strtod(s.c_str(), &end);
+        std::string const units = "KMGT";
+        auto              unit  = *end ? units.find(toupper(*end)) : std::string::npos;
+        if (unit != std::string::npos) res *= std::pow(1024.0, unit + 1), end++;
+        if (*end == 'B' or *end == 'b') end++;
+        if (*end or res < 0) {
+            const char* notif = "invalid option value, non-convertible part: ";
+            cerr << LOG_ERR << notif << "\e[1m" << s << "\e[0m" << endl;
+        }
+        return static_cast<size_t>(res);
+    }
+
     static bool is_kv_pair(std::string s) { return s.find("=") != std::string::npos; }
 
     static std::pair<std::string, std::string> separate_kv(std::string& s)
@@ -0,0 +1,258 @@
+/**
+ * @file task_graph.hh
+ * @author Jiannan Tian
+ * @brief Dependency-driven executor for the host compression stages, with a trace of what ran when.
+ * @version 0.3
+ * @date 2022-03-23
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_UTILS_TASK_GRAPH_HH
+#define CUSZ_UTILS_TASK_GRAPH_HH
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cusz {
+
+/**
+ * @brief A stage of a chunk is a node, e.g., "predict" of slab 3, that runs once all nodes it depends on are done.
+ * Chunks thus move through the stages on their own: the histogram of chunk k runs beside the prediction of chunk
+ * k + 1, rather than after a barrier at the end of the prediction of every chunk. Of the nodes that are ready, the
+ * one added first runs first, so that chunks flow in order and the field is not predicted ahead of the encoder.
+ *
+ * A node depends only on nodes added before it, so the graph is acyclic by construction. As in `WorkStealingPool`,
+ * a worker is the same thread for the whole run (the calling thread is worker 0), and an exception thrown by a node
+ * stops the run and is rethrown from `run()`.
+ *
+ * Every run is traced; `get_overlap()` tells how long two stages ran at once, and `write_chrome_trace()` dumps the
+ * trace for chrome://tracing or Perfetto.
+ */
+class TaskGraph {
+   public:
+    using node_t  = size_t;
+    using body_fn = std::function<void(int worker)>;
+
+    struct event_t {
+        std::string stage;
+        uint32_t    index;  // e.g., the chunk
+        int         worker;
+        double      start, end;  // seconds since the start of the run
+    };
+
+   private:
+    struct node_info_t {
+        std::string         stage;
+        uint32_t            index;
+        body_fn             body;
+        size_t              ndep;
+        std::vector<node_t> succ;
+    };
+
+    std::vector<node_info_t> nodes;
+    std::vector<event_t>     trace;
+    double                   makespan{0};
+
+    // union of the intervals of `stage`, sorted and disjoint
+    std::vector<std::pair<double, double>> get_busy_intervals(std::string const& stage) const
+    {
+        std::vector<std::pair<double, double>> iv, merged;
+        for (auto const& e : trace)
+            if (e.stage == stage) iv.emplace_back(e.start, e.end);
+        std::sort(iv.begin(), iv.end());
+        for (auto const& i : iv) {
+            if (merged.empty() or i.first > merged.back().second)
+                merged.push_back(i);
+            else
+                merged.back().second = std::max(merged.back().second, i.second);
+        }
+        return merged;
+    }
+
+   public:
+    /**
+     * @param stage name of the stage, shared by the chunks
+     * @param index chunk, or any label within the stage
+     * @param body runs on one worker
+     * @param deps nodes to wait for, all added before
+     */
+    node_t add(std::string stage, uint32_t index, body_fn body, std::vector<node_t> const& deps = {})
+    {
+        auto id = nodes.size();
+        for (auto d : deps) {
+            if (d >= id) throw std::runtime_error("TaskGraph: a node depends on an unknown or later node.");
+            nodes[d].succ.push_back(id);
+        }
+        nodes.push_back({std::move(stage), index, std::move(body), deps.size(), {}});
+        return id;
+    }
+
+    void clear() { nodes.clear(), trace.clear(), makespan = 0; }
+
+    size_t get_nnode() const { return nodes.size(); }
+
+    void run(int nworker)
+    {
+        if (nworker < 1) throw std::runtime_error("TaskGraph: at least one worker.");
+
+        std::vector<size_t> pending(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) pending[i] = nodes[i].ndep;
+
+        std::priority_queue<node_t, std::vector<node_t>, std::greater<node_t>> ready;
+        for (size_t i = 0; i < nodes.size(); i++)
+            if (pending[i] == 0) ready.push(i);
+
+        std::mutex              mtx;
+        std::condition_variable cv;
+        size_t                  ndone = 0;
+        bool                    stop  = false;
+        std::exception_ptr      err{nullptr};
+
+        std::vector<std::vector<event_t>> events(nworker);
+        auto const                        t0      = std::chrono::steady_clock::now();
+        auto                              elapsed = [&]() {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        };
+
+        auto work = [&](int w) {
+            while (true) {
+                node_t id;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cv.wait(lock, [&]() { return stop or ndone == nodes.size() or not ready.empty(); });
+                    if (stop or ready.empty()) return;
+                    id = ready.top(), ready.pop();
+                }
+
+                auto& node  = nodes[id];
+                auto  start = elapsed();
+                try {
+                    node.body(w);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (not err) err = std::current_exception();
+                    stop = true;
+                    cv.notify_all();
+                    return;
+                }
+                events[w].push_back({node.stage, node.index, w, start, elapsed()});
+
+                std::lock_guard<std::mutex> lock(mtx);
+                for (auto s : node.succ)
+                    if (--pending[s] == 0) ready.push(s);
+                ndone++;
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (auto w = 1; w < nworker; w++) threads.emplace_back(work, w);
+        work(0);  // the calling thread is worker 0
+        for (auto& th : threads) th.join();
+
+        makespan = elapsed();
+        trace.clear();
+        for (auto const& e : events) trace.insert(trace.end(), e.begin(), e.end());
+        std::sort(trace.begin(), trace.end(), [](event_t const& a, event_t const& b) { return a.start < b.start; });
+
+        if (err) std::rethrow_exception(err);
+    }
+
+    // of the last run, in seconds
+    std::vector<event_t> const& get_trace() const { return trace; }
+    double                      get_makespan() const { return makespan; }
+
+    // summed over the nodes of `stage`, or of all stages if empty
+    double get_busy(std::string const& stage = "") const
+    {
+        double busy = 0;
+        for (auto const& e : trace)
+            if (stage.empty() or e.stage == stage) busy += e.end - e.start;
+        return busy;
+    }
+
+    // wall time during which a node of `a` and a node of `b` ran at once
+    double get_overlap(std::string const& a, std::string const& b) const
+    {
+        auto   ia = get_busy_intervals(a), ib = get_busy_intervals(b);
+        double overlap = 0;
+        for (size_t i = 0, j = 0; i < ia.size() and j < ib.size();) {
+            overlap += std::max(0.0, std::min(ia[i].second, ib[j].second) - std::max(ia[i].first, ib[j].first));
+            ia[i].second < ib[j].second ? i++ : j++;
+        }
+        return overlap;
+    }
+
+    // stages in the order they first ran
+    std::vector<std::string> get_stages() const
+    {
+        std::vector<std::string> stages;
+        for (auto const& e : trace)
+            if (std::find(stages.begin(), stages.end(), e.stage) == stages.end()) stages.push_back(e.stage);
+        return stages;
+    }
+
+    /**
+     * @brief Per stage, the number of nodes, busy time and span; then the stage pairs that overlapped, and the
+     * average number of busy workers.
+     */
+    void print_summary(std::ostream& os) const
+    {
+        auto stages = get_stages();
+        for (auto const& s : stages) {
+            size_t n     = 0;
+            double first = makespan, last = 0;
+            for (auto const& e : trace)
+                if (e.stage == s) n++, first = std::min(first, e.start), last = std::max(last, e.end);
+            os << "stage " << s << "\tnodes=" << n << "\tbusy=" << get_busy(s) * 1000 << " ms"
+               << "\tspan=[" << first * 1000 << ", " << last * 1000 << "] ms\n";
+        }
+        for (size_t i = 0; i < stages.size(); i++)
+            for (size_t j = i + 1; j < stages.size(); j++) {
+                auto overlap = get_overlap(stages[i], stages[j]);
+                if (overlap > 0)
+                    os << "overlap " << stages[i] << " | " << stages[j] << "\t" << overlap * 1000 << " ms\n";
+            }
+        os << "makespan " << makespan * 1000 << " ms\tbusy workers " << (makespan > 0 ? get_busy() / makespan : 0)
+           << " on average\n";
+    }
+
+    /**
+     * @brief The trace in the Trace Event Format, one row per worker.
+     */
+    void write_chrome_trace(std::string const& fname) const
+    {
+        std::ofstream ofs(fname);
+        if (not ofs) throw std::runtime_error("TaskGraph: cannot open " + fname);
+
+        ofs << "[";
+        for (size_t i = 0; i < trace.size(); i++) {
+            auto const& e = trace[i];
+            ofs << (i ? ",\n" : "\n") << "{\"name\":\"" << e.stage << " " << e.index << "\",\"cat\":\"" << e.stage
+                << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.worker << ",\"ts\":" << e.start * 1e6
+                << ",\"dur\":" << (e.end - e.start) * 1e6 << "}";
+        }
+        ofs << "\n]\n";
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * @file thread_pool.hh
+ * @author Jiannan Tian
+ * @brief Persistent host thread pool with dynamically scheduled, chunked parallel loops.
+ * @version 0.3
+ * @date 2022-03-24
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_UTILS_THREAD_POOL_HH
+#define CUSZ_UTILS_THREAD_POOL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace cusz {
+
+/**
+ * @brief Workers are started once and wait between loops, instead of a team forked per `#pragma omp parallel for`.
+ * A loop is a flat index space [0, n), e.g., all blocks of a field, claimed `grain` indices at a time by whichever
+ * worker is free; a 3D field split only along its few z-blocks thus still keeps every worker busy. The calling thread
+ * is worker 0; `worker` is stable within a loop, so per-worker state needs no locking.
+ *
+ * A loop started from within a loop runs serially on the calling worker, with its worker id. Loops from different
+ * threads take turns. An exception thrown by the body stops the loop (indices not yet claimed are skipped) and is
+ * rethrown to the caller.
+ */
+class ThreadPool {
+   public:
+    using range_fn  = std::function<void(size_t begin, size_t end, int worker)>;
+    using worker_fn = std::function<void(int worker)>;
+
+   private:
+    int                      nworker;
+    std::vector<std::thread> threads;
+
+    std::mutex              run_mtx;  // one loop at a time
+    std::mutex              mtx;
+    std::condition_variable cv_start, cv_done;
+    size_t                  generation{0};
+    int                     nbusy{0};
+    bool                    quit{false};
+
+    // the current loop
+    range_fn            body;
+    worker_fn           each;  // instead of `body`: once per worker
+    size_t              n{0}, grain{1};
+    std::atomic<size_t> next{0};
+    std::exception_ptr  err{nullptr};
+
+    // of the calling thread, while it runs a loop; -1 otherwise
+    static int& current_worker()
+    {
+        static thread_local int w = -1;
+        return w;
+    }
+
+    void work(int w)
+    {
+        current_worker() = w;
+        try {
+            if (each)
+                each(w);
+            else
+                for (auto begin = next.fetch_add(grain); begin < n; begin = next.fetch_add(grain))
+                    body(begin, std::min(n, begin + grain), w);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (not err) err = std::current_exception();
+            next = n;  // the others stop at their next claim
+        }
+        current_worker() = -1;
+    }
+
+    void loop(int w)
+    {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_start.wait(lock, [&]() { return quit or generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            work(w);
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--nbusy == 0) cv_done.notify_one();
+        }
+    }
+
+    void launch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            err   = nullptr;
+            nbusy = nworker - 1;
+            generation++;
+        }
+        cv_start.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_done.wait(lock, [&]() { return nbusy == 0; });
+        body = nullptr, each = nullptr;
+        if (err) std::rethrow_exception(err);
+    }
+
+   public:
+    // OMP_NUM_THREADS if set, as the OpenMP loops this replaces; otherwise a worker per hardware thread
+    static int get_default_nworker()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return std::max(1u, std::thread::hardware_concurrency());
+#endif
+    }
+
+    explicit ThreadPool(int _nworker = get_default_nworker()) : nworker(_nworker)
+    {
+        if (nworker < 1) throw std::runtime_error("ThreadPool: at least one worker.");
+        for (auto w = 1; w < nworker; w++) threads.emplace_back(&ThreadPool::loop, this, w);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            quit = true;
+        }
+        cv_start.notify_all();
+        for (auto& th : threads) th.join();
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    // shared by the host stages
+    static ThreadPool& get_default()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    int get_nworker() const { return nworker; }
+
+    /**
+     * @param _n indices are 0 to `_n - 1`
+     * @param fn runs [begin, end) on one worker
+     * @param _grain indices per claim; 0 for about 16 claims per worker, to balance uneven indices
+     */
+    void parallel_for(size_t _n, range_fn fn, size_t _grain = 0)
+    {
+        if (_n == 0) return;
+        if (_grain == 0) _grain = std::max<size_t>(1, _n / (16 * nworker));
+        if (current_worker() >= 0) return fn(0, _n, current_worker());
+        if (nworker == 1) return fn(0, _n, 0);
+
+        std::lock_guard<std::mutex> run_lock(run_mtx);
+        body = std::move(fn), n = _n, grain = _grain, next = 0;
+        launch();
+    }
+
+    /**
+     * @brief Run `fn(w)` once on each worker w, e.g., to first-touch or pin per-worker state.
+     */
+    void for_each_worker(worker_fn fn)
+    {
+        if (current_worker() >= 0) throw std::runtime_error("ThreadPool: for_each_worker() within a loop.");
+        if (nworker == 1) return fn(0);
+
+        std::lock_guard<std::mutex> run_lock(run_mtx);
+        each = std::move(fn);
+        launch();
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -14,79 +14,232 @@
  *
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <limits>
 #include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
-#include "../common.hh"
+#include "../common/types.hh"
 #include "format.hh"
+#include "io.hh"
+#include "thread_pool.hh"
 
 using namespace std;
 
 namespace analysis {
 
+/**
+ * @brief Mergeable partial of the quality metrics over a contiguous range. Moments are kept about the range mean
+ * (mean, sum of squared deviations, co-deviation), so that two ranges merge exactly as in Chan et al.'s parallel
+ * Welford update, without the cancellation of a raw sum of squares over a large field.
+ */
+struct moments_t {
+    size_t n{0};
+    double mean_o{0}, mean_x{0};
+    double m2_o{0}, m2_x{0}, c_ox{0};  // sum of (o - mean_o)^2, (x - mean_x)^2, (o - mean_o)(x - mean_x)
+    double err2{0};
+    double min_o{std::numeric_limits<double>::max()}, max_o{std::numeric_limits<double>::lowest()};
+    double min_x{std::numeric_limits<double>::max()}, max_x{std::numeric_limits<double>::lowest()};
+    double max_abserr{-1}, max_pwrrel_abserr{0};
+    size_t max_abserr_index{0};
+
+    /**
+     * @brief Of [begin, end) in one pass. The sums are taken about the first pair of the range, which is close to
+     * the range mean for smooth fields, and vectorize; the index of the max error is then found in the range, while
+     * it is still in cache.
+     */
+    template <typename T>
+    static moments_t of(T const* xdata, T const* odata, size_t begin, size_t end)
+    {
+        moments_t m;
+        m.n = end - begin;
+        if (m.n == 0) return m;
+
+        double const k_o = odata[begin], k_x = xdata[begin];
+        double       s_o = 0, s_x = 0, s_oo = 0, s_xx = 0, s_ox = 0, err2 = 0;
+        double       min_o = k_o, max_o = k_o, min_x = k_x, max_x = k_x, max_err = 0, max_rel = 0;
+
+#pragma omp simd reduction(+ : s_o, s_x, s_oo, s_xx, s_ox, err2) reduction(min : min_o, min_x) \
+    reduction(max : max_o, max_x, max_err, max_rel)
+        for (size_t i = begin; i < end; i++) {
+            double o = odata[i], x = xdata[i];
+            double d_o = o - k_o, d_x = x - k_x, err = fabs(x - o);
+            s_o += d_o, s_x += d_x, s_oo += d_o * d_o, s_xx += d_x * d_x, s_ox += d_o * d_x;
+            err2 += err * err;
+            min_o = o < min_o ? o : min_o, max_o = o > max_o ? o : max_o;
+            min_x = x < min_x ? x : min_x, max_x = x > max_x ? x : max_x;
+            max_err = err > max_err ? err : max_err;
+            double rel = o != 0 ? err / fabs(o) : 0;
+            max_rel    = rel > max_rel ? rel : max_rel;
+        }
+
+        m.mean_o = k_o + s_o / m.n, m.mean_x = k_x + s_x / m.n;
+        m.m2_o = s_oo - s_o * s_o / m.n, m.m2_x = s_xx - s_x * s_x / m.n, m.c_ox = s_ox - s_o * s_x / m.n;
+        m.err2  = err2;
+        m.min_o = min_o, m.max_o = max_o, m.min_x = min_x, m.max_x = max_x;
+        m.max_abserr = max_err, m.max_pwrrel_abserr = max_rel;
+
+        m.max_abserr_index = begin;
+        for (size_t i = begin; i < end; i++)
+            if (fabs((double)xdata[i] - odata[i]) == max_err) {
+                m.max_abserr_index = i;
+                break;
+            }
+        return m;
+    }
+
+    /**
+     * @brief Fold in `b`, a disjoint range; of equal max errors, the smaller index is kept, so that the index does
+     * not depend on the order of the merges.
+     */
+    void merge(moments_t const& b)
+    {
+        if (b.n == 0) return;
+        if (n == 0) {
+            *this = b;
+            return;
+        }
+        double na = n, nb = b.n, nn = na + nb;
+        double d_o = b.mean_o - mean_o, d_x = b.mean_x - mean_x;
+
+        m2_o += b.m2_o + d_o * d_o * na * nb / nn;
+        m2_x += b.m2_x + d_x * d_x * na * nb / nn;
+        c_ox += b.c_ox + d_o * d_x * na * nb / nn;
+        mean_o += d_o * nb / nn, mean_x += d_x * nb / nn;
+        n += b.n;
+        err2 += b.err2;
+
+        min_o = std::min(min_o, b.min_o), max_o = std::max(max_o, b.max_o);
+        min_x = std::min(min_x, b.min_x), max_x = std::max(max_x, b.max_x);
+        if (b.max_abserr > max_abserr or (b.max_abserr == max_abserr and b.max_abserr_index < max_abserr_index))
+            max_abserr = b.max_abserr, max_abserr_index = b.max_abserr_index;
+        max_pwrrel_abserr = std::max(max_pwrrel_abserr, b.max_pwrrel_abserr);
+    }
+
+    void to_stat(stat_t* stat) const
+    {
+        stat->len = n;
+
+        stat->max_odata = max_o;
+        stat->min_odata = min_o;
+        stat->rng_odata = max_o - min_o;
+        stat->std_odata = sqrt(m2_o / n);
+
+        stat->max_xdata = max_x;
+        stat->min_xdata = min_x;
+        stat->rng_xdata = max_x - min_x;
+        stat->std_xdata = sqrt(m2_x / n);
+
+        stat->max_abserr_index  = max_abserr_index;
+        stat->max_abserr        = max_abserr;
+        stat->max_abserr_vs_rng = max_abserr / stat->rng_odata;
+        stat->max_pwrrel_abserr = max_pwrrel_abserr;
+
+        stat->coeff = c_ox / sqrt(m2_o * m2_x);
+        stat->MSE   = err2 / n;
+        stat->NRMSE = sqrt(stat->MSE) / stat->rng_odata;
+        stat->PSNR  = 20 * log10(stat->rng_odata) - 10 * log10(stat->MSE);
+    }
+};
+
+/**
+ * @brief Moments of `xdata` against `odata`, in one pass over both, split in chunks over the host thread pool. The
+ * chunk partials are merged in order, so that the result does not depend on the number of workers.
+ */
+template <typename T>
+moments_t get_moments(T const* xdata, T const* odata, size_t len)
+{
+    size_t const CHUNK  = 1 << 16;
+    auto const   nchunk = (len + CHUNK - 1) / CHUNK;
+
+    std::vector<moments_t> part(nchunk);
+    cusz::ThreadPool::get_default().parallel_for(nchunk, [&](size_t begin, size_t end, int) {
+        for (auto c = begin; c < end; c++)
+            part[c] = moments_t::of(xdata, odata, c * CHUNK, std::min(len, (c + 1) * CHUNK));
+    });
+
+    moments_t all;
+    for (auto const& p : part) all.merge(p);
+    return all;
+}
+
 template <typename T>
 void verify_data(stat_t* stat, T* xdata, T* odata, size_t len)
 {
-    double max_odata = odata[0], min_odata = odata[0];
-    double max_xdata = xdata[0], min_xdata = xdata[0];
-    double max_abserr = max_abserr = fabs(xdata[0] - odata[0]);
+    get_moments(xdata, odata, len).to_stat(stat);
+}
+
+/**
+ * @brief Quality metrics of a decompressed field against its original file, fed a part at a time: a range of the
+ * flattened field, or a box such as a brick of a chunked archive. Only the matching part of the original is read,
+ * into a buffer reused across parts, so that neither field has to be resident; parts can come in any order, and
+ * the metrics match those of `verify_data()` on the whole field up to rounding.
+ */
+template <typename T>
+class StreamingVerifier {
+   private:
+    io::PositionalFile file;
+    uint32_t           field[3];
+    size_t             len;
+    std::vector<T>     ref;  // the original of the current part
+    moments_t          all;
+
+    T* get_ref(size_t part_len)
+    {
+        if (ref.size() < part_len) ref.resize(part_len);
+        return ref.data();
+    }
 
-    double sum_0 = 0, sum_x = 0;
-    for (size_t i = 0; i < len; i++) sum_0 += odata[i], sum_x += xdata[i];
+   public:
+    StreamingVerifier(const std::string& origin_fname, uint32_t x, uint32_t y = 1, uint32_t z = 1) :
+        file(origin_fname, io::PositionalFile::READ), field{x, y, z}, len((size_t)x * y * z)
+    {
+        if (file.size() < sizeof(T) * len)
+            throw std::runtime_error("StreamingVerifier: " + origin_fname + " is smaller than the specified field.");
+    }
 
-    double mean_odata = sum_0 / len, mean_xdata = sum_x / len;
-    double sum_var_odata = 0, sum_var_xdata = 0, sum_err2 = 0, sum_corr = 0, rel_abserr = 0;
+    // [begin, end) of the flattened field
+    void add_range(T const* xpart, size_t begin, size_t end)
+    {
+        if (begin >= end or end > len) throw std::runtime_error("StreamingVerifier: range out of the field.");
+        auto o = get_ref(end - begin);
+        file.read(o, sizeof(T) * (end - begin), sizeof(T) * begin);
 
-    double max_pwrrel_abserr = 0;
-    size_t max_abserr_index  = 0;
-    for (size_t i = 0; i < len; i++) {
-        max_odata = max_odata < odata[i] ? odata[i] : max_odata;
-        min_odata = min_odata > odata[i] ? odata[i] : min_odata;
+        auto m = get_moments(xpart, o, end - begin);
+        m.max_abserr_index += begin;
+        all.merge(m);
+    }
 
-        max_xdata = max_xdata < odata[i] ? odata[i] : max_xdata;
-        min_xdata = min_xdata > xdata[i] ? xdata[i] : min_xdata;
+    // `xbox`, dense and x-fastest, is the box of `extent` at `origin`
+    void add_box(T const* xbox, const uint32_t origin[3], const uint32_t extent[3])
+    {
+        auto box_len = (size_t)extent[0] * extent[1] * extent[2];
+        auto o       = get_ref(box_len);
+        file.read_box(o, field, origin, extent);
 
-        float abserr = fabs(xdata[i] - odata[i]);
-        if (odata[i] != 0) {
-            rel_abserr        = abserr / fabs(odata[i]);
-            max_pwrrel_abserr = max_pwrrel_abserr < rel_abserr ? rel_abserr : max_pwrrel_abserr;
-        }
-        max_abserr_index = max_abserr < abserr ? i : max_abserr_index;
-        max_abserr       = max_abserr < abserr ? abserr : max_abserr;
-        sum_corr += (odata[i] - mean_odata) * (xdata[i] - mean_xdata);
-        sum_var_odata += (odata[i] - mean_odata) * (odata[i] - mean_odata);
-        sum_var_xdata += (xdata[i] - mean_xdata) * (xdata[i] - mean_xdata);
-        sum_err2 += abserr * abserr;
+        // the first max error in the box is also the first in the field
+        auto m = get_moments(xbox, o, box_len);
+        auto i = m.max_abserr_index;
+        auto x = i % extent[0], y = i / extent[0] % extent[1], z = i / extent[0] / extent[1];
+        m.max_abserr_index = ((origin[2] + z) * field[1] + origin[1] + y) * field[0] + origin[0] + x;
+        all.merge(m);
     }
-    double std_odata = sqrt(sum_var_odata / len);
-    double std_xdata = sqrt(sum_var_xdata / len);
-    double ee        = sum_corr / len;
-
-    stat->len = len;
-
-    stat->max_odata = max_odata;
-    stat->min_odata = min_odata;
-    stat->rng_odata = max_odata - min_odata;
-    stat->std_odata = std_odata;
-
-    stat->max_xdata = max_xdata;
-    stat->min_xdata = min_xdata;
-    stat->rng_xdata = max_xdata - min_xdata;
-    stat->std_xdata = std_xdata;
-
-    stat->max_abserr_index  = max_abserr_index;
-    stat->max_abserr        = max_abserr;
-    stat->max_abserr_vs_rng = max_abserr / stat->rng_odata;
-    stat->max_pwrrel_abserr = max_pwrrel_abserr;
-
-    stat->coeff = ee / std_odata / std_xdata;
-    stat->MSE   = sum_err2 / len;
-    stat->NRMSE = sqrt(stat->MSE) / stat->rng_odata;
-    stat->PSNR  = 20 * log10(stat->rng_odata) - 10 * log10(stat->MSE);
-}
+
+    // elements verified so far; the field is covered when this reaches its length, if the parts do not overlap
+    size_t get_nverified() const { return all.n; }
+    bool   is_complete() const { return all.n == len; }
+
+    void get_stat(stat_t* stat) const
+    {
+        if (all.n == 0) throw std::runtime_error("StreamingVerifier: nothing verified.");
+        all.to_stat(stat);
+    }
+};
 
 template <typename Data>
 void print_data_quality_metrics(stat_t* stat, size_t compressed_bytes = 0, bool gpu_checker = false)
@@ -110,7 +263,7 @@ void print_data_quality_metrics(stat_t* stat, size_t compressed_bytes = 0, bool
     auto is_fp = std::is_same<Data, float>::value || std::is_same<Data, double>::value ? const_cast<char*>("yes")
                                                                                        : const_cast<char*>("no");
     print_head("", "data-len", "data-byte", "fp-type?", "");
-    printf("  %-10s %16d %16d %16s\n", "", stat->len, sizeof(Data), is_fp);
+    printf("  %-10s %16zu %16zu %16s\n", "", stat->len, sizeof(Data), is_fp);
 
     print_head("", "min", "max", "rng", "std");
     print_ln("origin", stat->min_odata, stat->max_odata, stat->rng_odata, stat->std_odata);
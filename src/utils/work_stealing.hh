@@ -0,0 +1,158 @@
+/**
+ * @file work_stealing.hh
+ * @author Jiannan Tian
+ * @brief Work-stealing pool for batches of independent jobs of uneven cost.
+ * @version 0.3
+ * @date 2022-03-22
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_UTILS_WORK_STEALING_HH
+#define CUSZ_UTILS_WORK_STEALING_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.hh"
+
+namespace cusz {
+
+/**
+ * @brief Runs `body(job, worker)` for every job of a batch on `nworker` threads. Jobs are sorted by cost and dealt
+ * round-robin, so that every worker starts with a similar mix; a worker runs its own jobs largest first, and once
+ * out of them, steals the smallest job of the worker with the most cost left. Large jobs thus start early, and small
+ * ones fill the gaps at the end. The threads are started once, on a `ThreadPool` of the pool's own, and wait between
+ * runs; worker 0 is the caller, and every other worker the same thread in every run. Per-worker state indexed by
+ * `worker` (e.g., a CUDA stream and compressors) thus needs no locking and can be kept from batch to batch. As within
+ * any `ThreadPool` loop, host loops started by `body` run serially on its worker.
+ *
+ * An exception thrown by `body` stops the run: the other workers finish the job at hand, take no more, and the first
+ * exception is rethrown from `run()`.
+ */
+class WorkStealingPool {
+   public:
+    using cost_fn = std::function<size_t(size_t job)>;
+    using body_fn = std::function<void(size_t job, int worker)>;
+
+   private:
+    struct queue_t {
+        std::deque<size_t>  q;  // largest first
+        std::mutex          mtx;
+        std::atomic<size_t> cost{0};
+    };
+
+    int                 nworker;
+    ThreadPool          threads;  // worker 0 is the thread calling `run()`
+    std::vector<size_t> njob_done, nstolen;
+
+    static int check_nworker(int n)
+    {
+        if (n < 1) throw std::runtime_error("WorkStealingPool: at least one worker.");
+        return n;
+    }
+
+    bool take_own(queue_t& own, cost_fn const& cost, size_t& job)
+    {
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (own.q.empty()) return false;
+        job = own.q.front(), own.q.pop_front();
+        own.cost -= cost(job);
+        return true;
+    }
+
+    bool steal(std::vector<queue_t>& queues, int thief, cost_fn const& cost, size_t& job)
+    {
+        while (true) {
+            // the richest victim, by a racy read; its lock is what makes the steal safe
+            auto victim = -1;
+            auto most   = (size_t)0;
+            for (auto w = 0; w < nworker; w++)
+                if (w != thief and queues[w].cost > most) most = queues[w].cost, victim = w;
+            if (victim < 0) {
+                // costs can be 0; fall back to a scan
+                for (auto w = 0; w < nworker and victim < 0; w++) {
+                    std::lock_guard<std::mutex> lock(queues[w].mtx);
+                    if (w != thief and not queues[w].q.empty()) victim = w;
+                }
+                if (victim < 0) return false;
+            }
+
+            std::lock_guard<std::mutex> lock(queues[victim].mtx);
+            if (queues[victim].q.empty()) continue;  // drained meanwhile; look again
+            job = queues[victim].q.back(), queues[victim].q.pop_back();
+            queues[victim].cost -= cost(job);
+            return true;
+        }
+    }
+
+   public:
+    explicit WorkStealingPool(int _nworker) : nworker(check_nworker(_nworker)), threads(nworker) {}
+
+    int get_nworker() const { return nworker; }
+
+    // of the last run
+    size_t get_njob_done(int worker) const { return njob_done.at(worker); }
+    size_t get_nstolen(int worker) const { return nstolen.at(worker); }
+    size_t get_nstolen() const { return std::accumulate(nstolen.begin(), nstolen.end(), (size_t)0); }
+
+    /**
+     * @param njob jobs are 0 to `njob - 1`
+     * @param cost relative cost of a job, e.g., its number of elements
+     * @param body runs one job on one worker
+     *
+     * One run at a time, and not from within a loop of a `ThreadPool`.
+     */
+    void run(size_t njob, cost_fn cost, body_fn body)
+    {
+        std::vector<size_t> order(njob);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cost(a) > cost(b); });
+
+        std::vector<queue_t> queues(nworker);
+        for (size_t i = 0; i < njob; i++) {
+            auto& own = queues[i % nworker];
+            own.q.push_back(order[i]);
+            own.cost += cost(order[i]);
+        }
+        njob_done.assign(nworker, 0), nstolen.assign(nworker, 0);
+
+        std::atomic<bool>  stop{false};
+        std::exception_ptr err{nullptr};
+        std::mutex         err_mtx;
+
+        auto work = [&](int w) {
+            size_t job;
+            while (not stop) {
+                auto own = take_own(queues[w], cost, job);
+                if (not own and not steal(queues, w, cost, job)) return;
+                try {
+                    body(job, w);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(err_mtx);
+                    if (not err) err = std::current_exception();
+                    stop = true;
+                }
+                njob_done[w]++, nstolen[w] += not own;
+            }
+        };
+
+        threads.for_each_worker(work);
+
+        if (err) std::rethrow_exception(err);
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,230 @@
+/**
+ * @file workspace_arena.hh
+ * @author Jiannan Tian
+ * @brief Slab arena for stage workspaces: carved best-fit, coalesced on release, reused across compressors.
+ * @version 0.3
+ * @date 2022-03-18
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef UTILS_WORKSPACE_ARENA_HH
+#define UTILS_WORKSPACE_ARENA_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace cusz {
+
+/**
+ * @brief Memory is taken from the underlying allocator in slabs, which are kept until `trim()` or destruction; a
+ * workspace is carved from the best-fitting free range of any slab and given back on `deallocate()`, merging with
+ * its free neighbors. Once the largest field has been compressed (or `reserve()` is called for it), fields of any
+ * size up to it reuse the slabs without calling the underlying allocator.
+ *
+ * Disabled (the default), `allocate()` and `deallocate()` pass through; a block carved while enabled still returns
+ * to its slab.
+ */
+class WorkspaceArena {
+   public:
+    using alloc_fn = std::function<void*(size_t)>;  // nullptr on failure
+    using free_fn  = std::function<void(void*)>;
+
+    static const size_t ALIGN          = 256;
+    static const size_t MIN_SLAB_NBYTE = 16 << 20;  // small workspaces share a slab
+
+   private:
+    struct slab_t {
+        uint8_t*                 base;
+        size_t                   nbyte;
+        std::map<size_t, size_t> free_range;  // offset -> nbyte
+    };
+
+    struct carved_t {
+        size_t slab, offset, nbyte;
+    };
+
+    alloc_fn raw_alloc;
+    free_fn  raw_free;
+
+    bool                                enabled{false};
+    std::vector<slab_t>                 slabs;
+    std::unordered_map<void*, carved_t> live;
+    std::mutex                          mtx;
+    size_t                              nbyte_live{0}, nbyte_peak{0}, nraw_alloc{0};
+
+    static size_t get_aligned(size_t nbyte) { return (nbyte + ALIGN - 1) / ALIGN * ALIGN; }
+
+    void* __carve(size_t nbyte)
+    {
+        size_t best_slab = 0, best_offset = 0, best_nbyte = SIZE_MAX;
+        for (size_t s = 0; s < slabs.size(); s++)
+            for (auto const& r : slabs[s].free_range)
+                if (r.second >= nbyte and r.second < best_nbyte)
+                    best_slab = s, best_offset = r.first, best_nbyte = r.second;
+        if (best_nbyte == SIZE_MAX) return nullptr;
+
+        auto& ranges = slabs[best_slab].free_range;
+        ranges.erase(best_offset);
+        if (best_nbyte > nbyte) ranges[best_offset + nbyte] = best_nbyte - nbyte;
+
+        auto p  = slabs[best_slab].base + best_offset;
+        live[p] = carved_t{best_slab, best_offset, nbyte};
+        return p;
+    }
+
+    bool __add_slab(size_t nbyte)
+    {
+        auto base = reinterpret_cast<uint8_t*>(raw_alloc(nbyte));
+        if (not base) return false;
+        nraw_alloc++;
+
+        slab_t slab{base, nbyte, {}};
+        slab.free_range[0] = nbyte;
+        slabs.push_back(std::move(slab));
+        return true;
+    }
+
+    size_t __trim()
+    {
+        size_t              released = 0;
+        std::vector<slab_t> kept;
+        std::vector<size_t> renumber(slabs.size());
+        for (size_t s = 0; s < slabs.size(); s++) {
+            auto& slab = slabs[s];
+            if (slab.free_range.size() == 1 and slab.free_range.begin()->second == slab.nbyte) {
+                raw_free(slab.base);
+                released += slab.nbyte;
+            }
+            else {
+                renumber[s] = kept.size();
+                kept.push_back(std::move(slab));
+            }
+        }
+        for (auto& kv : live) kv.second.slab = renumber[kv.second.slab];
+        slabs = std::move(kept);
+        return released;
+    }
+
+   public:
+    WorkspaceArena(alloc_fn _raw_alloc, free_fn _raw_free) : raw_alloc(_raw_alloc), raw_free(_raw_free) {}
+
+    ~WorkspaceArena()
+    {
+        for (auto& slab : slabs) raw_free(slab.base);
+    }
+
+    WorkspaceArena(const WorkspaceArena&) = delete;
+    WorkspaceArena& operator=(const WorkspaceArena&) = delete;
+
+    void enable(bool on = true)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        enabled = on;
+    }
+    bool is_enabled() const { return enabled; }
+
+    /**
+     * @brief Make sure a workspace of `nbyte` can be carved without growing, e.g., to size for the largest field
+     * up front.
+     */
+    void reserve(size_t nbyte)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        nbyte = get_aligned(nbyte);
+        for (auto const& slab : slabs)
+            for (auto const& r : slab.free_range)
+                if (r.second >= nbyte) return;
+        if (not __add_slab(nbyte)) throw std::runtime_error("WorkspaceArena: fail to reserve.");
+    }
+
+    void* allocate(size_t nbyte)
+    {
+        if (nbyte == 0) return nullptr;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (not enabled) return raw_alloc(nbyte);
+
+        nbyte  = get_aligned(nbyte);
+        auto p = __carve(nbyte);
+        if (not p) {
+            auto slab_nbyte = std::max(nbyte, (size_t)MIN_SLAB_NBYTE);
+            auto grown      = __add_slab(slab_nbyte);
+            // out of memory: give the idle slabs back and retry, lastly at the exact size
+            if (not grown) __trim(), grown = __add_slab(slab_nbyte) or __add_slab(nbyte);
+            if (not grown) return nullptr;
+            p = __carve(nbyte);
+        }
+
+        nbyte_live += nbyte;
+        nbyte_peak = std::max(nbyte_peak, nbyte_live);
+        return p;
+    }
+
+    void deallocate(void* p)
+    {
+        if (not p) return;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto                        it = live.find(p);
+        if (it == live.end()) {
+            raw_free(p);
+            return;
+        }
+
+        auto c = it->second;
+        live.erase(it);
+        nbyte_live -= c.nbyte;
+
+        // merge with the free neighbors
+        auto& ranges = slabs[c.slab].free_range;
+        auto  next   = ranges.lower_bound(c.offset);
+        if (next != ranges.end() and next->first == c.offset + c.nbyte) {
+            c.nbyte += next->second;
+            next = ranges.erase(next);
+        }
+        if (next != ranges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == c.offset) {
+                prev->second += c.nbyte;
+                return;
+            }
+        }
+        ranges[c.offset] = c.nbyte;
+    }
+
+    /**
+     * @brief Give the slabs that are entirely free back to the underlying allocator.
+     * @return bytes released
+     */
+    size_t trim()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return __trim();
+    }
+
+    size_t get_nslab() const { return slabs.size(); }
+    size_t get_nbyte_live() const { return nbyte_live; }
+    size_t get_nbyte_peak() const { return nbyte_peak; }
+    size_t get_nraw_alloc() const { return nraw_alloc; }  // slabs taken so far, including trimmed ones
+
+    size_t get_nbyte_reserved() const
+    {
+        size_t nbyte = 0;
+        for (auto const& slab : slabs) nbyte += slab.nbyte;
+        return nbyte;
+    }
+};
+
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file workspace_pool.hh
+ * @author Jiannan Tian
+ * @brief Process-wide workspace arenas for device and pinned host memory.
+ * @version 0.3
+ * @date 2022-03-18
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef UTILS_WORKSPACE_POOL_HH
+#define UTILS_WORKSPACE_POOL_HH
+
+#include <cuda_runtime.h>
+#include <cstddef>
+
+#include "workspace_arena.hh"
+
+namespace cusz {
+
+/**
+ * @brief Stage workspaces (predictor, spreducer, codec, compressor output, `Capsule`) are allocated here. Off by
+ * default, all calls go straight to `cudaMalloc`/`cudaMallocHost`; `enable()` turns on slab reuse, so that
+ * compressing many fields, or the same fields every timestep, stops paying for allocation after the first (largest)
+ * one. Signatures follow the CUDA runtime, so that call sites keep `CHECK_CUDA`.
+ */
+struct WorkspacePool {
+    static WorkspaceArena& device()
+    {
+        static WorkspaceArena arena(
+            [](size_t nbyte) -> void* {
+                void* p{nullptr};
+                if (cudaMalloc(&p, nbyte) == cudaSuccess) return p;
+                cudaGetLastError();  // not sticky; clear for the caller
+                return nullptr;
+            },
+            [](void* p) { cudaFree(p); });
+        return arena;
+    }
+
+    static WorkspaceArena& pinned()
+    {
+        static WorkspaceArena arena(
+            [](size_t nbyte) -> void* {
+                void* p{nullptr};
+                if (cudaMallocHost(&p, nbyte) == cudaSuccess) return p;
+                cudaGetLastError();
+                return nullptr;
+            },
+            [](void* p) { cudaFreeHost(p); });
+        return arena;
+    }
+
+    static void enable(bool on = true) { device().enable(on), pinned().enable(on); }
+
+    static void trim() { device().trim(), pinned().trim(); }
+
+    template <typename T>
+    static cudaError_t malloc(T** p, size_t nbyte)
+    {
+        *p = reinterpret_cast<T*>(device().allocate(nbyte));
+        return (*p or nbyte == 0) ? cudaSuccess : cudaErrorMemoryAllocation;
+    }
+
+    template <typename T>
+    static cudaError_t malloc_host(T** p, size_t nbyte)
+    {
+        *p = reinterpret_cast<T*>(pinned().allocate(nbyte));
+        return (*p or nbyte == 0) ? cudaSuccess : cudaErrorMemoryAllocation;
+    }
+
+    static cudaError_t free(void* p)
+    {
+        device().deallocate(p);
+        return cudaSuccess;
+    }
+
+    static cudaError_t free_host(void* p)
+    {
+        pinned().deallocate(p);
+        return cudaSuccess;
+    }
+};
+
+}  // namespace cusz
+
+#endif
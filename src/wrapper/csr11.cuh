@@ -31,6 +31,7 @@
 #include "../../include/reducer.hh"
 #include "../common.hh"
 #include "../utils.hh"
+#include "../utils/workspace_pool.hh"
 
 // clang-format off
 template <typename F> struct cuszCUSPARSE;
@@ -42,10 +43,10 @@ template <> struct cuszCUSPARSE<double> { const static cudaDataType type = CUDA_
                             macros for shorthand writing
  ******************************************************************************/
 
-#define CSR11_FREEDEV(VAR)             \
-    if (d_##VAR) {                     \
-        CHECK_CUDA(cudaFree(d_##VAR)); \
-        d_##VAR = nullptr;             \
+#define CSR11_FREEDEV(VAR)                        \
+    if (d_##VAR) {                                \
+        CHECK_CUDA(WorkspacePool::free(d_##VAR)); \
+        d_##VAR = nullptr;                        \
     }
 
 #define DEVICE2DEVICE_COPY(VAR, FIELD)                                                                 \
@@ -55,8 +56,8 @@ template <> struct cuszCUSPARSE<double> { const static cudaDataType type = CUDA_
         CHECK_CUDA(cudaMemcpyAsync(dst, src, nbyte[HEADER::FIELD], cudaMemcpyDeviceToDevice, stream)); \
     }
 
-#define CSR11_ALLOCDEV(VAR, SYM)                           \
-    CHECK_CUDA(cudaMalloc(&d_##VAR, rte.nbyte[RTE::SYM])); \
+#define CSR11_ALLOCDEV(VAR, SYM)                                      \
+    CHECK_CUDA(WorkspacePool::malloc(&d_##VAR, rte.nbyte[RTE::SYM])); \
     CHECK_CUDA(cudaMemset(d_##VAR, 0x0, rte.nbyte[RTE::SYM]));
 
 #define DEFINE_CSR11_ARRAY(VAR, TYPE) TYPE* d_##VAR{nullptr};
@@ -201,7 +202,7 @@ class CSR11 : public VirtualGatherScatter {
             t.timer_end(stream);
             milliseconds += t.get_time_elapsed();
 
-            CHECK_CUDA(cudaMalloc(&rte.d_buffer, rte.d_buffer_size));
+            CHECK_CUDA(WorkspacePool::malloc(&rte.d_buffer, rte.d_buffer_size));
         }};
 
         auto gather11_analysis = [&]() {
@@ -251,6 +252,10 @@ class CSR11 : public VirtualGatherScatter {
         gather11_get_rowptr();
         gather11_dn2csr();
 
+        // release the external buffer (it used to leak on every call)
+        CHECK_CUDA(cudaStreamSynchronize(stream));
+        WorkspacePool::free(rte.d_buffer), rte.d_buffer = nullptr;
+
         // destroy matrix/vector descriptors
         CHECK_CUSPARSE(cusparseDestroyDnMat(rte.dnmat));
         CHECK_CUSPARSE(cusparseDestroySpMat(rte.spmat));
@@ -295,8 +300,8 @@ class CSR11 : public VirtualGatherScatter {
                 milliseconds += t.get_time_elapsed();
             }
 
-            if (nullptr != rte.d_work) cudaFree(rte.d_work);
-            CHECK_CUDA(cudaMalloc((void**)&rte.d_work, rte.lwork_in_bytes));  // TODO where to release d_work?
+            if (nullptr != rte.d_work) WorkspacePool::free(rte.d_work);
+            CHECK_CUDA(WorkspacePool::malloc(&rte.d_work, rte.lwork_in_bytes));  // released in the destructor
         };
 
         auto gather10_compute_rowptr_and_nnz = [&]() {  // step 4
@@ -399,7 +404,7 @@ class CSR11 : public VirtualGatherScatter {
             t.timer_end(stream);
             milliseconds += t.get_time_elapsed();
 
-            CHECK_CUDA(cudaMalloc(&rte.d_buffer, rte.d_buffer_size));
+            CHECK_CUDA(WorkspacePool::malloc(&rte.d_buffer, rte.d_buffer_size));
         };
 
         auto scatter11_csr2dn = [&]() {
@@ -423,6 +428,9 @@ class CSR11 : public VirtualGatherScatter {
         scatter11_init_buffer();
         scatter11_csr2dn();
 
+        CHECK_CUDA(cudaStreamSynchronize(stream));
+        WorkspacePool::free(rte.d_buffer), rte.d_buffer = nullptr;
+
         // destroy matrix/vector descriptors
         CHECK_CUSPARSE(cusparseDestroySpMat(rte.spmat));
         CHECK_CUSPARSE(cusparseDestroyDnMat(rte.dnmat));
@@ -507,6 +515,9 @@ class CSR11 : public VirtualGatherScatter {
         CSR11_FREEDEV(rowptr);
         CSR11_FREEDEV(colidx);
         CSR11_FREEDEV(val);
+#if CUDART_VERSION < 11020 && CUDART_VERSION >= 10000
+        if (rte.d_work) WorkspacePool::free(rte.d_work);
+#endif
     }
 
     // only placeholding
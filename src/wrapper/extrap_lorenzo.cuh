@@ -23,6 +23,7 @@
 
 #include "../common.hh"
 #include "../utils.hh"
+#include "../utils/workspace_pool.hh"
 
 #ifdef DPCPP_SHOWCASE
 #include "../kernel/lorenzo_prototype.cuh"
@@ -44,16 +45,16 @@ using cusz::prototype::x_lorenzo_3d1l;
 #define CONSTEXPR
 #endif
 
-#define ALLOCDEV(VAR, SYM, NBYTE)                    \
-    if (NBYTE != 0) {                                \
-        CHECK_CUDA(cudaMalloc(&d_##VAR, NBYTE));     \
-        CHECK_CUDA(cudaMemset(d_##VAR, 0x0, NBYTE)); \
+#define ALLOCDEV(VAR, SYM, NBYTE)                           \
+    if (NBYTE != 0) {                                       \
+        CHECK_CUDA(WorkspacePool::malloc(&d_##VAR, NBYTE)); \
+        CHECK_CUDA(cudaMemset(d_##VAR, 0x0, NBYTE));        \
     }
 
-#define FREE_DEV_ARRAY(VAR)            \
-    if (d_##VAR) {                     \
-        CHECK_CUDA(cudaFree(d_##VAR)); \
-        d_##VAR = nullptr;             \
+#define FREE_DEV_ARRAY(VAR)                       \
+    if (d_##VAR) {                                \
+        CHECK_CUDA(WorkspacePool::free(d_##VAR)); \
+        d_##VAR = nullptr;                        \
     }
 
 #define DEFINE_ARRAY(VAR, TYPE) TYPE* d_##VAR{nullptr};
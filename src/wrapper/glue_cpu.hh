@@ -0,0 +1,127 @@
+/**
+ * @file glue_cpu.hh
+ * @author Jiannan Tian
+ * @brief Host counterparts of the split helpers in glue.cuh, on a two-phase parallel stream compaction.
+ * @version 0.3
+ * @date 2022-03-11
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef WRAPPER_GLUE_CPU_HH
+#define WRAPPER_GLUE_CPU_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../utils/thread_pool.hh"
+
+namespace cusz {
+namespace cpu {
+
+/**
+ * @brief Order-preserving stream compaction, `copy_if` on host, on the host pool.
+ * (1) the input is split into a few ranges per worker, and each range counted, predicate evaluated under `omp simd`;
+ * (2) exclusive scan of the per-range counts;
+ * (3) each range is written from its offset, branchless: always write, advance by the predicate.
+ * A range stops as soon as its quota is filled, so the unconditional write never lands in a neighbor's range.
+ *
+ * @tparam IDX index type
+ * @param len input length
+ * @param pred `bool(size_t i)`
+ * @param emit `void(IDX pos, size_t i)`; writes the i-th input to the pos-th output slot
+ * @return number of selected items
+ */
+template <typename IDX = int, typename PRED, typename EMIT>
+IDX stream_compact(size_t len, PRED pred, EMIT emit)
+{
+    auto&        pool   = cusz::ThreadPool::get_default();
+    size_t const nrange = std::max<size_t>(1, std::min<size_t>(len, 4 * pool.get_nworker()));
+
+    std::vector<size_t> offset(nrange + 1, 0);
+    auto                start = [&](size_t r) { return len * r / nrange; };
+
+    pool.parallel_for(
+        nrange,
+        [&](size_t begin, size_t end, int) {
+            for (auto r = begin; r < end; r++) {
+                size_t count = 0;
+#pragma omp simd reduction(+ : count)
+                for (auto i = start(r); i < start(r + 1); i++) count += pred(i) ? 1 : 0;
+                offset[r + 1] = count;
+            }
+        },
+        1);
+
+    for (size_t r = 0; r < nrange; r++) offset[r + 1] += offset[r];
+
+    pool.parallel_for(
+        nrange,
+        [&](size_t begin, size_t end, int) {
+            for (auto r = begin; r < end; r++) {
+                auto pos = offset[r], quota = offset[r + 1];
+                for (auto i = start(r); i < start(r + 1) and pos < quota; i++) {
+                    emit((IDX)pos, i);
+                    pos += pred(i) ? 1 : 0;
+                }
+            }
+        },
+        1);
+
+    return (IDX)offset[nrange];
+}
+
+/**
+ * @brief Host `split_by_radius`: outliers are codes at or beyond [1, 2 * radius).
+ *
+ */
+template <typename E, typename IDX = int>
+void split_by_radius(E* in_errctrl, size_t in_len, int const radius, IDX* out_idx, E* out_val, int& out_nnz)
+{
+    auto const cap  = 2 * radius;
+    auto       pred = [&](size_t i) { return in_errctrl[i] >= cap or in_errctrl[i] <= 0; };
+
+    out_nnz = stream_compact<IDX>(in_len, pred, [&](IDX pos, size_t i) {
+        out_idx[pos] = i;
+        out_val[pos] = in_errctrl[i];
+    });
+    // `cleanup` in glue.cuh is an identity transform; nothing to do on host
+}
+
+/**
+ * @brief Host `split_by_binary_twopass`: indices first, then values fetched by index.
+ *
+ */
+template <typename E, typename IDX = int>
+void split_by_binary_twopass(E* in_errctrl, size_t in_len, int const radius, IDX* out_idx, E* out_val, int& out_nnz)
+{
+    auto pred = [&](size_t i) { return in_errctrl[i] != radius; };
+
+    out_nnz = stream_compact<IDX>(in_len, pred, [&](IDX pos, size_t i) { out_idx[pos] = i; });
+
+    cusz::ThreadPool::get_default().parallel_for(out_nnz, [&](size_t begin, size_t end, int) {
+        for (auto i = begin; i < end; i++) out_val[i] = in_errctrl[out_idx[i]];
+    });
+}
+
+/**
+ * @brief Host `split_by_binary_onepass`: index and value written together.
+ *
+ */
+template <typename E, typename IDX = int>
+void split_by_binary_onepass(E* in_errctrl, size_t in_len, int const radius, IDX* out_idx, E* out_val, int& out_nnz)
+{
+    auto pred = [&](size_t i) { return in_errctrl[i] != radius; };
+
+    out_nnz = stream_compact<IDX>(in_len, pred, [&](IDX pos, size_t i) {
+        out_idx[pos] = i;
+        out_val[pos] = in_errctrl[i];
+    });
+}
+
+}  // namespace cpu
+}  // namespace cusz
+
+#endif
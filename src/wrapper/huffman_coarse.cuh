@@ -54,24 +54,24 @@ using std::cout;
 
 #define ACCESSOR(SYM, TYPE) reinterpret_cast<TYPE*>(in_compressed + header.entry[HEADER::SYM])
 
-#define HC_ALLOCHOST(VAR, SYM)                     \
-    cudaMallocHost(&h_##VAR, rte.nbyte[RTE::SYM]); \
+#define HC_ALLOCHOST(VAR, SYM)                                 \
+    WorkspacePool::malloc_host(&h_##VAR, rte.nbyte[RTE::SYM]); \
     memset(h_##VAR, 0x0, rte.nbyte[RTE::SYM]);
 
-#define HC_ALLOCDEV(VAR, SYM)                  \
-    cudaMalloc(&d_##VAR, rte.nbyte[RTE::SYM]); \
+#define HC_ALLOCDEV(VAR, SYM)                             \
+    WorkspacePool::malloc(&d_##VAR, rte.nbyte[RTE::SYM]); \
     cudaMemset(d_##VAR, 0x0, rte.nbyte[RTE::SYM]);
 
-#define HC_FREEHOST(VAR)       \
-    if (h_##VAR) {             \
-        cudaFreeHost(h_##VAR); \
-        h_##VAR = nullptr;     \
+#define HC_FREEHOST(VAR)                   \
+    if (h_##VAR) {                         \
+        WorkspacePool::free_host(h_##VAR); \
+        h_##VAR = nullptr;                 \
     }
 
-#define HC_FREEDEV(VAR)    \
-    if (d_##VAR) {         \
-        cudaFree(d_##VAR); \
-        d_##VAR = nullptr; \
+#define HC_FREEDEV(VAR)               \
+    if (d_##VAR) {                    \
+        WorkspacePool::free(d_##VAR); \
+        d_##VAR = nullptr;            \
     }
 
 /******************************************************************************
@@ -0,0 +1,491 @@
+/**
+ * @file huffman_coarse_cpu.hh
+ * @author Jiannan Tian
+ * @brief Host (CPU) counterpart of HuffmanCoarse; same archive layout, chunks spread over the host thread pool.
+ * @version 0.3
+ * @date 2022-03-10
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_WRAPPER_HUFFMAN_COARSE_CPU_HH
+#define CUSZ_WRAPPER_HUFFMAN_COARSE_CPU_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/reducer.hh"
+#include "../common/configs.hh"
+#include "../common/definition.hh"
+#include "../utils/thread_pool.hh"
+#include "../utils/timer.hh"
+
+namespace cusz {
+namespace cpu {
+
+template <typename T, typename H, typename M = uint32_t>
+class HuffmanCoarse : public cusz::VariableRate {
+   public:
+    using Origin    = T;
+    using Encoded   = H;
+    using MetadataT = M;
+    using FreqT     = cusz::FREQ;
+    using BYTE      = uint8_t;
+
+    /**
+     * @brief identical to HuffmanCoarse::header_t, so that either codec can decode the other's output
+     *
+     */
+    struct header_t {
+        static const int HEADER    = 0;
+        static const int REVBOOK   = 1;
+        static const int PAR_NBIT  = 2;
+        static const int PAR_ENTRY = 3;
+        static const int BITSTREAM = 4;
+        static const int END       = 5;
+
+        int       header_nbyte : 16;
+        int       booklen : 16;
+        int       sublen;
+        int       pardeg;
+        size_t    uncompressed_len;
+        size_t    total_nbit;
+        size_t    total_ncell;  // TODO change to uint32_t
+        MetadataT entry[END + 1];
+
+        MetadataT subfile_size() const { return entry[END]; }
+    };
+    using HEADER = header_t;
+
+    struct runtime_encode_helper {
+        static const int FREQ      = 0;
+        static const int BOOK      = 1;
+        static const int REVBOOK   = 2;
+        static const int PAR_NBIT  = 3;
+        static const int PAR_NCELL = 4;
+        static const int PAR_ENTRY = 5;
+        static const int END       = 6;
+
+        uint32_t nbyte[END];
+    };
+    using RTE = runtime_encode_helper;
+    RTE rte;
+
+   private:
+    using BOOK = H;
+    using SYM  = T;
+
+    static const int CELL_BITWIDTH = sizeof(H) * 8;
+    static const int MAX_CODELEN   = CELL_BITWIDTH - 8;  // see PackedWordByWidth
+
+    std::vector<FreqT> freq;
+    std::vector<H>     book;
+    std::vector<BYTE>  revbook;
+    std::vector<M>     par_nbit, par_ncell, par_entry;
+    std::vector<BYTE>  compressed;  // header + all segments
+
+    float milliseconds{0.0};
+    float time_hist{0.0}, time_book{0.0}, time_lossless{0.0};
+
+   public:
+    float get_time_elapsed() const { return milliseconds; }
+    float get_time_hist() const { return time_hist; }
+    float get_time_book() const { return time_book; }
+    float get_time_lossless() const { return time_lossless; }
+
+    // no intermediate fixed-length codes on host: bitstream is written in place at its final offset
+    size_t get_workspace_nbyte(size_t) const { return 0; }
+    size_t get_max_output_nbyte(size_t len) const { return sizeof(H) * len / 2; }
+
+    static uint32_t get_revbook_nbyte(int dict_size)
+    {
+        return sizeof(BOOK) * (2 * CELL_BITWIDTH) + sizeof(SYM) * dict_size;
+    }
+
+    static H    get_word(H packed) { return packed & ((H(1) << MAX_CODELEN) - 1); }
+    static int  get_bits(H packed) { return static_cast<int>(packed >> MAX_CODELEN); }
+    static void set_packed(H& packed, H word, int bits) { packed = (H(bits) << MAX_CODELEN) | word; }
+
+   public:
+    HuffmanCoarse()  = default;
+    ~HuffmanCoarse() = default;
+
+    /**
+     * @brief Allocate workspace according to the input size & configurations.
+     *
+     * @param in_uncompressed_len uncompressed length
+     * @param cfg_booklen codebook length
+     * @param cfg_pardeg degree of parallelism
+     * @param dbg_print print for debugging
+     */
+    void allocate_workspace(size_t const in_uncompressed_len, int cfg_booklen, int cfg_pardeg, bool dbg_print = false)
+    {
+        memset(rte.nbyte, 0, sizeof(uint32_t) * RTE::END);
+
+        rte.nbyte[RTE::FREQ]      = sizeof(FreqT) * cfg_booklen;
+        rte.nbyte[RTE::BOOK]      = sizeof(H) * cfg_booklen;
+        rte.nbyte[RTE::REVBOOK]   = get_revbook_nbyte(cfg_booklen);
+        rte.nbyte[RTE::PAR_NBIT]  = sizeof(M) * cfg_pardeg;
+        rte.nbyte[RTE::PAR_NCELL] = sizeof(M) * cfg_pardeg;
+        rte.nbyte[RTE::PAR_ENTRY] = sizeof(M) * cfg_pardeg;
+
+        freq.assign(cfg_booklen, 0);
+        book.assign(cfg_booklen, 0);
+        revbook.assign(rte.nbyte[RTE::REVBOOK], 0);
+        par_nbit.assign(cfg_pardeg, 0);
+        par_ncell.assign(cfg_pardeg, 0);
+        par_entry.assign(cfg_pardeg, 0);
+
+        // reserve, not resize: the final size is known after the first encoding pass
+        compressed.reserve(128 + rte.nbyte[RTE::REVBOOK] + 2 * rte.nbyte[RTE::PAR_NBIT] +
+                           get_max_output_nbyte(in_uncompressed_len));
+
+        if (dbg_print) {
+            printf("\ncpu::HuffmanCoarse::allocate_workspace() debugging:\n");
+            printf("%-*s:  %'10u\n", 16, "nbyte-revbook", rte.nbyte[RTE::REVBOOK]);
+            printf("%-*s:  %'10u\n", 16, "nbyte-par_nbit", rte.nbyte[RTE::PAR_NBIT]);
+            printf("%-*s:  %'10lu\n", 16, "reserved", compressed.capacity());
+            printf("\n");
+        }
+    }
+
+    void clear_buffer()
+    {
+        std::fill(freq.begin(), freq.end(), 0);
+        std::fill(book.begin(), book.end(), 0);
+        std::fill(revbook.begin(), revbook.end(), 0);
+        std::fill(par_nbit.begin(), par_nbit.end(), 0);
+        std::fill(par_ncell.begin(), par_ncell.end(), 0);
+        std::fill(par_entry.begin(), par_entry.end(), 0);
+        compressed.clear();
+    }
+
+   public:
+    /**
+     * @brief Per-worker private histograms, reduced at the end.
+     *
+     */
+    static void get_frequency(T* in, size_t const len, FreqT* out_freq, int const booklen)
+    {
+        std::fill(out_freq, out_freq + booklen, 0);
+
+        auto&                           pool = cusz::ThreadPool::get_default();
+        std::vector<std::vector<FreqT>> local(pool.get_nworker());
+        pool.parallel_for(len, [&](size_t begin, size_t end, int w) {
+            if (local[w].empty()) local[w].assign(booklen, 0);
+            for (auto i = begin; i < end; i++) local[w][in[i]]++;
+        });
+
+        for (auto const& l : local)
+            for (size_t k = 0; k < l.size(); k++) out_freq[k] += l[k];
+    }
+
+    /**
+     * @brief Build a canonical codebook and its reverse in the layout `single_thread_inflate` consumes:
+     * first[CELL_BITWIDTH], entry[CELL_BITWIDTH], keys[booklen].
+     *
+     * @throw std::runtime_error if the longest codeword does not fit; caller is expected to fall back to 8-byte H.
+     */
+    static void build_codebook(FreqT* in_freq, int const booklen, H* out_book, BYTE* out_revbook)
+    {
+        std::fill(out_book, out_book + booklen, 0);
+        std::fill(out_revbook, out_revbook + get_revbook_nbyte(booklen), 0);
+
+        std::vector<int> codelen(booklen, 0);
+        {
+            using node_t = std::pair<uint64_t, int>;  // (freq, node id)
+            std::priority_queue<node_t, std::vector<node_t>, std::greater<node_t>> pq;
+            std::vector<int>                                                     parent;
+
+            for (auto i = 0; i < booklen; i++) {
+                if (in_freq[i] == 0) continue;
+                parent.push_back(-1);
+                pq.push({in_freq[i], (int)parent.size() - 1});
+                codelen[i] = (int)parent.size() - 1;  // temporarily, leaf id
+            }
+            auto nleaf = parent.size();
+            if (nleaf == 0) return;
+
+            while (pq.size() > 1) {
+                auto a = pq.top();
+                pq.pop();
+                auto b = pq.top();
+                pq.pop();
+                parent.push_back(-1);
+                parent[a.second] = parent[b.second] = (int)parent.size() - 1;
+                pq.push({a.first + b.first, (int)parent.size() - 1});
+            }
+
+            // depth of a node = depth of its parent + 1; parents always have larger ids
+            std::vector<int> depth(parent.size(), 0);
+            for (auto n = (int)parent.size() - 2; n >= 0; n--) depth[n] = depth[parent[n]] + 1;
+
+            for (auto i = 0; i < booklen; i++) {
+                if (in_freq[i] == 0) continue;
+                codelen[i] = nleaf == 1 ? 1 : depth[codelen[i]];
+            }
+        }
+
+        auto maxlen = *std::max_element(codelen.begin(), codelen.end());
+        if (maxlen > MAX_CODELEN)
+            throw std::runtime_error(
+                "cpu::HuffmanCoarse: codeword length " + std::to_string(maxlen) + " exceeds " +
+                std::to_string(MAX_CODELEN) + " bits");
+
+        auto first = reinterpret_cast<H*>(out_revbook);
+        auto entry = first + CELL_BITWIDTH;
+        auto keys  = reinterpret_cast<T*>(out_revbook + sizeof(H) * (2 * CELL_BITWIDTH));
+
+        std::vector<H> count(CELL_BITWIDTH + 1, 0);
+        for (auto i = 0; i < booklen; i++) count[codelen[i]]++;
+        count[0] = 0;
+
+        for (auto l = 0; l < CELL_BITWIDTH; l++) first[l] = std::numeric_limits<H>::max();
+        first[maxlen] = 0;
+        for (auto l = maxlen - 1; l >= 1; l--) first[l] = (first[l + 1] + count[l + 1] + 1) >> 1;
+
+        entry[0] = 0;
+        for (auto l = 1; l < CELL_BITWIDTH; l++) entry[l] = entry[l - 1] + count[l - 1];
+
+        // symbols sorted by (length, symbol), rank within a length gives the codeword
+        std::vector<H> rank(CELL_BITWIDTH, 0);
+        for (auto i = 0; i < booklen; i++) {
+            auto l = codelen[i];
+            if (l == 0) continue;
+            keys[entry[l] + rank[l]] = static_cast<T>(i);
+            set_packed(out_book[i], first[l] + rank[l], l);
+            rank[l]++;
+        }
+    }
+
+    /**
+     * @brief Number of bits a chunk takes after encoding.
+     *
+     */
+    static M get_chunk_nbit(T* in, size_t const n, H* in_book)
+    {
+        M nbit = 0;
+#pragma omp simd reduction(+ : nbit)
+        for (size_t i = 0; i < n; i++) nbit += get_bits(in_book[in[i]]);
+        return nbit;
+    }
+
+    /**
+     * @brief Serial deflate of a chunk, MSB-first, matching the `huffman_encode_deflate` kernel output.
+     *
+     */
+    static void deflate_chunk(T* in, size_t const n, H* in_book, H* out)
+    {
+        int residue_bits = CELL_BITWIDTH;
+        H   bufr         = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            auto packed = in_book[in[i]];
+            auto width  = get_bits(packed);
+            auto word   = get_word(packed);
+
+            if (width <= residue_bits) {
+                residue_bits -= width;
+                bufr |= word << residue_bits;
+                if (residue_bits == 0) { *(out++) = bufr, bufr = 0, residue_bits = CELL_BITWIDTH; }
+            }
+            else {
+                auto l_bits = width - residue_bits;
+                auto r_bits = CELL_BITWIDTH - l_bits;
+                *(out++)    = bufr | (word >> l_bits);
+                bufr        = word << r_bits;
+                residue_bits = r_bits;
+            }
+        }
+        if (residue_bits != CELL_BITWIDTH) *out = bufr;
+    }
+
+    /**
+     * @brief Serial inflate of a chunk; host port of `single_thread_inflate`.
+     *
+     */
+    static void inflate_chunk(H* in, T* out, size_t const total_bw, BYTE* in_revbook)
+    {
+        if (total_bw == 0) return;
+
+        auto first = reinterpret_cast<H*>(in_revbook);
+        auto entry = first + CELL_BITWIDTH;
+        auto keys  = reinterpret_cast<T*>(in_revbook + sizeof(H) * (2 * CELL_BITWIDTH));
+
+        auto next_bit = [&](size_t i) { return (in[i / CELL_BITWIDTH] >> (CELL_BITWIDTH - 1 - i % CELL_BITWIDTH)) & 0x1; };
+
+        size_t i = 0, idx_out = 0;
+        while (i < total_bw) {
+            H   v = next_bit(i++);
+            int l = 1;
+            while (v < first[l]) v = (v << 1) | next_bit(i++), ++l;
+            out[idx_out++] = keys[entry[l] + v - first[l]];
+        }
+    }
+
+    /**
+     * @brief Inspect the input data; generate histogram, codebook (for encoding), reversed codebook (for decoding).
+     *
+     */
+    void inspect(T* in_uncompressed, size_t const in_uncompressed_len, int const cfg_booklen)
+    {
+        host_timer_t t;
+
+        t.timer_start();
+        get_frequency(in_uncompressed, in_uncompressed_len, freq.data(), cfg_booklen);
+        t.timer_end();
+        time_hist = t.get_time_elapsed() * 1000;
+
+        t.timer_start();
+        build_codebook(freq.data(), cfg_booklen, book.data(), revbook.data());
+        t.timer_end();
+        time_book = t.get_time_elapsed() * 1000;
+    }
+
+    /**
+     * @brief Public encode interface.
+     *
+     * @param in_uncompressed (host array)
+     * @param in_uncompressed_len (host variable)
+     * @param cfg_booklen (host variable)
+     * @param cfg_sublen (host variable)
+     * @param cfg_pardeg (host variable)
+     * @param out_compressed (host array) reference, owned by this codec
+     * @param out_compressed_len (host variable) reference output
+     */
+    void encode(
+        T*           in_uncompressed,
+        size_t const in_uncompressed_len,
+        int const    cfg_booklen,
+        int const    cfg_sublen,
+        int const    cfg_pardeg,
+        BYTE*&       out_compressed,
+        size_t&      out_compressed_len)
+    {
+        if (par_nbit.size() < (size_t)cfg_pardeg)
+            throw std::runtime_error("cpu::HuffmanCoarse: workspace allocated for a smaller pardeg.");
+
+        HEADER header;
+        host_timer_t t;
+
+        inspect(in_uncompressed, in_uncompressed_len, cfg_booklen);
+
+        t.timer_start();
+
+        // pass 1: bits per chunk, so that pass 2 can write at the final offset
+        auto& pool = cusz::ThreadPool::get_default();
+        pool.parallel_for(
+            cfg_pardeg,
+            [&](size_t begin, size_t end, int) {
+                for (auto c = begin; c < end; c++) {
+                    auto start   = c * cfg_sublen;
+                    auto n       = std::min((size_t)cfg_sublen, in_uncompressed_len - start);
+                    par_nbit[c]  = get_chunk_nbit(in_uncompressed + start, n, book.data());
+                    par_ncell[c] = (par_nbit[c] + CELL_BITWIDTH - 1) / CELL_BITWIDTH;
+                }
+            },
+            1);
+
+        par_entry[0] = 0;
+        for (auto c = 1; c < cfg_pardeg; c++) par_entry[c] = par_entry[c - 1] + par_ncell[c - 1];
+
+        header.total_nbit  = std::accumulate(par_nbit.begin(), par_nbit.begin() + cfg_pardeg, (size_t)0);
+        header.total_ncell = std::accumulate(par_ncell.begin(), par_ncell.begin() + cfg_pardeg, (size_t)0);
+
+        header.header_nbyte     = sizeof(struct header_t);
+        header.booklen          = cfg_booklen;
+        header.sublen           = cfg_sublen;
+        header.pardeg           = cfg_pardeg;
+        header.uncompressed_len = in_uncompressed_len;
+
+        MetadataT nbyte[HEADER::END];
+        nbyte[HEADER::HEADER]    = 128;
+        nbyte[HEADER::REVBOOK]   = rte.nbyte[RTE::REVBOOK];
+        nbyte[HEADER::PAR_NBIT]  = sizeof(M) * cfg_pardeg;
+        nbyte[HEADER::PAR_ENTRY] = sizeof(M) * cfg_pardeg;
+        nbyte[HEADER::BITSTREAM] = sizeof(H) * header.total_ncell;
+
+        header.entry[0] = 0;
+        // *.END + 1: need to know the ending position
+        for (auto i = 1; i < HEADER::END + 1; i++) { header.entry[i] = nbyte[i - 1]; }
+        for (auto i = 1; i < HEADER::END + 1; i++) { header.entry[i] += header.entry[i - 1]; }
+
+        compressed.assign(header.subfile_size(), 0);
+        auto bitstream = reinterpret_cast<H*>(compressed.data() + header.entry[HEADER::BITSTREAM]);
+
+        // pass 2: each chunk starts at a new cell
+        pool.parallel_for(
+            cfg_pardeg,
+            [&](size_t begin, size_t end, int) {
+                for (auto c = begin; c < end; c++) {
+                    auto start = c * cfg_sublen;
+                    auto n     = std::min((size_t)cfg_sublen, in_uncompressed_len - start);
+                    deflate_chunk(in_uncompressed + start, n, book.data(), bitstream + par_entry[c]);
+                }
+            },
+            1);
+
+        t.timer_end();
+        time_lossless = t.get_time_elapsed() * 1000;
+        milliseconds  = time_hist + time_book + time_lossless;
+
+        auto dst = compressed.data();
+        memcpy(dst, &header, sizeof(header));
+        memcpy(dst + header.entry[HEADER::REVBOOK], revbook.data(), nbyte[HEADER::REVBOOK]);
+        memcpy(dst + header.entry[HEADER::PAR_NBIT], par_nbit.data(), nbyte[HEADER::PAR_NBIT]);
+        memcpy(dst + header.entry[HEADER::PAR_ENTRY], par_entry.data(), nbyte[HEADER::PAR_ENTRY]);
+
+        out_compressed     = compressed.data();
+        out_compressed_len = header.subfile_size();
+    }
+
+    /**
+     * @brief Public decode interface.
+     *
+     * @param in_compressed (host array) input
+     * @param out_decompressed (host array) output
+     */
+    void decode(BYTE* in_compressed, T* out_decompressed)
+    {
+        HEADER header;
+        memcpy(&header, in_compressed, sizeof(header));
+
+#define ACCESSOR(SYM, TYPE) reinterpret_cast<TYPE*>(in_compressed + header.entry[HEADER::SYM])
+        auto h_revbook   = ACCESSOR(REVBOOK, BYTE);
+        auto h_par_nbit  = ACCESSOR(PAR_NBIT, M);
+        auto h_par_entry = ACCESSOR(PAR_ENTRY, M);
+        auto h_bitstream = ACCESSOR(BITSTREAM, H);
+#undef ACCESSOR
+
+        host_timer_t t;
+        t.timer_start();
+
+        cusz::ThreadPool::get_default().parallel_for(
+            header.pardeg,
+            [&](size_t begin, size_t end, int) {
+                for (auto c = begin; c < end; c++)
+                    inflate_chunk(
+                        h_bitstream + h_par_entry[c], out_decompressed + c * header.sublen, h_par_nbit[c], h_revbook);
+            },
+            1);
+
+        t.timer_end();
+        time_lossless = t.get_time_elapsed() * 1000;
+        milliseconds  = time_lossless;
+    }
+
+    // end of class definition
+};
+
+}  // namespace cpu
+}  // namespace cusz
+
+#endif
@@ -15,22 +15,25 @@
 #include <exception>
 #include <limits>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 
 #include "../../include/predictor.hh"
 #include "../common.hh"
 #include "../kernel/spline3.cuh"
 #include "../utils.hh"
+#include "../utils/workspace_pool.hh"
 
 #define DEFINE_ARRAY(VAR, TYPE) TYPE* d_##VAR{nullptr};
 
-#define ALLOCDEV(VAR, SYM, NBYTE) \
-    cudaMalloc(&d_##VAR, NBYTE);  \
+#define ALLOCDEV(VAR, SYM, NBYTE)               \
+    WorkspacePool::malloc(&d_##VAR, NBYTE); \
     cudaMemset(d_##VAR, 0x0, NBYTE);
 
-#define FREEDEV(VAR)       \
-    if (d_##VAR) {         \
-        cudaFree(d_##VAR); \
-        d_##VAR = nullptr; \
+#define FREEDEV(VAR)                  \
+    if (d_##VAR) {                    \
+        WorkspacePool::free(d_##VAR); \
+        d_##VAR = nullptr;            \
     }
 
 #define ALLOCMANAGED(VAR, SYM, NBYTE)   \
@@ -44,6 +47,8 @@ class Spline3 : public PredictorAbstraction<T, E> {
    public:
     using Precision = FP;
 
+    static const int NLEVEL = Spline3Level::NLEVEL;
+
    private:
     static const auto BLOCK = 8;
 
@@ -88,6 +93,40 @@ class Spline3 : public PredictorAbstraction<T, E> {
     float    get_time_elapsed() const { return time_elapsed; }
     uint32_t get_workspace_nbyte() const { return 0; };
 
+    size_t get_level_len(int level) const
+    {
+        return Spline3Level::get_len(level, dimx_aligned, dimy_aligned, dimz_aligned);
+    }
+
+    /**
+     * @brief A level is zero-padded to a square matrix, as the sparsity-aware reducer takes it.
+     */
+    size_t get_level_footprint(int level) const
+    {
+        auto m = Reinterpret1DTo2D::get_square_size(get_level_len(level));
+        return m * m;
+    }
+
+    /**
+     * @brief offset of `level` (1 to NLEVEL) in the level-major buffer; NLEVEL + 1 gives the buffer length
+     */
+    size_t get_level_offset(int level) const
+    {
+        size_t offset = 0;
+        for (auto l = 1; l < level; l++) offset += get_level_footprint(l);
+        return offset;
+    }
+
+    /**
+     * @brief size of the preview decoded up to `nlevel`; NLEVEL gives the full size
+     */
+    dim3 get_preview_size(int nlevel) const
+    {
+        unsigned int x, y, z;
+        Spline3Level::get_preview_dims(nlevel, dimx, dimy, dimz, x, y, z);
+        return dim3(x, y, z);
+    }
+
     /**
      * @deprecated use another construct method instead; will remove when cleaning
      */
@@ -122,11 +161,21 @@ class Spline3 : public PredictorAbstraction<T, E> {
    private:
     DEFINE_ARRAY(anchor, T);
     DEFINE_ARRAY(errctrl, E);
+    DEFINE_ARRAY(errctrl_level, E);
     DEFINE_ARRAY(outlier, T);
 
+    template <bool SPLIT>
+    void relayout(int level, cudaStream_t stream)
+    {
+        auto len = get_level_len(level);
+        cusz::spline3_errctrl_relayout<E, SPLIT><<<ConfigHelper::get_npart(len, 256), 256, 0, stream>>>  //
+            (d_errctrl, size_aligned, expose_errctrl(level), level, len);
+    }
+
    public:
     E* expose_quant() const { return d_errctrl; }
     E* expose_errctrl() const { return d_errctrl; }
+    E* expose_errctrl(int level) const { return d_errctrl_level + get_level_offset(level); }
     T* expose_anchor() const { return d_anchor; }
 
    public:
@@ -195,17 +244,22 @@ class Spline3 : public PredictorAbstraction<T, E> {
         // allocate
         auto nbyte_anchor = sizeof(T) * get_anchor_len();
         printf("nbyte_anchor: %lu\n", nbyte_anchor);
-        cudaMalloc(&d_anchor, nbyte_anchor);
+        WorkspacePool::malloc(&d_anchor, nbyte_anchor);
         cudaMemset(d_anchor, 0x0, nbyte_anchor);
 
         auto nbyte_errctrl = sizeof(E) * get_quant_footprint();
         printf("nbyte_errctrl: %lu\n", nbyte_errctrl);
-        cudaMalloc(&d_errctrl, nbyte_errctrl);
+        WorkspacePool::malloc(&d_errctrl, nbyte_errctrl);
         cudaMemset(d_errctrl, 0x0, nbyte_errctrl);
 
+        // the padding of each level stays zero
+        auto nbyte_errctrl_level = sizeof(E) * get_level_offset(NLEVEL + 1);
+        WorkspacePool::malloc(&d_errctrl_level, nbyte_errctrl_level);
+        cudaMemset(d_errctrl_level, 0x0, nbyte_errctrl_level);
+
         if (!outlier_overlapped) {
             auto nbyte_outlier = sizeof(T) * get_quant_footprint();
-            cudaMalloc(&d_outlier, nbyte_outlier);
+            WorkspacePool::malloc(&d_outlier, nbyte_outlier);
             cudaMemset(d_outlier, 0x0, nbyte_outlier);
         }
     }
@@ -214,6 +268,8 @@ class Spline3 : public PredictorAbstraction<T, E> {
     {
         FREEDEV(anchor);
         FREEDEV(errctrl);
+        FREEDEV(errctrl_level);
+        FREEDEV(outlier);
     }
 
     /**
@@ -276,6 +332,31 @@ class Spline3 : public PredictorAbstraction<T, E> {
         time_elapsed = timer.get_time_elapsed();
     }
 
+    /**
+     * @brief Lay out the error-control codes of `construct` level by level, coarse to fine, in the level-major
+     * buffer (see `expose_errctrl(level)`), so that a preview needs only the leading levels.
+     *
+     * @param stream CUDA stream
+     */
+    void split_levels(cudaStream_t stream = nullptr)
+    {
+        for (auto l = 1; l <= NLEVEL; l++) relayout<true>(l, stream);
+        CHECK_CUDA(cudaStreamSynchronize(stream));
+    }
+
+    /**
+     * @brief Inverse of `split_levels` for levels 1 to `nlevel`; the codes of finer levels are left as they are and
+     * not read by `reconstruct` up to `nlevel`.
+     *
+     * @param nlevel (host variable) 0 (anchors only) to NLEVEL
+     * @param stream CUDA stream
+     */
+    void merge_levels(int nlevel, cudaStream_t stream = nullptr)
+    {
+        for (auto l = 1; l <= nlevel; l++) relayout<false>(l, stream);
+        CHECK_CUDA(cudaStreamSynchronize(stream));
+    }
+
     /**
      * @brief Reconstruct data from error-control code & outlier; outlier and output overlap each other; destructive for
      * outlier.
@@ -286,6 +367,8 @@ class Spline3 : public PredictorAbstraction<T, E> {
      * @param cfg_radius (host variable) radius to control the bound; configuration
      * @param in_outlier__out_xdata (device array) output reconstructed data, overlapped with input outlier
      * @param stream CUDA stream
+     * @param nlevel (host variable) stop after this level; below NLEVEL, the output is the preview of
+     * `get_preview_size(nlevel)`, the stride-(8 >> nlevel) subsampling of the data, still within the error bound
      */
     void reconstruct(
         TITER        in_anchor,
@@ -293,11 +376,18 @@ class Spline3 : public PredictorAbstraction<T, E> {
         double const cfg_eb,
         int const    cfg_radius,
         TITER        in_outlier__out_xdata,
-        cudaStream_t stream = nullptr)
+        cudaStream_t stream = nullptr,
+        int const    nlevel = NLEVEL)
     {
+        if (nlevel < 0 or nlevel > NLEVEL)
+            throw std::runtime_error("spline3::reconstruct: level must be 0 to " + std::to_string(NLEVEL));
+
         auto ebx2 = cfg_eb * 2;
         auto eb_r = 1 / cfg_eb;
 
+        auto out_size = get_preview_size(nlevel);
+        auto out_leap = dim3(1, out_size.x, out_size.x * out_size.y);
+
         cuda_timer_t timer;
         timer.timer_start();
 
@@ -305,8 +395,8 @@ class Spline3 : public PredictorAbstraction<T, E> {
             <<<dim3(nblockx, nblocky, nblockz), dim3(256, 1, 1), 0, stream>>>  //
             (in_errctrl, size_aligned, leap_aligned,                           //
              in_anchor, anchor_size, anchor_leap,                              //
-             in_outlier__out_xdata, size, leap,                                //
-             eb_r, ebx2, cfg_radius);
+             in_outlier__out_xdata, out_size, out_leap,                        //
+             eb_r, ebx2, cfg_radius, nlevel);
 
         timer.timer_end();
 
@@ -0,0 +1,483 @@
+/**
+ * @file spbitpack.hh
+ * @author Jiannan Tian
+ * @brief Host sparse reducer: per chunk, either sorted indices as delta + 4-lane bitpacked 128-blocks, or a presence
+ * bitmap, whichever is smaller; plus values.
+ * @version 0.3
+ * @date 2022-03-11
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_WRAPPER_SPBITPACK_HH
+#define CUSZ_WRAPPER_SPBITPACK_HH
+
+#include <algorithm>
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "../../include/reducer.hh"
+#include "../common/definition.hh"
+#include "../utils/thread_pool.hh"
+#include "../utils/timer.hh"
+
+namespace cusz {
+namespace cpu {
+
+/**
+ * @brief Bitpacking of up to 128 uint32 in 4 interleaved lanes (value j goes to lane j % 4), so that the inner loop
+ * over lanes maps to one SSE/NEON register; a full block takes `b` words per lane, a partial one of `nrow` rows
+ * takes ceil(nrow * b / 32).
+ *
+ */
+struct BitpackHelper {
+    static const int BLOCK = 128;
+    static const int LANE  = 4;
+
+    static int get_bitwidth(uint32_t v) { return v == 0 ? 0 : 32 - __builtin_clz(v); }
+
+    static int get_block_bitwidth(const uint32_t* in)
+    {
+        uint32_t acc = 0;
+#pragma omp simd reduction(| : acc)
+        for (auto i = 0; i < BLOCK; i++) acc |= in[i];
+        return get_bitwidth(acc);
+    }
+
+    static int get_nword(int b, int nrow = BLOCK / LANE) { return LANE * ((nrow * b + 31) / 32); }
+
+    static void pack(const uint32_t* in, int b, uint32_t* out, int nrow = BLOCK / LANE)
+    {
+        std::fill(out, out + get_nword(b, nrow), 0u);
+        if (b == 0) return;
+
+        for (auto k = 0; k < nrow; k++) {
+            auto pos = k * b, w = pos / 32, s = pos % 32;
+#pragma omp simd
+            for (auto l = 0; l < LANE; l++) {
+                auto v = in[k * LANE + l];
+                out[w * LANE + l] |= v << s;
+                if (s + b > 32) out[(w + 1) * LANE + l] |= v >> (32 - s);
+            }
+        }
+    }
+
+    static void unpack(const uint32_t* in, int b, uint32_t* out, int nrow = BLOCK / LANE)
+    {
+        if (b == 0) {
+            std::fill(out, out + LANE * nrow, 0u);
+            return;
+        }
+        uint32_t mask = b == 32 ? ~0u : (1u << b) - 1;
+
+        for (auto k = 0; k < nrow; k++) {
+            auto pos = k * b, w = pos / 32, s = pos % 32;
+#pragma omp simd
+            for (auto l = 0; l < LANE; l++) {
+                auto v = in[w * LANE + l] >> s;
+                if (s + b > 32) v |= in[(w + 1) * LANE + l] << (32 - s);
+                out[k * LANE + l] = v & mask;
+            }
+        }
+    }
+};
+
+template <typename T = float>
+class SpBitpack : public VirtualGatherScatter {
+   public:
+    using Origin    = T;
+    using BYTE      = uint8_t;
+    using MetadataT = uint32_t;
+    using WORD      = uint32_t;
+
+    static const int DEFAULT_CHUNK_LEN = 1 << 16;
+
+    /**
+     * @brief How the positions of a chunk are stored; decided per chunk from the measured count.
+     *
+     */
+    struct chunk_kind {
+        static const BYTE EMPTY  = 0;  // no outlier, no IDX words
+        static const BYTE LIST   = 1;  // delta + bitpacked blocks
+        static const BYTE BITMAP = 2;  // 1 bit per element, ceil(chunk_len / 32) words
+        static const int  END    = 3;
+    };
+
+   public:
+    /******************************************************************************
+                                   header definition
+     ******************************************************************************/
+    struct header_t {
+        static const int HEADER     = 0;
+        static const int CHUNK_NNZ  = 1;
+        static const int CHUNK_KIND = 2;
+        static const int CHUNK_IDX  = 3;  // starting word of a chunk in IDX
+        static const int IDX        = 4;
+        static const int VAL        = 5;
+        static const int END        = 6;
+
+        int       header_nbyte : 16;
+        int       chunk_len;
+        int       nchunk;
+        size_t    uncompressed_len;
+        int64_t   nnz;
+        MetadataT entry[END + 1];
+
+        MetadataT subfile_size() const { return entry[END]; }
+    };
+    using HEADER = struct header_t;
+
+    /******************************************************************************
+                                     runtime helper
+     ******************************************************************************/
+    struct runtime_encode_helper {
+        static const int SP        = 0;
+        static const int CHUNK_NNZ = 1;
+        static const int CHUNK_IDX = 2;
+        static const int END       = 3;
+
+        uint32_t nbyte[END];
+
+        int     chunk_len{DEFAULT_CHUNK_LEN};
+        int     nchunk{0};
+        int64_t nnz{0};
+        size_t  nword{0};
+        int     nchunk_of[chunk_kind::END];  // for report
+    };
+    using RTE = runtime_encode_helper;
+    RTE rte;
+
+   private:
+    std::vector<BYTE>      sp;
+    std::vector<MetadataT> chunk_nnz, chunk_nword, chunk_idx, chunk_val;
+    std::vector<BYTE>      chunk_kind_of;
+
+    float milliseconds{0.0};
+
+    /**
+     * @brief Words one block of `n` deltas takes: a bitwidth word followed by the payload.
+     *
+     */
+    static size_t get_block_nword(int b, int n) { return 1 + BitpackHelper::get_nword(b, get_nrow(n)); }
+    static int    get_nrow(int n) { return (n + BitpackHelper::LANE - 1) / BitpackHelper::LANE; }
+    static size_t get_bitmap_nword(size_t n) { return (n + 31) / 32; }
+
+    /**
+     * @brief Visit the deltas of a chunk block by block; `fn(deltas[128], n_valid)`.
+     * Delta is `idx - prev_idx - 1`, the first one relative to -1, hence 0 for adjacent outliers.
+     */
+    template <typename FN>
+    static void for_each_block(T* in, size_t start, size_t end, FN fn)
+    {
+        uint32_t deltas[BitpackHelper::BLOCK];
+        int64_t  prev = -1;
+        int      n    = 0;
+        for (auto i = start; i < end; i++) {
+            if (in[i] == 0) continue;
+            auto local  = (int64_t)(i - start);
+            deltas[n++] = (uint32_t)(local - prev - 1);
+            prev        = local;
+            if (n == BitpackHelper::BLOCK) fn(deltas, n), n = 0;
+        }
+        if (n != 0) {
+            std::fill(deltas + n, deltas + BitpackHelper::BLOCK, 0u);
+            fn(deltas, n);
+        }
+    }
+
+    static void get_bitmap(T* in, size_t start, size_t end, WORD* out)
+    {
+        for (auto base = start, k = (size_t)0; base < end; base += 32, k++) {
+            auto n    = std::min((size_t)32, end - base);
+            WORD bits = 0;
+#pragma omp simd reduction(| : bits)
+            for (size_t j = 0; j < n; j++) bits |= WORD(in[base + j] != 0) << j;
+            out[k] = bits;
+        }
+    }
+
+   public:
+    float get_time_elapsed() const { return milliseconds; }
+    int   get_nchunk_of(BYTE kind) const { return rte.nchunk_of[kind]; }
+
+    SpBitpack()  = default;
+    ~SpBitpack() = default;
+
+    // only placeholding
+    void scatter() {}
+    void gather() {}
+
+    /**
+     * @brief Allocate according to the input; reserve as CSR11 does, with `len / density_factor` as the nnz guess.
+     *
+     * @param in_uncompressed_len (host variable) input length
+     * @param density_factor assumed 1/density for reservation
+     * @param dbg_print print for debugging
+     */
+    void allocate_workspace(size_t const in_uncompressed_len, int density_factor = 4, bool dbg_print = false)
+    {
+        memset(rte.nbyte, 0, sizeof(uint32_t) * RTE::END);
+
+        rte.nchunk = (in_uncompressed_len + rte.chunk_len - 1) / rte.chunk_len;
+
+        auto init_nnz = in_uncompressed_len / density_factor;
+
+        rte.nbyte[RTE::SP]        = 128 + 2 * sizeof(MetadataT) * rte.nchunk + (sizeof(T) + sizeof(WORD)) * init_nnz;
+        rte.nbyte[RTE::CHUNK_NNZ] = sizeof(MetadataT) * rte.nchunk;
+        rte.nbyte[RTE::CHUNK_IDX] = sizeof(MetadataT) * rte.nchunk;
+
+        sp.reserve(rte.nbyte[RTE::SP]);
+        chunk_nnz.assign(rte.nchunk, 0);
+        chunk_nword.assign(rte.nchunk, 0);
+        chunk_idx.assign(rte.nchunk, 0);
+        chunk_val.assign(rte.nchunk, 0);
+        chunk_kind_of.assign(rte.nchunk, (BYTE)chunk_kind::EMPTY);
+
+        if (dbg_print) {
+            setlocale(LC_NUMERIC, "");
+            printf("\ncpu::SpBitpack::allocate_workspace() debugging:\n");
+            printf("%-*s:  %'10ld\n", 16, "init.nnz", init_nnz);
+            printf("%-*s:  %'10d\n", 16, "nchunk", rte.nchunk);
+            printf("nbyte-%-*s:  %'10u\n", 10, "SP", rte.nbyte[RTE::SP]);
+            printf("\n");
+        }
+    }
+
+    void clear_buffer()
+    {
+        sp.clear();
+        std::fill(chunk_nnz.begin(), chunk_nnz.end(), 0);
+        std::fill(chunk_nword.begin(), chunk_nword.end(), 0);
+        std::fill(chunk_idx.begin(), chunk_idx.end(), 0);
+        std::fill(chunk_val.begin(), chunk_val.end(), 0);
+        std::fill(chunk_kind_of.begin(), chunk_kind_of.end(), (BYTE)chunk_kind::EMPTY);
+    }
+
+   private:
+    /**
+     * @brief Lay out the header and per-chunk metadata once sizes are known.
+     *
+     */
+    void subfile_collect(HEADER& header, size_t in_uncompressed_len, bool dbg_print = false)
+    {
+        header.header_nbyte     = sizeof(HEADER);
+        header.chunk_len        = rte.chunk_len;
+        header.nchunk           = rte.nchunk;
+        header.uncompressed_len = in_uncompressed_len;
+        header.nnz              = rte.nnz;
+
+        MetadataT nbyte[HEADER::END];
+        nbyte[HEADER::HEADER]    = 128;
+        nbyte[HEADER::CHUNK_NNZ]  = sizeof(MetadataT) * rte.nchunk;
+        nbyte[HEADER::CHUNK_KIND] = (sizeof(BYTE) * rte.nchunk + 3) / 4 * 4;
+        nbyte[HEADER::CHUNK_IDX]  = sizeof(MetadataT) * rte.nchunk;
+        nbyte[HEADER::IDX]        = (sizeof(WORD) * rte.nword + 7) / 8 * 8;  // keep VAL 8-byte aligned
+        nbyte[HEADER::VAL]        = sizeof(T) * rte.nnz;
+
+        header.entry[0] = 0;
+        // *.END + 1; need to knwo the ending position
+        for (auto i = 1; i < HEADER::END + 1; i++) { header.entry[i] = nbyte[i - 1]; }
+        for (auto i = 1; i < HEADER::END + 1; i++) { header.entry[i] += header.entry[i - 1]; }
+
+        if (dbg_print) {
+            printf("\ncpu::SpBitpack::subfile_collect() debugging:\n");
+            printf("%-*s:  %'10ld\n", 16, "final.nnz", rte.nnz);
+            printf("%-*s:  %'10lu\n", 16, "final.nword", rte.nword);
+            printf("%-*s:  %d/%d/%d\n", 16, "empty/list/bitmap", rte.nchunk_of[chunk_kind::EMPTY],
+                   rte.nchunk_of[chunk_kind::LIST], rte.nchunk_of[chunk_kind::BITMAP]);
+#define PRINT_ENTRY(VAR) printf("%d %-*s:  %'10u\n", (int)HEADER::VAR, 14, #VAR, header.entry[HEADER::VAR]);
+            PRINT_ENTRY(HEADER);
+            PRINT_ENTRY(CHUNK_NNZ);
+            PRINT_ENTRY(CHUNK_KIND);
+            PRINT_ENTRY(CHUNK_IDX);
+            PRINT_ENTRY(IDX);
+            PRINT_ENTRY(VAL);
+            PRINT_ENTRY(END);
+            printf("\n");
+#undef PRINT_ENTRY
+        }
+
+        sp.assign(header.subfile_size(), 0);
+        memcpy(sp.data(), &header, sizeof(header));
+        memcpy(sp.data() + header.entry[HEADER::CHUNK_NNZ], chunk_nnz.data(), nbyte[HEADER::CHUNK_NNZ]);
+        memcpy(sp.data() + header.entry[HEADER::CHUNK_KIND], chunk_kind_of.data(), sizeof(BYTE) * rte.nchunk);
+        memcpy(sp.data() + header.entry[HEADER::CHUNK_IDX], chunk_idx.data(), nbyte[HEADER::CHUNK_IDX]);
+    }
+
+   public:
+    /**
+     * @brief Public interface for gather method.
+     * Pass 1 counts every chunk and picks the smaller of list and bitmap, a scan gives the offsets, pass 2 writes
+     * each chunk in place.
+     *
+     * @param in_uncompressed (host array) input; nonzero means outlier
+     * @param in_uncompressed_len (host variable) input length
+     * @param out_compressed (host array) reference output, owned by this reducer
+     * @param out_compressed_len (host variable) reference output length
+     */
+    void gather(
+        T*           in_uncompressed,
+        size_t const in_uncompressed_len,
+        BYTE*&       out_compressed,
+        size_t&      out_compressed_len,
+        bool         dbg_print = false)
+    {
+        HEADER       header;
+        host_timer_t t;
+        t.timer_start();
+
+        rte.nchunk = (in_uncompressed_len + rte.chunk_len - 1) / rte.chunk_len;
+        if (chunk_nnz.size() < (size_t)rte.nchunk) {
+            chunk_nnz.resize(rte.nchunk), chunk_nword.resize(rte.nchunk);
+            chunk_idx.resize(rte.nchunk), chunk_val.resize(rte.nchunk);
+            chunk_kind_of.resize(rte.nchunk);
+        }
+
+        auto chunk_range = [&](size_t c, size_t& start, size_t& end) {
+            start = c * rte.chunk_len;
+            end   = std::min(start + rte.chunk_len, in_uncompressed_len);
+        };
+
+        auto& pool = cusz::ThreadPool::get_default();
+        pool.parallel_for(rte.nchunk, [&](size_t first, size_t last, int) {
+            for (auto c = first; c < last; c++) {
+                size_t start, end;
+                chunk_range(c, start, end);
+                MetadataT nnz = 0, nword = 0;
+                for_each_block(in_uncompressed, start, end, [&](uint32_t* deltas, int n) {
+                    nnz += n;
+                    nword += get_block_nword(BitpackHelper::get_block_bitwidth(deltas), n);
+                });
+                chunk_nnz[c] = nnz;
+
+                auto bitmap_nword = get_bitmap_nword(end - start);
+                if (nnz == 0)
+                    chunk_kind_of[c] = chunk_kind::EMPTY, chunk_nword[c] = 0;
+                else if (nword <= bitmap_nword)
+                    chunk_kind_of[c] = chunk_kind::LIST, chunk_nword[c] = nword;
+                else
+                    chunk_kind_of[c] = chunk_kind::BITMAP, chunk_nword[c] = bitmap_nword;
+            }
+        });
+
+        size_t nnz = 0, nword = 0;
+        std::fill(rte.nchunk_of, rte.nchunk_of + chunk_kind::END, 0);
+        for (auto c = 0; c < rte.nchunk; c++) {
+            rte.nchunk_of[chunk_kind_of[c]]++;
+            chunk_val[c] = nnz, chunk_idx[c] = nword;
+            nnz += chunk_nnz[c], nword += chunk_nword[c];
+        }
+        if (nword > UINT32_MAX or sizeof(T) * nnz > UINT32_MAX)
+            throw std::runtime_error("cpu::SpBitpack: outlier section exceeds 4 GB.");
+        rte.nnz = nnz, rte.nword = nword;
+
+        subfile_collect(header, in_uncompressed_len, dbg_print);
+
+        auto idx = reinterpret_cast<WORD*>(sp.data() + header.entry[HEADER::IDX]);
+        auto val = reinterpret_cast<T*>(sp.data() + header.entry[HEADER::VAL]);
+
+        pool.parallel_for(rte.nchunk, [&](size_t first, size_t last, int) {
+            for (auto c = first; c < last; c++) {
+                size_t start, end;
+                chunk_range(c, start, end);
+                if (chunk_kind_of[c] == chunk_kind::EMPTY) continue;
+
+                auto w = idx + chunk_idx[c];
+                auto v = val + chunk_val[c];
+                if (chunk_kind_of[c] == chunk_kind::LIST)
+                    for_each_block(in_uncompressed, start, end, [&](uint32_t* deltas, int n) {
+                        auto b = BitpackHelper::get_block_bitwidth(deltas);
+                        *(w++) = b;
+                        BitpackHelper::pack(deltas, b, w, get_nrow(n));
+                        w += BitpackHelper::get_nword(b, get_nrow(n));
+                    });
+                else
+                    get_bitmap(in_uncompressed, start, end, w);
+
+                for (auto i = start; i < end; i++)
+                    if (in_uncompressed[i] != 0) *(v++) = in_uncompressed[i];
+            }
+        });
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+
+        out_compressed     = sp.data();
+        out_compressed_len = header.subfile_size();
+    }
+
+    /**
+     * @brief Public interface for scatter; the whole output range is written (zeros where no outlier).
+     *
+     * @param in_compressed (host array)
+     * @param out_decompressed (host array)
+     */
+    void scatter(BYTE* in_compressed, T* out_decompressed)
+    {
+        HEADER header;
+        memcpy(&header, in_compressed, sizeof(header));
+
+#define ACCESSOR(SYM, TYPE) reinterpret_cast<TYPE*>(in_compressed + header.entry[HEADER::SYM])
+        auto h_chunk_nnz  = ACCESSOR(CHUNK_NNZ, MetadataT);
+        auto h_chunk_kind = ACCESSOR(CHUNK_KIND, BYTE);
+        auto h_chunk_idx  = ACCESSOR(CHUNK_IDX, MetadataT);
+        auto h_idx        = ACCESSOR(IDX, WORD);
+        auto h_val        = ACCESSOR(VAL, T);
+#undef ACCESSOR
+
+        host_timer_t t;
+        t.timer_start();
+
+        std::vector<MetadataT> val_entry(header.nchunk);
+        for (MetadataT c = 0, acc = 0; c < (MetadataT)header.nchunk; c++) val_entry[c] = acc, acc += h_chunk_nnz[c];
+
+        cusz::ThreadPool::get_default().parallel_for(header.nchunk, [&](size_t first, size_t last, int) {
+            for (auto c = first; c < last; c++) {
+                auto start = c * header.chunk_len;
+                auto end   = std::min(start + header.chunk_len, header.uncompressed_len);
+                std::fill(out_decompressed + start, out_decompressed + end, T(0));
+
+                auto w = h_idx + h_chunk_idx[c];
+                auto v = h_val + val_entry[c];
+
+                if (h_chunk_kind[c] == chunk_kind::BITMAP) {
+                    for (size_t k = 0; k < get_bitmap_nword(end - start); k++)
+                        for (auto bits = w[k]; bits != 0; bits &= bits - 1)
+                            out_decompressed[start + 32 * k + __builtin_ctz(bits)] = *(v++);
+                    continue;
+                }
+
+                uint32_t deltas[BitpackHelper::BLOCK];
+                int64_t  prev = -1;
+
+                for (MetadataT done = 0; done < h_chunk_nnz[c];) {
+                    int  b = *(w++);
+                    auto n = std::min((MetadataT)BitpackHelper::BLOCK, h_chunk_nnz[c] - done);
+                    BitpackHelper::unpack(w, b, deltas, get_nrow(n));
+                    w += BitpackHelper::get_nword(b, get_nrow(n));
+
+                    for (MetadataT j = 0; j < n; j++) {
+                        prev += deltas[j] + 1;
+                        out_decompressed[start + prev] = *(v++);
+                    }
+                    done += n;
+                }
+            }
+        });
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+    }
+
+    // end of class
+};
+
+}  // namespace cpu
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file spgs_cpu.hh
+ * @author Jiannan Tian
+ * @brief Host counterpart of spGS; gather by parallel stream compaction, scatter by parallel loop.
+ * @version 0.3
+ * @date 2022-03-11
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#ifndef CUSZ_WRAPPER_SPGS_CPU_HH
+#define CUSZ_WRAPPER_SPGS_CPU_HH
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "../utils/thread_pool.hh"
+#include "../utils/timer.hh"
+#include "glue_cpu.hh"
+
+namespace cusz {
+namespace cpu {
+
+template <typename T = float>
+class spGS {
+   public:
+    using Origin = T;
+
+   private:
+    unsigned int len;
+    int*         idx;
+    T*           val;
+    float        milliseconds{0.0};
+
+    int nnz;
+
+   public:
+    float get_time_elapsed() const { return milliseconds; }
+
+   public:
+    uint32_t get_total_nbyte(uint32_t len, int nnz) { return sizeof(int) * nnz + sizeof(T) * nnz; }
+
+    /**
+     * @brief as cusz::spGS::gather, without the unused `nullarray`; all arrays on host, `out_idx`/`out_val` provided by
+     * caller
+     *
+     */
+    void gather(T* in, uint32_t in_len, int*& out_idx, T*& out_val, int& out_nnz, unsigned int& dump_nbyte)
+    {
+        this->idx = out_idx;
+        this->val = out_val;
+
+        host_timer_t t;
+        t.timer_start();
+
+        auto _idx = out_idx;
+        auto _val = out_val;
+        out_nnz   = stream_compact<int>(
+            in_len, [&](size_t i) { return in[i] != 0; },
+            [&](int pos, size_t i) {
+                _idx[pos] = i;
+                _val[pos] = in[i];
+            });
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+
+        this->nnz  = out_nnz;
+        dump_nbyte = (sizeof(int) + sizeof(T)) * out_nnz;
+    }
+
+    spGS& consolidate(uint8_t* dst)
+    {
+        auto nbyte_idx = nnz * sizeof(int);
+        auto nbyte_val = nnz * sizeof(T);
+        // index first
+        memcpy(dst, /*       */ idx, nbyte_idx);
+        memcpy(dst + nbyte_idx, val, nbyte_val);
+
+        return *this;
+    }
+
+    void scatter(int*& in_idx, T*& in_val, int nnz, T* out)
+    {
+        host_timer_t t;
+        t.timer_start();
+
+        auto _idx = in_idx;
+        auto _val = in_val;
+        cusz::ThreadPool::get_default().parallel_for(nnz, [&](size_t begin, size_t end, int) {
+            for (auto i = begin; i < end; i++) out[_idx[i]] = _val[i];
+        });
+
+        t.timer_end();
+        milliseconds = t.get_time_elapsed() * 1000;
+    }
+
+    void scatter(uint8_t* _pool, int nnz, T* out, uint32_t out_len)
+    {
+        if (nnz < 0 or (uint32_t)nnz > out_len) throw std::runtime_error("cpu::spGS: nnz exceeds the output length.");
+
+        auto nbyte_idx = nnz * sizeof(int);
+        auto in_idx    = reinterpret_cast<int*>(_pool);
+        auto in_val    = reinterpret_cast<T*>(_pool + (nbyte_idx));
+
+        scatter(in_idx, in_val, nnz, out);
+    }
+};
+
+}  // namespace cpu
+}  // namespace cusz
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file test_batch.cu
+ * @author Jiannan Tian
+ * @brief batch compression round trip: fields of mixed shapes (shapes repeated, so that workers reuse compressors),
+ * one relative to its value range, in two batches on the same workers; every archive decompresses within its error
+ * bound
+ * @version 0.3
+ * @date 2022-03-28
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "app.cuh"
+
+using std::cout;
+using std::endl;
+
+using app_t = cusz::app<float>;
+
+std::vector<float> field(dim3_compat d, int seed)
+{
+    std::vector<float> f((size_t)d.x * d.y * d.z);
+    for (size_t z = 0; z < d.z; z++)
+        for (size_t y = 0; y < d.y; y++)
+            for (size_t x = 0; x < d.x; x++)
+                f[x + d.x * (y + d.y * z)] = seed + sinf(0.05f * x + seed) * cosf(0.07f * y) + 0.01f * z;
+    return f;
+}
+
+int main()
+{
+    std::vector<dim3_compat> shapes = {
+        {3600, 1800, 1}, {100, 500, 1}, {100, 500, 1}, {64, 64, 64}, {100, 500, 1}, {64, 64, 64}, {4096, 1, 1}};
+
+    std::vector<std::vector<float>> data;
+    std::vector<app_t::batch_job_t> jobs;
+    for (auto i = 0u; i < shapes.size(); i++) {
+        data.push_back(field(shapes[i], i));
+        jobs.push_back({data.back().data(), shapes[i], 1e-3, false});
+    }
+    jobs[3].eb = 1e-4, jobs[3].r2r = true;  // relative to the value range of the field
+
+    cuszCTX     base("mode=abs,radius=512");
+    auto        pass = true;
+    app_t       app;
+    std::string fname = "test_batch.tmp";
+
+    // the second batch runs on the workers, and compressors, the first one left
+    for (auto round = 0; round < 2; round++) {
+        auto results = app_t::cusz_compress_batch(jobs, &base, 3);
+        pass         = pass and results.size() == jobs.size();
+
+        for (auto i = 0u; i < results.size(); i++) {
+            auto const& r = results[i];
+            if (not r.error.empty()) {
+                cout << i << "\t" << r.error << endl;
+                pass = false;
+                continue;
+            }
+            io::write_array_to_binary(fname, r.archive.data(), r.archive.size());
+
+            auto const&        d = data[i];
+            std::vector<float> xd(d.size());
+            app.decompress(fname, xd.data());
+
+            double max_err = 0;
+            for (size_t j = 0; j < d.size(); j++) max_err = std::max(max_err, (double)fabs(xd[j] - d[j]));
+            auto ok = max_err <= r.eb * 1.001;
+            cout << round << ":" << i << "\t" << shapes[i].x << "x" << shapes[i].y << "x" << shapes[i].z << "\tworker "
+                 << r.worker << "\tCR " << r.cr << "\tmax err " << max_err << " (eb " << r.eb << ")\t"
+                 << (ok ? "ok" : "wrong") << endl;
+            pass = pass and ok;
+        }
+    }
+    std::remove(fname.c_str());
+    app_t::destroy_batch_workers();
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
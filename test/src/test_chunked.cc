@@ -0,0 +1,235 @@
+/**
+ * @file test_chunked.cc
+ * @author Jiannan Tian
+ * @brief brick tiling, slab streaming, chunked container and region query; raw payloads stand in for archives
+ * @version 0.3
+ * @date 2022-03-14
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <vector>
+#include "../src/chunked.hh"
+
+using std::cout;
+using std::endl;
+
+bool f(dim3_compat field, dim3_compat brick)
+{
+    auto               len = (size_t)field.x * field.y * field.z;
+    std::vector<float> data(len), rebuilt(len, -1);
+    std::iota(data.begin(), data.end(), 0);
+
+    std::string      fname = "test_chunked.tmp";
+    cusz::BrickLayout layout(field, brick);
+    uint32_t const    zero[3] = {0, 0, 0};
+
+    {
+        cusz::ChunkedArchiveWriter writer(fname, field, brick, sizeof(float), 1e-4, false);
+        std::vector<float>         blob;
+        // write in reverse order; the index must not depend on the write order
+        for (auto i = layout.size(); i-- > 0;) {
+            uint32_t origin[3], extent[3];
+            layout.get_brick(i, origin, extent);
+            blob.resize((size_t)extent[0] * extent[1] * extent[2]);
+            cusz::copy_box(data.data(), field, origin, blob.data(), {extent[0], extent[1], extent[2]}, zero, extent);
+            writer.append(origin, extent, reinterpret_cast<uint8_t*>(blob.data()), blob.size() * sizeof(float));
+        }
+        writer.finalize();
+    }
+
+    auto ok = cusz::ChunkedArchiveReader::is_chunked(fname);
+
+    cusz::ChunkedArchiveReader reader(fname);
+    std::vector<uint8_t>       blob;
+    for (size_t i = 0; i < reader.get_index().size(); i++) {
+        auto const& b = reader.get_index()[i];
+        reader.read_brick(i, blob);
+        cusz::copy_box(
+            reinterpret_cast<float*>(blob.data()), {b.extent[0], b.extent[1], b.extent[2]}, zero, rebuilt.data(),
+            reader.get_field(), b.origin, b.extent);
+    }
+
+    // region: a slab through the middle, straddling brick boundaries
+    cusz::chunked_region_t region{
+        {field.x / 3, field.y / 2, field.z / 4}, {field.x - field.x / 5, field.y / 2 + 1, field.z}};
+    std::vector<float> sub(region.get_len(), -1), ref(region.get_len());
+    uint32_t           extent[3] = {region.get_dims().x, region.get_dims().y, region.get_dims().z};
+    cusz::copy_box(data.data(), field, region.lo, ref.data(), region.get_dims(), zero, extent);
+
+    auto hit = reader.query(region);
+    for (auto i : hit) {
+        reader.read_brick(i, blob);
+        region.copy_from_brick(reinterpret_cast<float*>(blob.data()), reader.get_index()[i], sub.data());
+    }
+    std::remove(fname.c_str());
+
+    ok = ok and reader.get_index().size() == layout.size() and rebuilt == data and sub == ref;
+    cout << "field " << field.x << "x" << field.y << "x" << field.z << "\tbrick " << brick.x << "x" << brick.y << "x"
+         << brick.z << "\tnbrick=" << layout.size() << "\tregion hits " << hit.size() << "\t" << (ok ? "ok" : "wrong")
+         << endl;
+    return ok;
+}
+
+// slab-wise tiling from a raw file must yield the same bricks as tiling the resident field
+bool g(dim3_compat field, dim3_compat brick)
+{
+    auto               len = (size_t)field.x * field.y * field.z;
+    std::vector<float> data(len);
+    std::iota(data.begin(), data.end(), 0);
+
+    std::string fname = "test_slab.tmp";
+    {
+        std::ofstream ofs(fname, std::ios::binary);
+        ofs.write(reinterpret_cast<char*>(data.data()), sizeof(float) * len);
+    }
+
+    if (brick.x == 0) brick = cusz::BrickLayout::get_slab_brick(field, sizeof(float), 1 << 16);
+    cusz::BrickLayout       layout(field, brick);
+    cusz::SlabReader<float> reader(fname, field, layout.get_plane_len());
+    auto                    axis = layout.get_slab_axis();
+    std::vector<float>      slab, from_slab, from_field;
+    uint32_t const          zero[3] = {0, 0, 0};
+    auto                    ok      = true;
+
+    for (size_t s = 0; s < layout.get_nslab(); s++) {
+        uint32_t plane_begin, plane_end;
+        layout.get_slab(s, plane_begin, plane_end);
+        slab.resize(layout.get_plane_len() * (plane_end - plane_begin));
+        reader.read(plane_begin, plane_end, slab.data());
+
+        uint32_t slab_dims[3] = {field.x, field.y, field.z};
+        slab_dims[axis]       = plane_end - plane_begin;
+
+        for (auto i = s * layout.get_nbrick_per_slab(); i < (s + 1) * layout.get_nbrick_per_slab(); i++) {
+            uint32_t origin[3], extent[3], local[3];
+            layout.get_brick(i, origin, extent);
+            for (auto d = 0; d < 3; d++) local[d] = origin[d];
+            local[axis] -= plane_begin;
+
+            from_slab.assign((size_t)extent[0] * extent[1] * extent[2], -1);
+            from_field.assign(from_slab.size(), -2);
+            cusz::copy_box(
+                slab.data(), {slab_dims[0], slab_dims[1], slab_dims[2]}, local, from_slab.data(),
+                {extent[0], extent[1], extent[2]}, zero, extent);
+            cusz::copy_box(
+                data.data(), field, origin, from_field.data(), {extent[0], extent[1], extent[2]}, zero, extent);
+            ok = ok and from_slab == from_field;
+        }
+    }
+    std::remove(fname.c_str());
+
+    cout << "slabs: field " << field.x << "x" << field.y << "x" << field.z << "\tbrick " << brick.x << "x" << brick.y
+         << "x" << brick.z << "\tnslab=" << layout.get_nslab() << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+// a writer unwound before finalize(), e.g., by an error, leaves no archive behind
+bool h()
+{
+    std::string    fname = "test_abandoned.tmp";
+    uint32_t const zero[3] = {0, 0, 0}, one[3] = {1, 1, 1};
+    uint8_t        blob[4] = {0};
+
+    auto refused = false;
+    try {
+        cusz::ChunkedArchiveWriter writer(fname, {1, 1, 2}, {1, 1, 1}, 4, 1e-4, false);
+        writer.append(zero, one, blob, sizeof(blob));
+        writer.finalize();  // one of two bricks
+    }
+    catch (const std::runtime_error&) {
+        refused = true;
+    }
+    {
+        cusz::ChunkedArchiveWriter writer(fname, {1, 1, 2}, {1, 1, 1}, 4, 1e-4, false);
+        writer.append(zero, one, blob, sizeof(blob));
+    }
+
+    std::ifstream probe(fname);
+    auto          ok = refused and not probe.is_open();
+    cout << "abandoned writer\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+// a footer that claims more index than the file holds, or a flipped index byte, is rejected before use
+bool k()
+{
+    std::string    fname = "test_corrupt.tmp";
+    uint32_t const zero[3] = {0, 0, 0}, one[3] = {1, 1, 1};
+    uint8_t        blob[4] = {0};
+    {
+        cusz::ChunkedArchiveWriter writer(fname, {1, 1, 1}, {1, 1, 1}, 4, 1e-4, false);
+        writer.append(zero, one, blob, sizeof(blob));
+        writer.finalize();
+    }
+
+    std::vector<char> good;
+    {
+        std::ifstream ifs(fname, std::ios::binary);
+        good.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    auto rejects = [&](std::vector<char> const& bytes) {
+        {
+            std::ofstream ofs(fname, std::ios::binary | std::ios::trunc);
+            ofs.write(bytes.data(), bytes.size());
+        }
+        try {
+            cusz::ChunkedArchiveReader r(fname);
+        }
+        catch (const std::runtime_error& e) {
+            cout << "caught: " << e.what() << endl;
+            return true;
+        }
+        return false;
+    };
+
+    auto ok = not rejects(good);
+
+    auto const footer_at = good.size() - sizeof(cusz::chunked_footer_t);
+
+    auto bad            = good;
+    auto footer         = reinterpret_cast<cusz::chunked_footer_t*>(bad.data() + footer_at);
+    footer->nbrick      = 1 << 20;
+    footer->index_nbyte = sizeof(cusz::chunked_brick_t) << 20;
+    footer->footer_crc  = footer->get_footer_crc();  // consistent, but larger than the file
+    ok                  = ok and rejects(bad);
+
+    bad = good;
+    bad[sizeof(blob)] ^= 0x1;  // first byte of the index
+    ok = ok and rejects(bad);
+
+    bad = good;
+    bad[footer_at + 12] ^= 0x1;  // footer, nbrick
+    ok = ok and rejects(bad);
+
+    std::remove(fname.c_str());
+    cout << "corrupt index and footer\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f({64, 64, 64}, {32, 32, 32});
+    pass      = pass and f({100, 70, 33}, {32, 32, 8});
+    pass      = pass and f({1000, 1, 1}, {256, 1, 1});
+    pass      = pass and f({17, 9, 1}, {64, 64, 1});
+
+    pass      = pass and g({100, 70, 33}, {32, 32, 8});
+    pass      = pass and g({100, 70, 33}, {0, 0, 0});
+    pass      = pass and g({3600, 1800, 1}, {0, 0, 0});
+    pass      = pass and g({100000, 1, 1}, {0, 0, 0});
+
+    pass = pass and h();
+    pass = pass and k();
+    pass = pass and not cusz::ChunkedArchiveReader::is_chunked("/nonexistent");
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
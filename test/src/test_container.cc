@@ -0,0 +1,112 @@
+/**
+ * @file test_container.cc
+ * @author Jiannan Tian
+ * @brief multi-field container: write, append by a later run, look up by name; raw payloads stand in for archives
+ * @version 0.3
+ * @date 2022-03-16
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../src/container.hh"
+
+using std::cout;
+using std::endl;
+
+std::vector<uint8_t> payload(const std::string& name, size_t nbyte)
+{
+    std::vector<uint8_t> p(nbyte);
+    for (size_t i = 0; i < nbyte; i++) p[i] = name[i % name.size()] + i;
+    return p;
+}
+
+bool check(cusz::ContainerReader& r, const std::string& name, size_t nbyte)
+{
+    auto ref = payload(name, nbyte);
+    auto e   = r.find(name);
+    return e.nbyte == nbyte and std::equal(ref.begin(), ref.end(), r.map(e));
+}
+
+int main()
+{
+    std::string fname = "test_container.tmp";
+    std::vector<std::pair<std::string, size_t>> fields = {
+        {"CLDHGH", 1000}, {"CLDLOW", 1}, {"FLDSC", 123457}, {"QCLOUDf48", 64}, {"PRECIPf48", 4096}};
+
+    // first run: three fields
+    {
+        cusz::ContainerWriter w(fname, false);
+        for (auto i = 0; i < 3; i++) {
+            auto p = payload(fields[i].first, fields[i].second);
+            w.add(fields[i].first, 3600, 1800, 1, 4, 1e-4, p.data(), p.size(), false);
+        }
+        w.finalize();
+    }
+    // second run: append two more
+    auto dup_refused = false;
+    {
+        cusz::ContainerWriter w(fname);
+        for (auto i = 3; i < 5; i++) {
+            auto p = payload(fields[i].first, fields[i].second);
+            w.add(fields[i].first, 500, 500, 100, 4, 1e-3, p.data(), p.size(), false);
+        }
+        try {
+            w.add("CLDHGH", 1, 1, 1, 4, 0, nullptr, 0);
+        }
+        catch (std::runtime_error& e) {
+            dup_refused = true;
+        }
+        w.finalize();
+    }
+    // third run: unwound before finalize(); the container is as the second run left it
+    {
+        cusz::ContainerWriter w(fname);
+        auto                  p = payload("abandoned", 10000);
+        w.add("abandoned", 1, 1, 1, 4, 1e-3, p.data(), p.size(), false);
+    }
+
+    auto pass = cusz::ContainerReader::is_container(fname) and dup_refused;
+
+    cusz::ContainerReader r(fname);
+    pass = pass and r.get_directory().size() == fields.size();
+    for (auto& f : fields) {
+        auto ok = check(r, f.first, f.second);
+        cout << f.first << "\t" << f.second << " bytes\t" << (ok ? "ok" : "wrong") << endl;
+        pass = pass and ok;
+    }
+    pass = pass and not r.has("nonexistent") and not r.has("abandoned") and r.find("QCLOUDf48").z == 100;
+
+    // a footer claiming more directory than the file holds is rejected before anything is copied
+    auto rejected = 0;
+    {
+        std::fstream f(fname, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+        f.seekp(-(std::streamoff)sizeof(cusz::container_footer_t) + 12, std::ios::end);  // nfield
+        uint32_t nfield = 1 << 24;
+        f.write(reinterpret_cast<char*>(&nfield), sizeof(nfield));
+    }
+    try {
+        cusz::ContainerReader bad(fname);
+    }
+    catch (std::runtime_error& e) {
+        rejected++;
+    }
+    try {
+        cusz::ContainerWriter bad(fname);
+    }
+    catch (std::runtime_error& e) {
+        rejected++;
+    }
+    pass = pass and rejected == 2;
+    std::remove(fname.c_str());
+
+    pass = pass and not cusz::ContainerReader::is_container("/nonexistent");
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
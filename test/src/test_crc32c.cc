@@ -0,0 +1,161 @@
+/**
+ * @file test_crc32c.cc
+ * @author Jiannan Tian
+ * @brief CRC32C: reference values, hardware vs. software, combine, throughput; archive seal/verify and corruption
+ * @version 0.3
+ * @date 2022-03-16
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "../src/chunked.hh"
+#include "../src/utils/crc32c.hh"
+#include "../src/utils/timer.hh"
+
+using std::cout;
+using std::endl;
+
+using CRC = cusz::CRC32C;
+
+template <typename F>
+double gbps(size_t nbyte, F f)
+{
+    host_timer_t t;
+    t.timer_start();
+    f();
+    t.timer_end();
+    return nbyte / t.get_time_elapsed() / 1e9;
+}
+
+bool test_crc()
+{
+    auto ok = CRC::extend(0, "123456789", 9) == 0xe3069283 and CRC::extend_sw(0, "123456789", 9) == 0xe3069283;
+    std::vector<uint8_t> zeros(32, 0);
+    ok = ok and CRC::extend(0, zeros.data(), 32) == 0x8a9136aa;
+
+    size_t               len = 1 << 26;
+    std::vector<uint8_t> buf(len + 16);
+    for (auto& b : buf) b = std::rand();
+
+    // unaligned starts and odd lengths
+    for (auto i = 0; i < 200; i++) {
+        auto off = std::rand() % 16, n = std::rand() % 10000;
+        ok       = ok and CRC::extend(0, buf.data() + off, n) == CRC::extend_sw(0, buf.data() + off, n);
+        auto cut = n ? std::rand() % n : 0;
+        auto a = CRC::extend(0, buf.data() + off, cut), b = CRC::extend(0, buf.data() + off + cut, n - cut);
+        ok = ok and CRC::combine(a, b, n - cut) == CRC::extend(0, buf.data() + off, n);
+        ok = ok and CRC::extend(a, buf.data() + off + cut, n - cut) == CRC::extend(0, buf.data() + off, n);
+    }
+
+    uint32_t c1, c2, c3;
+    auto     sw  = gbps(len, [&] { c1 = CRC::extend_sw(0, buf.data(), len); });
+    auto     hw  = gbps(len, [&] { c2 = CRC::extend(0, buf.data(), len); });
+    auto     par = gbps(len, [&] { c3 = CRC::compute(buf.data(), len); });
+    ok           = ok and c1 == c2 and c2 == c3;
+
+    printf("crc32c (hw %s): sw %.2f GB/s, single %.2f GB/s, parallel %.2f GB/s\n", CRC::has_hw() ? "yes" : "no", sw,
+           hw, par);
+    return ok;
+}
+
+// a well-formed archive: header, then segments of the given sizes
+std::vector<uint8_t> make_archive(std::vector<uint32_t> nbyte)
+{
+    cuszHEADER h;
+    memset(&h, 0, sizeof(h));
+    h.entry[0] = 0;
+    h.entry[1] = sizeof(h);
+    for (auto i = 2; i <= cuszHEADER::END; i++) h.entry[i] = h.entry[i - 1] + nbyte[i - 2];
+
+    std::vector<uint8_t> a(h.file_size());
+    for (auto& b : a) b = std::rand();
+    memcpy(a.data(), &h, sizeof(h));
+    return a;
+}
+
+bool expect_throw(const uint8_t* a, size_t n, const char* segment)
+{
+    try {
+        cusz::ArchiveChecksum::verify(a, n);
+    }
+    catch (std::runtime_error& e) {
+        return std::string(e.what()).find(segment) != std::string::npos;
+    }
+    return false;
+}
+
+bool test_archive()
+{
+    auto a = make_archive({100, 1 << 20, 3000});
+    auto n = a.size();
+    cusz::ArchiveChecksum::verify(a.data(), n);  // unsealed passes
+    cusz::ArchiveChecksum::seal(a.data());
+    cusz::ArchiveChecksum::verify(a.data(), n);
+
+    auto ok = true;
+    auto h  = reinterpret_cast<cuszHEADER*>(a.data());
+
+    a[h->entry[cuszHEADER::VLE] + 12345] ^= 1;
+    ok = ok and expect_throw(a.data(), n, "vle");
+    a[h->entry[cuszHEADER::VLE] + 12345] ^= 1;
+
+    a[n - 1] ^= 0x80;
+    ok = ok and expect_throw(a.data(), n, "spformat");
+    a[n - 1] ^= 0x80;
+
+    h->eb = 1.0;
+    ok    = ok and expect_throw(a.data(), n, "header");
+    h->eb = 0;
+
+    // per brick in a chunked archive
+    std::string    fname   = "test_crc32c.tmp";
+    uint32_t const zero[3] = {0, 0, 0}, one[3] = {1, 1, 1};
+    {
+        cusz::ChunkedArchiveWriter w(fname, {1, 1, 2}, {1, 1, 1}, 4, 1e-4);
+        auto                       b0 = make_archive({8, 64, 8}), b1 = make_archive({8, 4096, 8});
+        w.append(zero, one, b0.data(), b0.size());
+        uint32_t origin[3] = {0, 0, 1};
+        w.append(origin, one, b1.data(), b1.size());
+        w.finalize();
+    }
+    {
+        cusz::ChunkedArchiveReader r(fname);
+        r.verify_brick(0), r.verify_brick(1);
+    }
+    {  // flip a bit in the VLE segment of brick 1
+        cusz::ChunkedArchiveReader r(fname);
+        auto                       where = r.get_index()[1].offset + sizeof(cuszHEADER) + 8 + 100;
+        std::fstream               f(fname, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(where);
+        f.put(0x5a);
+    }
+    try {
+        cusz::ChunkedArchiveReader r(fname);
+        r.verify_brick(0);
+        r.verify_brick(1);
+        ok = false;
+    }
+    catch (std::runtime_error& e) {
+        cout << "caught: " << e.what() << endl;
+        ok = ok and std::string(e.what()).find("brick 1: checksum mismatch in segment vle") != std::string::npos;
+    }
+    std::remove(fname.c_str());
+
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and test_crc();
+    pass      = pass and test_archive();
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_huffcoarse_cpu.cc
+ * @author Jiannan Tian
+ * @brief round-trip of the host HuffmanCoarse with host-autotuned sublen/pardeg
+ * @version 0.3
+ * @date 2022-03-10
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/utils/autotune_cpu.hh"
+#include "../src/wrapper/huffman_coarse_cpu.hh"
+
+using std::cout;
+using std::endl;
+
+template <typename H>
+bool f(size_t len, int booklen)
+{
+    using E = uint16_t;
+
+    std::vector<E> code(len), decoded(len);
+    auto           radius = booklen / 2;
+    for (size_t i = 0; i < len; i++) {
+        auto offset = (int)(std::rand() % 7) - 3;
+        if (std::rand() % 1000 == 0) offset = std::rand() % radius - radius / 2;  // a long tail
+        code[i] = radius + offset;
+    }
+
+    HostAutoconfigHelper::record_t r;
+    auto sublen = HostAutoconfigHelper::tune_coarse_huffman_sublen<E, H>(len, booklen, &r);
+    auto pardeg = ConfigHelper::get_npart(len, sublen);
+
+    // calibrated once per process: tuning again gives the same sublen
+    HostAutoconfigHelper::record_t again;
+    auto same = HostAutoconfigHelper::tune_coarse_huffman_sublen<E, H>(len, booklen, &again) == sublen and
+                again.ns_per_symbol == r.ns_per_symbol and again.sublen == r.sublen;
+
+    cout << "ncore=" << r.ncore << "\tL2=" << r.l2_nbyte << "\tns/sym=" << r.ns_per_symbol  //
+         << "\tbounds=[" << r.sublen_lower << "," << r.sublen_upper << "]\tsublen=" << sublen
+         << "\tpardeg=" << pardeg << endl;
+
+    cusz::cpu::HuffmanCoarse<E, H> codec;
+    codec.allocate_workspace(len, booklen, pardeg);
+
+    uint8_t* compressed;
+    size_t   compressed_len;
+    codec.encode(code.data(), len, booklen, sublen, pardeg, compressed, compressed_len);
+    cout << "compressed bytes: " << compressed_len << "\t(" << len * sizeof(E) * 1.0 / compressed_len << "x)"
+         << "\tencode " << codec.get_time_elapsed() << " ms" << endl;
+
+    codec.decode(compressed, decoded.data());
+    cout << "decode " << codec.get_time_elapsed() << " ms" << endl;
+
+    auto pow2 = sublen > 0 and (sublen & (sublen - 1)) == 0;
+    return same and pow2 and pardeg == ConfigHelper::get_npart(len, sublen) and code == decoded;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f<uint32_t>(1 << 24, 1024);
+    pass      = pass and f<unsigned long long>(1000003, 1024);
+    pass      = pass and f<uint32_t>(17, 1024);
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file test_numa.cc
+ * @author Jiannan Tian
+ * @brief placement policies give zeroed arrays, and a blocked triad bench per policy, pinned; on a multi-socket node
+ * first-touch and interleave should beat serial placement by up to the remote-to-local bandwidth ratio
+ * @version 0.3
+ * @date 2022-03-21
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../src/utils/numa.hh"
+
+using std::cout;
+using std::endl;
+
+using numa = cusz::NumaHelper;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+// c = a + s * b, in chunks dealt to pool workers as the pSZ loops do; GB/s of the best of `nrep`
+double triad(size_t len, size_t chunk_len, numa::policy_t policy, int nrep = 5)
+{
+    auto a = numa::allocate<float>(len, policy, chunk_len);
+    auto b = numa::allocate<float>(len, policy, chunk_len);
+    auto c = numa::allocate<float>(len, policy, chunk_len);
+
+    auto const nchunk = (len - 1) / chunk_len + 1;
+    auto       begin  = [&](size_t i) { return i * chunk_len; };
+    auto       end    = [&](size_t i) { return std::min(len, (i + 1) * chunk_len); };
+    numa::for_each_chunk(nchunk, [&](size_t i) {
+        for (auto j = begin(i); j < end(i); j++) a[j] = 1, b[j] = 2;
+    });
+
+    double best = 0;
+    for (auto r = 0; r < nrep; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        numa::for_each_chunk(nchunk, [&](size_t i) {
+            for (auto j = begin(i); j < end(i); j++) c[j] = a[j] + 3 * b[j];
+        });
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+        best                            = std::max(best, 3.0 * sizeof(float) * len / t.count() / 1e9);
+    }
+
+    auto ok = c[0] == 7 and c[len - 1] == 7;
+    numa::deallocate(a, len), numa::deallocate(b, len), numa::deallocate(c, len);
+    return ok ? best : -1;
+}
+
+int main(int argc, char** argv)
+{
+    auto pass = true;
+
+    auto npinned = numa::pin_threads();
+    cout << "nodes=" << numa::get_nnode() << "\tpinned workers=" << npinned << endl;
+    pass = pass and check(npinned == 0 or npinned == cusz::ThreadPool::get_default().get_nworker(), "pinned");
+
+    // every chunk runs once, and on the same worker on every pass
+    for (auto cyclic : {false, true}) {
+        size_t const                 nchunk = 1001;
+        std::vector<int>             count(nchunk, 0);
+        std::vector<std::thread::id> first(nchunk), second(nchunk);
+        numa::for_each_chunk(nchunk, [&](size_t i) { count[i]++, first[i] = std::this_thread::get_id(); }, cyclic);
+        numa::for_each_chunk(nchunk, [&](size_t i) { second[i] = std::this_thread::get_id(); }, cyclic);
+        auto once = std::all_of(count.begin(), count.end(), [](int n) { return n == 1; });
+        pass      = pass and check(once and first == second, cyclic ? "cyclic mapping" : "contiguous mapping");
+    }
+
+    for (auto policy : {numa::SERIAL, numa::FIRST_TOUCH, numa::INTERLEAVE}) {
+        for (auto cyclic : {false, true}) {
+            size_t len  = 1000003;  // not a multiple of the chunk
+            auto   a    = numa::allocate<double>(len, policy, 4096, cyclic);
+            auto   zero = true;
+            for (size_t i = 0; i < len; i++) zero = zero and a[i] == 0;
+            a[len - 1] = 1;  // writable to the end
+            numa::deallocate(a, len);
+            pass = pass and check(zero, "zero-filled");
+        }
+    }
+    {
+        auto a = numa::allocate<int>(0);
+        numa::deallocate(a, 0);
+        pass = pass and check(a != nullptr, "empty array");
+    }
+
+    // 3D field, 8-deep rows of blocks as the chunk, as in the blocked pSZ loops
+    size_t     x = 512, y = 512, z = argc > 1 ? atoi(argv[1]) : 128;
+    auto const chunk_len = 8 * x * y;
+    char const* name[]    = {"serial", "first-touch", "interleave"};
+    for (auto policy : {numa::SERIAL, numa::FIRST_TOUCH, numa::INTERLEAVE}) {
+        auto gbps = triad(x * y * z, chunk_len, policy);
+        cout << "triad " << x << "x" << y << "x" << z << "\t" << name[policy] << "\t" << gbps << " GB/s" << endl;
+        pass = pass and gbps > 0;
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
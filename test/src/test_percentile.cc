@@ -0,0 +1,116 @@
+/**
+ * @file test_percentile.cc
+ * @author Jiannan Tian
+ * @brief percentiles by bucketing against a sorted copy, on smooth, heavily repeated, integer and tiny inputs, with
+ * the input left untouched; and the time against std::sort on a large field
+ * @version 0.3
+ * @date 2022-03-26
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/analysis/percentile.hh"
+
+using std::cout;
+using std::endl;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+std::vector<double> every_percent()
+{
+    std::vector<double> pcts;
+    for (auto p = 0; p <= 100; p++) pcts.push_back(p);
+    pcts.push_back(99.9), pcts.push_back(0.1), pcts.push_back(50);  // out of order, and a repeat
+    return pcts;
+}
+
+template <typename T>
+bool f(std::vector<T> const& in, const char* what)
+{
+    auto pcts = every_percent();
+    auto kept = in;
+    auto res  = analysis::get_percentiles(in.data(), in.size(), pcts);
+
+    auto sorted = in;
+    std::sort(sorted.begin(), sorted.end());
+    auto ok = res.size() == pcts.size() and in == kept;
+    for (size_t i = 0; ok and i < pcts.size(); i++)
+        ok = res[i] == sorted[(size_t)std::floor(pcts[i] / 100 * (in.size() - 1))];
+    ok = ok and res[0] == sorted.front() and res[100] == sorted.back();
+
+    cout << what << " len=" << in.size() << "\tp50=" << res[50] << "\t";
+    return check(ok, "matches sorted, input kept");
+}
+
+int main(int argc, char** argv)
+{
+    auto pass = true;
+
+    {
+        std::vector<float> smooth(1000003), noisy(1 << 20), repeated(1 << 20);
+        for (size_t i = 0; i < smooth.size(); i++) smooth[i] = sin(i * 1e-4) * (1 + i * 1e-6);
+        for (auto& v : noisy) v = std::rand() / (float)RAND_MAX - 0.5f;
+        for (auto& v : repeated) v = std::rand() % 10 == 0 ? std::rand() % 1000 : 0;  // mostly zero, as a sparse field
+        pass = pass and f(smooth, "smooth");
+        pass = pass and f(noisy, "noisy");
+        pass = pass and f(repeated, "repeated");
+    }
+    {
+        std::vector<int> ints(300000), constant(50000, 7);
+        for (auto& v : ints) v = std::rand() % 5000 - 2500;
+        pass = pass and f(ints, "int");
+        pass = pass and f(constant, "constant");
+    }
+    for (auto len : {1, 2, 101, 4095, 4096 * 3 + 1}) {
+        std::vector<double> tiny(len);
+        for (auto& v : tiny) v = std::rand() % 97;
+        pass = pass and f(tiny, "tiny");
+    }
+    {
+        std::vector<float> a(100, 1);
+        auto               thrown = 0;
+        try {
+            analysis::select_ranks(a.data(), a.size(), {100});
+        }
+        catch (std::runtime_error&) {
+            thrown++;
+        }
+        try {
+            analysis::get_percentiles(a.data(), a.size(), {101});
+        }
+        catch (std::runtime_error&) {
+            thrown++;
+        }
+        pass = pass and check(thrown == 2, "out of range");
+    }
+
+    size_t             len = argc > 1 ? atol(argv[1]) : (1ul << 27);  // 512 MiB of f32
+    std::vector<float> in(len);
+    for (size_t i = 0; i < len; i++) in[i] = sin(i * 1e-5) + 1e-3f * (std::rand() % 1000);
+
+    auto                          t0  = std::chrono::steady_clock::now();
+    auto                          res = analysis::get_percentiles(in.data(), len, every_percent());
+    std::chrono::duration<double> t_select = std::chrono::steady_clock::now() - t0;
+
+    t0 = std::chrono::steady_clock::now();
+    std::sort(in.begin(), in.end());
+    std::chrono::duration<double> t_sort = std::chrono::steady_clock::now() - t0;
+
+    pass = pass and check(res[50] == in[(len - 1) / 2] and res[100] == in[len - 1], "large");
+    cout << "percentiles of " << len << " f32\tselect " << t_select.count() << " s\tsort " << t_sort.count() << " s"
+         << endl;
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
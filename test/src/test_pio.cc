@@ -0,0 +1,120 @@
+/**
+ * @file test_pio.cc
+ * @author Jiannan Tian
+ * @brief parallel positional I/O against single-stream ifstream/ofstream, and a read that finds the value range on the
+ * way; checks content and reports GB/s
+ * usage: pio [MiB=512] [file=pio.tmp] [direct=0]
+ * @version 0.3
+ * @date 2022-03-15
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../src/utils/io.hh"
+#include "../src/utils/timer.hh"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+template <typename F>
+double bench(F f)
+{
+    host_timer_t t;
+    t.timer_start();
+    f();
+    t.timer_end();
+    return t.get_time_elapsed();
+}
+
+int main(int argc, char** argv)
+{
+    size_t      nbyte  = (argc > 1 ? std::atol(argv[1]) : 512) << 20;
+    std::string fname  = argc > 2 ? argv[2] : "pio.tmp";
+    bool        direct = argc > 3 and std::atoi(argv[3]) != 0;
+
+    // O_DIRECT needs aligned buffers
+    uint8_t *src, *dst;
+    if (posix_memalign((void**)&src, io::PositionalFile::ALIGN, nbyte) or
+        posix_memalign((void**)&dst, io::PositionalFile::ALIGN, nbyte))
+        return 1;
+    for (size_t i = 0; i < nbyte; i++) src[i] = (i * 2654435761u) >> 24;
+
+    auto gbps = [&](double sec) { return nbyte / sec / 1e9; };
+    auto pass = true;
+
+#ifdef _OPENMP
+    auto nthread = omp_get_max_threads();
+#else
+    auto nthread = 1;
+#endif
+
+    auto t_ofs = bench([&]() {
+        std::ofstream ofs(fname, std::ios::binary);
+        ofs.write((char*)src, nbyte);
+    });
+    auto t_ifs = bench([&]() {
+        std::ifstream ifs(fname, std::ios::binary);
+        ifs.read((char*)dst, nbyte);
+    });
+    pass = pass and std::equal(src, src + nbyte, dst);
+
+    double t_pwrite, t_pread;
+    {
+        io::PositionalFile f(fname, io::PositionalFile::WRITE, direct);
+        t_pwrite = bench([&]() { f.write(src, nbyte); });
+    }
+    std::fill(dst, dst + nbyte, 0);
+    {
+        io::PositionalFile f(fname, io::PositionalFile::READ, direct);
+        direct  = f.is_direct();
+        t_pread  = bench([&]() { f.read(dst, nbyte); });
+    }
+    pass = pass and std::equal(src, src + nbyte, dst);
+
+    // unaligned offset and length, across range boundaries
+    {
+        io::PositionalFile f(fname, io::PositionalFile::READ, direct);
+        size_t             offset = 12345, len = nbyte - offset - 777;
+        std::fill(dst, dst + nbyte, 0);
+        f.read(dst, len, offset);
+        pass = pass and std::equal(src + offset, src + offset + len, dst);
+    }
+
+    // read and value range in one pass, against a separate scan
+    double t_range;
+    {
+        auto                     a = reinterpret_cast<float*>(src), b = reinterpret_cast<float*>(dst);
+        auto                     n = nbyte / sizeof(float);
+        io::value_range_t<float> range;
+        for (size_t i = 0; i < n; i++) a[i] = (i % 1000003) * 1e-3f - 500;
+        a[n / 3] = -1e6f, a[n - 1] = 1e6f;
+        io::write_array_to_binary(fname, a, n);
+        std::fill(dst, dst + nbyte, 0);
+        t_range     = bench([&]() { io::read_binary_to_array(fname, b, n, range); });
+        auto minmax = std::minmax_element(a, a + n);
+        pass        = pass and std::equal(a, a + n, b) and range.min == *minmax.first and range.max == *minmax.second;
+    }
+    std::remove(fname.c_str());
+
+    printf("%zu MiB, %d thread(s), O_DIRECT %s; page cache is likely warm for reads\n", nbyte >> 20, nthread,
+           direct ? "on" : "off");
+    printf("ofstream  %6.2f GB/s\tpwrite  %6.2f GB/s\n", gbps(t_ofs), gbps(t_pwrite));
+    printf("ifstream  %6.2f GB/s\tpread   %6.2f GB/s\n", gbps(t_ifs), gbps(t_pread));
+    printf("pread with value range  %6.2f GB/s\n", gbps(t_range));
+
+    free(src), free(dst);
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
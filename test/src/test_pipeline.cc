@@ -0,0 +1,99 @@
+/**
+ * @file test_pipeline.cc
+ * @author Jiannan Tian
+ * @brief three-stage read/compress/write over double buffers: order, overlap, and error propagation
+ * @version 0.3
+ * @date 2022-03-15
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../src/utils/pipeline.hh"
+#include "../src/utils/timer.hh"
+
+using std::cout;
+using std::endl;
+
+void work(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// same circulation as app::cusz_compress_streaming: buffers go free -> full -> free, results go to the writer
+bool f(size_t n, int ms, long fail_at = -1)
+{
+    std::vector<std::vector<size_t>> buf(2, std::vector<size_t>(1));
+    std::vector<size_t>              written;
+
+    cusz::BoundedQueue<size_t>                    free_q(buf.size());
+    cusz::BoundedQueue<std::pair<size_t, size_t>> full_q(buf.size());
+    cusz::BoundedQueue<size_t>                    out_q(2);
+    for (size_t b = 0; b < buf.size(); b++) free_q.push(b);
+
+    host_timer_t t;
+    t.timer_start();
+
+    std::unique_ptr<cusz::PipelineStage> reader(new cusz::PipelineStage(
+        [&] {
+            size_t b;
+            for (size_t i = 0; i < n and free_q.pop(b); i++) {
+                work(ms);
+                buf[b][0] = i;
+                if (not full_q.push({i, b})) return;
+            }
+        },
+        [&] { full_q.close(); }));
+    std::unique_ptr<cusz::PipelineStage> writer(new cusz::PipelineStage(
+        [&] {
+            size_t r;
+            while (out_q.pop(r)) {
+                work(ms);
+                if ((long)r == fail_at * 10) throw std::runtime_error("write failed");
+                written.push_back(r);
+            }
+        },
+        [&] { out_q.close(); }));
+
+    std::pair<size_t, size_t> item;
+    while (full_q.pop(item)) {
+        work(ms);
+        auto r = buf[item.second][0] * 10;
+        if (not out_q.push(r)) break;
+        free_q.push(item.second);
+    }
+    free_q.close(), full_q.close(), out_q.close();
+
+    auto ok = fail_at < 0;
+    try {
+        reader->join();
+        writer->join();
+    }
+    catch (std::exception& e) {
+        ok = fail_at >= 0;  // expected
+        cout << "caught: " << e.what() << "\t";
+    }
+    t.timer_end();
+
+    for (size_t i = 0; fail_at < 0 and i < n; i++) ok = ok and written.size() == n and written[i] == i * 10;
+
+    auto sequential = 3.0 * n * ms / 1000;
+    cout << "n=" << n << "\t" << t.get_time_elapsed() << " s (sequential " << sequential << " s)" << endl;
+    // in flight: ~(n + 2) stage steps instead of 3n
+    return ok and (fail_at >= 0 or n < 4 or t.get_time_elapsed() < 0.7 * sequential);
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f(20, 20);
+    pass      = pass and f(1, 5);
+    pass      = pass and f(0, 5);
+    pass      = pass and f(20, 5, 7);
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file test_planner.cc
+ * @author Jiannan Tian
+ * @brief execution mode and brick chosen under device and host caps; the chosen brick is the largest that fits
+ * @version 0.3
+ * @date 2022-03-20
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "../src/planner.hh"
+
+using std::cout;
+using std::endl;
+
+using Plan = cusz::MemoryPlan;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+void print(dim3_compat field, Plan const& p)
+{
+    auto field_nbyte = 4.0 * field.x * field.y * field.z;
+    cout << "field " << field.x << "x" << field.y << "x" << field.z << "\t" << Plan::get_mode_name(p.mode)
+         << "\tbrick " << p.brick.x << "x" << p.brick.y << "x" << p.brick.z
+         << "\tdevice=" << p.footprint.get_device_nbyte() / field_nbyte << "x"
+         << "\thost=" << p.footprint.host / field_nbyte << "x" << endl;
+}
+
+// one block more along the axis that was cut must not fit
+bool is_largest(cusz::MemoryPlanner const& planner, dim3_compat field, Plan const& p, size_t device_cap, int block)
+{
+    uint32_t f[3] = {field.x, field.y, field.z}, b[3] = {p.brick.x, p.brick.y, p.brick.z};
+    for (auto axis = 2; axis >= 0; axis--) {
+        if (b[axis] == f[axis]) continue;
+        b[axis] += block;
+        auto fp = planner.get_footprint(field, p.mode, {b[0], b[1], b[2]});
+        return fp.get_device_nbyte() > device_cap;
+    }
+    return false;
+}
+
+int main()
+{
+    auto                          pass = true;
+    cusz::MemoryPlanner::setup_t  setup;  // f32, 2-byte quant-code, 4-byte codec, density factor 4
+    size_t const                  GiB = 1ul << 30;
+    auto                          mono_ratio = 0.0;
+
+    {  // uncapped: as today
+        cusz::MemoryPlanner planner(setup, 0);
+        dim3_compat         field{512, 512, 512};
+        auto                p = planner.plan(field);
+        print(field, p);
+        mono_ratio = p.footprint.get_device_nbyte() / (4.0 * 512 * 512 * 512);
+        pass       = pass and check(p.mode == Plan::MONOLITHIC and mono_ratio > 4, "uncapped, monolithic");
+    }
+
+    {  // device cap under the monolithic footprint: chunked, whole planes, z a multiple of the block
+        cusz::MemoryPlanner planner(setup, 1 * GiB);
+        dim3_compat         field{512, 512, 512};
+        auto                p = planner.plan(field);
+        print(field, p);
+        pass = pass and check(
+                            p.mode == Plan::CHUNKED and p.brick.x == 512 and p.brick.y == 512 and p.brick.z % 8 == 0 and
+                                p.footprint.get_device_nbyte() <= 1 * GiB and is_largest(planner, field, p, GiB, 8),
+                            "device cap, chunked");
+    }
+
+    {  // edge bricks of another shape count as well
+        cusz::MemoryPlanner planner(setup, GiB / 2);
+        dim3_compat         field{500, 500, 499};
+        auto                p  = planner.plan(field);
+        auto                fp = planner.get_footprint(field, p.mode, p.brick);
+        print(field, p);
+        pass = pass and check(
+                            p.mode == Plan::CHUNKED and fp.get_device_nbyte() <= GiB / 2 and
+                                is_largest(planner, field, p, GiB / 2, 8),
+                            "edge bricks");
+    }
+
+    {  // the mapped field is over the host cap: streaming
+        cusz::MemoryPlanner planner(setup, 1 * GiB, 1 * GiB);
+        dim3_compat         field{1024, 1024, 512};  // 2 GiB
+        auto                p = planner.plan(field);
+        print(field, p);
+        pass = pass and check(
+                            p.mode == Plan::STREAMING and p.footprint.host <= 1 * GiB and
+                                p.footprint.get_device_nbyte() <= 1 * GiB,
+                            "host cap, streaming");
+    }
+
+    {  // planes too large for the cap: the next faster axis is cut
+        cusz::MemoryPlanner planner(setup, 64ul << 20);
+        dim3_compat         field{4096, 4096, 64};
+        auto                p = planner.plan(field);
+        print(field, p);
+        pass = pass and check(
+                            p.brick.z == 8 and p.brick.y < 4096 and p.brick.y % 8 == 0 and
+                                p.footprint.get_device_nbyte() <= (64ul << 20),
+                            "plane split");
+    }
+
+    {  // 2^30 floats, uncapped: the 32-bit workspace sizes alone call for bricks
+        cusz::MemoryPlanner planner(setup, 0);
+        dim3_compat         field{1u << 30, 1, 1};
+        auto                p = planner.plan(field);
+        print(field, p);
+        pass = pass and check(p.mode == Plan::CHUNKED and p.brick.x % 256 == 0, "32-bit workspace");
+    }
+
+    {  // the fallback codec adds its own buffers
+        auto both          = setup;
+        both.codecs_in_use = 0b11;
+        auto one           = cusz::MemoryPlanner(setup, 0).get_workspace({256, 256, 256});
+        auto two           = cusz::MemoryPlanner(both, 0).get_workspace({256, 256, 256});
+        pass               = pass and check(two.codec > 2 * one.codec and two.predictor == one.predictor, "fallback codec");
+    }
+
+    {  // streaming asked for without a brick
+        cusz::MemoryPlanner planner(setup, 256ul << 20, 512ul << 20);
+        dim3_compat         field{512, 512, 1024};
+        auto                p = planner.plan_streaming(field);
+        print(field, p);
+        pass = pass and check(
+                            p.brick.x == 512 and p.brick.z % 8 == 0 and p.footprint.host <= (512ul << 20) and
+                                p.footprint.get_device_nbyte() <= (256ul << 20),
+                            "streaming, slab brick");
+    }
+
+    {  // nothing fits
+        cusz::MemoryPlanner planner(setup, 1 << 20, 1 << 20);
+        auto                thrown = false;
+        try {
+            planner.plan({1024, 1024, 1024});
+        }
+        catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        pass = pass and check(thrown, "cap too small");
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
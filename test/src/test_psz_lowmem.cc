@@ -0,0 +1,128 @@
+/**
+ * @file test_psz_lowmem.cc
+ * @author Jiannan Tian
+ * @brief round-trip of the low-footprint host pipeline, in place, not, and as a task graph, with the chunked
+ * verification
+ * @version 0.3
+ * @date 2022-03-19
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../src/pSZ/psz_lowmem.hh"
+
+using std::cout;
+using std::endl;
+
+bool f(uint32_t x, uint32_t y, uint32_t z, double eb)
+{
+    using T = float;
+    using E = uint16_t;
+
+    auto           len = (size_t)x * y * z;
+    std::vector<T> data(len), xdata(len, -1);
+    for (size_t i = 0; i < len; i++) {
+        auto ix = i % x, iy = i / x % y, iz = i / x / y;
+        data[i] = sin(ix * 0.05) * cos(iy * 0.07) + 0.3 * sin(iz * 0.11);
+        if (std::rand() % 5000 == 0) data[i] += 50;  // spikes, to be outliers
+    }
+    auto origin = data;
+
+    psz::lowmem::Compressor<T, E> cx(x, y, z, eb * 10);
+    std::vector<uint8_t>          kept, graphed, consumed;
+    cx.set_eb(eb);  // as r2r does once the field is read
+
+    auto noutlier     = cx.compress(data.data(), kept, false);
+    auto peak_kept    = cx.get_peak_nbyte();
+    auto noutlier_g   = cx.compress_graph(data.data(), graphed, 4);
+    auto ok           = data == origin;  // untouched
+    ok                = ok and graphed == kept and noutlier_g == noutlier;
+    auto noutlier_ip  = cx.compress(data.data(), consumed, true);
+    auto peak_inplace = cx.get_peak_nbyte();
+    ok                = ok and kept == consumed and noutlier == noutlier_ip;
+
+    // the codes left over the input are what the Huffman subfile decodes to, with the host codec as is
+    auto const&                           h = cx.get_header();
+    std::vector<E>                        codes(len);
+    cusz::cpu::HuffmanCoarse<E, uint32_t> codec;
+    codec.decode(consumed.data() + h.entry[psz::lowmem::header_t::VLE], codes.data());
+    ok = ok and memcmp(codes.data(), data.data(), sizeof(E) * len) == 0;
+
+    psz::lowmem::Compressor<T, E>::decompress(consumed.data(), xdata.data());
+    double max_err = 0;
+    for (size_t i = 0; i < len; i++) max_err = std::max<double>(max_err, fabs(xdata[i] - origin[i]));
+
+    stat_t stat;
+    psz::lowmem::Compressor<T, E>::verify(
+        consumed.data(), [&](size_t offset, size_t n, T* out) { memcpy(out, origin.data() + offset, sizeof(T) * n); },
+        stat);
+
+    auto input_nbyte = sizeof(T) * len;
+    auto slack       = 1e-6 * (1 + 50);  // float rounding of the reconstruction
+    ok = ok and max_err <= eb + slack and stat.max_abserr == max_err;
+    // the fixed overhead (codebooks, per-thread histograms) dominates a tiny field
+    ok = ok and (len < (1 << 20) or peak_inplace <= 0.3 * input_nbyte);
+
+    cout << "field " << x << "x" << y << "x" << z << "\tnslab=" << h.nslab << "\toutlier=" << noutlier
+         << "\tCR=" << input_nbyte * 1.0 / consumed.size() << "\tmax err=" << max_err << " (eb " << eb << ")"
+         << "\tPSNR=" << stat.PSNR << "\tpeak=" << 1 + peak_inplace * 1.0 / input_nbyte << "x/"
+         << 1 + peak_kept * 1.0 / input_nbyte << "x\tgraph busy workers="
+         << cx.get_task_graph().get_busy() / cx.get_task_graph().get_makespan() << "\t" << (ok ? "ok" : "wrong")
+         << endl;
+    return ok;
+}
+
+// Lorenzo deltas with Fibonacci frequencies: the deepest codeword is 26 bits, too long for 4-byte Huffman words
+bool skewed()
+{
+    using T = float;
+    using E = uint16_t;
+
+    std::vector<int> delta;
+    for (int k = 1, f0 = 1, f1 = 1; k <= 27; k++, f1 = f0 + f1, f0 = f1 - f0) delta.insert(delta.end(), f0, k);
+    for (size_t i = delta.size() - 1; i > 0; i--) std::swap(delta[i], delta[std::rand() % (i + 1)]);
+
+    // eb = 0.5 prequantizes to the value itself; each 256-block starts over from 0, as the 1D predictor does
+    auto           len = delta.size();
+    std::vector<T> data(len), xdata(len, -1);
+    for (size_t i = 0; i < len; i++) data[i] = (i % 256 == 0 ? 0 : data[i - 1]) + delta[i];
+
+    psz::lowmem::Compressor<T, E> cx(len, 1, 1, 0.5);
+    std::vector<uint8_t>          kept, graphed, consumed;
+    cx.compress(data.data(), kept, false);
+    cx.compress_graph(data.data(), graphed, 4);
+    auto origin = data;
+    cx.compress(data.data(), consumed, true);
+    psz::lowmem::Compressor<T, E>::decompress(consumed.data(), xdata.data());
+
+    auto const&                           h = cx.get_header();
+    std::vector<E>                        codes(len);
+    cusz::cpu::HuffmanCoarse<E, uint64_t> codec;
+    codec.decode(kept.data() + h.entry[psz::lowmem::header_t::VLE], codes.data());
+
+    auto ok = h.vle_word_nbyte == sizeof(uint64_t) and graphed == kept and consumed == kept;
+    for (size_t i = 0; i < len; i++) ok = ok and xdata[i] == origin[i] and codes[i] == h.radius + delta[i];
+
+    cout << "skewed histogram, len=" << len << "\tHuffman word " << h.vle_word_nbyte << " bytes\t"
+         << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f(1 << 22, 1, 1, 1e-3);
+    pass      = pass and f(1000, 777, 1, 1e-3);
+    pass      = pass and f(200, 150, 90, 1e-4);
+    pass      = pass and f(33, 17, 9, 1e-2);  // partial blocks only
+    pass      = pass and skewed();
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file test_spbitpack.cc
+ * @author Jiannan Tian
+ * @brief round-trip of the host SpBitpack reducer; chunk kinds as the density asks, and size compared with CSR11
+ * @version 0.3
+ * @date 2022-03-11
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/common/configs.hh"
+#include "../src/wrapper/spbitpack.hh"
+
+using std::cout;
+using std::endl;
+
+// chunk kinds a case must give
+enum expect_t { ANY_KIND, LIST_AND_BITMAP, ALL_EMPTY };
+
+// density ramps linearly from `density` (head) to `density_tail` (tail) when the latter is given; `below_csr` asks for
+// an output smaller than CSR11
+bool f(size_t len, double density, double density_tail = -1, expect_t kinds = ANY_KIND, bool below_csr = false)
+{
+    if (density_tail < 0) density_tail = density;
+
+    std::vector<float> dense(len, 0), decompressed(len, -1);
+    size_t             nnz = 0;
+    for (size_t i = 0; i < len; i++) {
+        auto d = density + (density_tail - density) * i / len;
+        if (std::rand() < d * RAND_MAX) dense[i] = 1 + std::rand() % 100, nnz++;
+    }
+
+    cusz::cpu::SpBitpack<float> reducer;
+    reducer.allocate_workspace(len);
+
+    uint8_t* compressed;
+    size_t   compressed_len;
+    reducer.gather(dense.data(), len, compressed, compressed_len);
+    auto t_gather = reducer.get_time_elapsed();
+    reducer.scatter(compressed, decompressed.data());
+    auto t_scatter = reducer.get_time_elapsed();
+
+    using kind     = cusz::cpu::SpBitpack<float>::chunk_kind;
+    auto nempty    = reducer.get_nchunk_of(kind::EMPTY);
+    auto nlist     = reducer.get_nchunk_of(kind::LIST);
+    auto nbitmap   = reducer.get_nchunk_of(kind::BITMAP);
+    auto csr_nbyte = SparseMethodSetup::get_csr_nbyte<float, int>(len, nnz);
+    cout << "len=" << len << "\tnnz=" << nnz << "\tempty/list/bitmap=" << nempty << "/" << nlist << "/" << nbitmap
+         << "\tspbitpack=" << compressed_len << "\tcsr11=" << csr_nbyte << "\t(" << csr_nbyte * 1.0 / compressed_len
+         << "x)\tgather " << t_gather << " ms\tscatter " << t_scatter << " ms" << endl;
+
+    auto ok = dense == decompressed;
+    if (kinds == LIST_AND_BITMAP) ok = ok and nlist > 0 and nbitmap > 0;
+    if (kinds == ALL_EMPTY) ok = ok and nlist == 0 and nbitmap == 0 and nempty > 0;
+    if (below_csr) ok = ok and compressed_len < (size_t)csr_nbyte;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f(1 << 24, 0.0001, -1, ANY_KIND, true);
+    pass      = pass and f(1 << 24, 0.01, -1, ANY_KIND, true);
+    pass      = pass and f(1 << 24, 0.2, -1, ANY_KIND, true);
+    pass      = pass and f(1 << 24, 0.0, 0.3, LIST_AND_BITMAP, true);  // sparse head, dense tail
+    pass      = pass and f(1000003, 1.0);
+    pass      = pass and f(1000003, 0.0, -1, ALL_EMPTY);
+    pass      = pass and f(5, 0.5);
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_spgs_cpu.cc
+ * @author Jiannan Tian
+ * @brief host spGS and split helpers against a serial reference
+ * @version 0.3
+ * @date 2022-03-11
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/wrapper/glue_cpu.hh"
+#include "../src/wrapper/spgs_cpu.hh"
+
+using std::cout;
+using std::endl;
+
+bool test_spgs(size_t len, double density)
+{
+    std::vector<float> dense(len, 0), out(len, 0);
+    std::vector<int>   ref_idx;
+    for (size_t i = 0; i < len; i++)
+        if (std::rand() < density * RAND_MAX) dense[i] = std::rand() % 100 + 1, ref_idx.push_back(i);
+
+    std::vector<int>   idx(len);
+    std::vector<float> val(len);
+    auto               _idx = idx.data();
+    auto               _val = val.data();
+    int                nnz;
+    unsigned int       dump_nbyte;
+
+    cusz::cpu::spGS<float> spgs;
+    spgs.gather(dense.data(), len, _idx, _val, nnz, dump_nbyte);
+    auto ms = spgs.get_time_elapsed();
+
+    std::vector<uint8_t> pool(dump_nbyte);
+    spgs.consolidate(pool.data());
+    spgs.scatter(pool.data(), nnz, out.data(), len);
+
+    cout << "spGS len=" << len << "\tnnz=" << nnz << "\tgather " << ms << " ms ("
+         << len * sizeof(float) / ms / 1e6 << " GB/s)" << endl;
+
+    return nnz == (int)ref_idx.size() and std::equal(ref_idx.begin(), ref_idx.end(), idx.begin()) and out == dense;
+}
+
+bool test_split(size_t len, int radius)
+{
+    std::vector<uint16_t> errctrl(len);
+    for (auto& e : errctrl) e = std::rand() % 50 == 0 ? std::rand() % (4 * radius) : radius;
+
+    std::vector<int>      ref_idx, idx1(len), idx2(len), idx3(len);
+    std::vector<uint16_t> val1(len), val2(len), val3(len);
+    int                   nnz1, nnz2, nnz3;
+    for (size_t i = 0; i < len; i++)
+        if (errctrl[i] != radius) ref_idx.push_back(i);
+
+    cusz::cpu::split_by_binary_onepass(errctrl.data(), len, radius, idx1.data(), val1.data(), nnz1);
+    cusz::cpu::split_by_binary_twopass(errctrl.data(), len, radius, idx2.data(), val2.data(), nnz2);
+    cusz::cpu::split_by_radius(errctrl.data(), len, radius, idx3.data(), val3.data(), nnz3);
+
+    auto ok = nnz1 == (int)ref_idx.size() and nnz2 == nnz1;
+    ok      = ok and std::equal(ref_idx.begin(), ref_idx.end(), idx1.begin());
+    ok      = ok and std::equal(idx1.begin(), idx1.begin() + nnz1, idx2.begin());
+    ok      = ok and std::equal(val1.begin(), val1.begin() + nnz1, val2.begin());
+    for (auto i = 0; ok and i < nnz1; i++) ok = val1[i] == errctrl[idx1[i]];
+    for (auto i = 0; ok and i < nnz3; i++) ok = val3[i] >= 2 * radius or val3[i] == 0;
+
+    cout << "split len=" << len << "\tnnz=" << nnz1 << "\tby-radius nnz=" << nnz3 << endl;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and test_spgs(1 << 24, 0.01);
+    pass      = pass and test_spgs(1 << 24, 0.5);
+    pass      = pass and test_spgs(7, 0.5);
+    pass      = pass and test_spgs(1000, 0.0);
+    pass      = pass and test_split(1 << 22, 512);
+    pass      = pass and test_split(3, 512);
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
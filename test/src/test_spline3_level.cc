@@ -0,0 +1,82 @@
+/**
+ * @file test_spline3_level.cc
+ * @author Jiannan Tian
+ * @brief level-major layout of Spline3 error-control codes: bijection with the aligned field, coarse-to-fine nesting
+ * @version 0.3
+ * @date 2022-03-17
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include "../src/kernel/spline3_level.cuh"
+
+using std::cout;
+using std::endl;
+
+using Level = cusz::Spline3Level;
+
+bool f(unsigned int X, unsigned int Y, unsigned int Z)
+{
+    std::vector<std::vector<int>> hit(Level::NLEVEL + 1);
+    size_t                        total = 0;
+    for (auto l = 0; l <= Level::NLEVEL; l++) {
+        hit[l].assign(Level::get_len(l, X, Y, Z), 0);
+        total += hit[l].size();
+    }
+    auto ok = total == (size_t)X * Y * Z;
+
+    for (auto z = 0u; z < Z; z++)
+        for (auto y = 0u; y < Y; y++)
+            for (auto x = 0u; x < X; x++) {
+                auto l = Level::get_level(x, y, z);
+                auto r = Level::get_rank(x, y, z, X, Y, Z);
+                if (r >= hit[l].size()) return false;
+                hit[l][r]++;
+
+                unsigned int _x, _y, _z;
+                Level::get_coord(l, r, X, Y, Z, _x, _y, _z);
+                ok = ok and _x == x and _y == y and _z == z;
+
+                // levels up to l are exactly the stride-(8 >> l) grid
+                auto s = Level::get_stride(l);
+                ok     = ok and x % s == 0 and y % s == 0 and z % s == 0;
+                if (l > 0) ok = ok and not(x % (2 * s) == 0 and y % (2 * s) == 0 and z % (2 * s) == 0);
+            }
+
+    for (auto const& h : hit)
+        for (auto c : h) ok = ok and c == 1;
+
+    cout << "aligned " << X << "x" << Y << "x" << Z << "\tlevel len";
+    for (auto l = 0; l <= Level::NLEVEL; l++) cout << " " << Level::get_len(l, X, Y, Z);
+    cout << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+bool g()
+{
+    unsigned int x, y, z;
+    auto         ok = true;
+    Level::get_preview_dims(0, 235, 449, 1, x, y, z);
+    ok = ok and x == 30 and y == 57 and z == 1;
+    Level::get_preview_dims(2, 235, 449, 1, x, y, z);
+    ok = ok and x == 118 and y == 225 and z == 1;
+    Level::get_preview_dims(3, 235, 449, 449, x, y, z);
+    ok = ok and x == 235 and y == 449 and z == 449;
+    cout << "preview dims\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+    pass      = pass and f(32, 8, 8);
+    pass      = pass and f(96, 24, 16);
+    pass      = pass and f(256, 456, 8);
+    pass      = pass and g();
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file test_task_graph.cc
+ * @author Jiannan Tian
+ * @brief nodes run once and after their dependencies; a chunked pipeline overlaps its stages; errors stop the run
+ * @version 0.3
+ * @date 2022-03-23
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../src/utils/task_graph.hh"
+
+using std::cout;
+using std::endl;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+int main()
+{
+    auto pass = true;
+
+    for (auto nworker : {1, 4}) {  // a random DAG: each node depends on a few earlier ones
+        cusz::TaskGraph                  g;
+        size_t const                     n = 500;
+        std::vector<std::atomic<int>>    count(n);
+        std::vector<std::atomic<size_t>> order(n);
+        std::vector<std::vector<size_t>> deps(n);
+        std::atomic<size_t>              tick{0};
+        for (size_t i = 0; i < n; i++) {
+            count[i] = 0;
+            for (size_t k = 1; k <= 3 and k <= i; k++) deps[i].push_back((i * 7919 + k * 104729) % i);
+            g.add("node", i, [&, i](int) { count[i]++, order[i] = tick++; }, deps[i]);
+        }
+        g.run(nworker);
+
+        auto once = true, after = true;
+        for (size_t i = 0; i < n; i++) {
+            once = once and count[i] == 1;
+            for (auto d : deps[i]) after = after and order[d] < order[i];
+        }
+        pass = pass and check(once and after and g.get_trace().size() == n, "each node once, after its deps");
+    }
+
+    {  // predict -> histogram per chunk, chunks of uneven cost; a reduction over all; encode per chunk
+        cusz::TaskGraph                      g;
+        uint32_t const                       nchunk = 8;
+        std::vector<cusz::TaskGraph::node_t> hist;
+        for (uint32_t c = 0; c < nchunk; c++) {
+            auto p = g.add("predict", c, [c](int) { sleep_ms(5 + 5 * (c % 3)); });
+            hist.push_back(g.add("histogram", c, [](int) { sleep_ms(5); }, {p}));
+        }
+        auto book = g.add("codebook", 0, [](int) { sleep_ms(10); }, hist);
+        g.add("outlier", 0, [](int) { sleep_ms(10); }, hist);
+        for (uint32_t c = 0; c < nchunk; c++) g.add("encode", c, [](int) { sleep_ms(5); }, {book});
+        g.run(4);
+        g.print_summary(cout);
+
+        // serially, 75 + 8 * 5 + 10 + 10 + 8 * 5 = 175 ms
+        pass = pass and check(g.get_overlap("predict", "histogram") > 0.002, "histogram beside predict");
+        pass = pass and check(g.get_overlap("codebook", "outlier") > 0, "outlier beside codebook");
+        pass = pass and check(g.get_overlap("predict", "encode") == 0, "encode after all predict");
+        pass = pass and check(g.get_makespan() < 0.15 and g.get_busy() / g.get_makespan() > 1.2, "concurrency");
+    }
+
+    {  // an error stops the run, and is rethrown
+        cusz::TaskGraph  g;
+        std::atomic<int> nrun{0};
+        auto             bad = g.add("bad", 0, [](int) { throw std::runtime_error("bad"); });
+        for (uint32_t i = 0; i < 100; i++) g.add("after", i, [&](int) { nrun++; }, {bad});
+        auto thrown = false;
+        try {
+            g.run(4);
+        }
+        catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        pass = pass and check(thrown and nrun == 0, "error stops the run");
+    }
+
+    {  // a node cannot depend on itself or a later node
+        cusz::TaskGraph g;
+        auto            thrown = false;
+        try {
+            g.add("node", 0, [](int) {}, {0});
+        }
+        catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        pass = pass and check(thrown, "acyclic by construction");
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file test_thread_pool.cc
+ * @author Jiannan Tian
+ * @brief every index runs once, per-worker state needs no lock, nested loops and errors; and a small-z field spread
+ * over flat block indices against z-blocks only, as the pSZ loops did
+ * @version 0.3
+ * @date 2022-03-24
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "../src/utils/thread_pool.hh"
+
+using std::cout;
+using std::endl;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+// stands for the work of an 8x8x8 block
+float block(size_t b)
+{
+    float acc = b;
+    for (auto i = 0; i < 512; i++) acc = std::sqrt(acc + i);
+    return acc;
+}
+
+int main(int argc, char** argv)
+{
+    auto pass = true;
+
+    for (auto nworker : {1, 4}) {
+        cusz::ThreadPool pool(nworker);
+
+        for (size_t n : {0, 1, 1000, 100003}) {
+            for (size_t grain : {0, 1, 64}) {
+                std::vector<std::atomic<int>> count(n);
+                std::vector<size_t>           sum(nworker, 0);  // per worker, no lock
+                for (auto& c : count) c = 0;
+                pool.parallel_for(
+                    n,
+                    [&](size_t begin, size_t end, int w) {
+                        for (auto i = begin; i < end; i++) count[i]++, sum[w] += i;
+                    },
+                    grain);
+
+                auto once  = true;
+                auto total = (size_t)0;
+                for (auto& c : count) once = once and c == 1;
+                for (auto s : sum) total += s;
+                pass = pass and check(once and total == (n ? n * (n - 1) / 2 : 0), "each index once");
+            }
+        }
+
+        std::vector<int> seen(nworker, 0);
+        pool.for_each_worker([&](int w) { seen[w]++; });
+        auto each = true;
+        for (auto s : seen) each = each and s == 1;
+        pass = pass and check(each, "once per worker");
+
+        std::atomic<size_t> nested{0};
+        std::atomic<bool>   same{true};
+        pool.parallel_for(8, [&](size_t begin, size_t end, int w) {
+            for (auto i = begin; i < end; i++)
+                pool.parallel_for(100, [&](size_t b, size_t e, int inner) {
+                    nested += e - b;
+                    if (inner != w) same = false;
+                });
+        });
+        pass = pass and check(nested == 800 and same, "nested loop runs on the caller");
+
+        std::atomic<size_t> after{0};
+        auto                thrown = false;
+        try {
+            pool.parallel_for(
+                100000,
+                [&](size_t begin, size_t end, int) {
+                    if (begin <= 10 and 10 < end) throw std::runtime_error("bad");
+                    after += end - begin;
+                },
+                1);
+        }
+        catch (std::runtime_error const&) {
+            thrown = true;
+        }
+        pass = pass and check(thrown and after < 100000, "error stops the loop");
+
+        size_t n = 0;
+        pool.parallel_for(10, [&](size_t begin, size_t end, int) { n += end - begin; }, 10);
+        pass = pass and check(n == 10, "usable after an error");
+    }
+
+    {  // 3600x1800x26 in 8^3 blocks: 450x225x4 blocks
+        auto&  pool = cusz::ThreadPool::get_default();
+        size_t n0 = 450, n1 = 225, n2 = argc > 1 ? atoi(argv[1]) : 4;
+        size_t nblk = n0 * n1 * n2;
+
+        std::vector<float> out(nblk);
+        auto               t0 = std::chrono::steady_clock::now();
+        pool.parallel_for(
+            n2,
+            [&](size_t begin, size_t end, int) {  // one z-block per claim, as before
+                for (auto b2 = begin; b2 < end; b2++)
+                    for (size_t b = b2 * n0 * n1; b < (b2 + 1) * n0 * n1; b++) out[b] = block(b);
+            },
+            1);
+        std::chrono::duration<double> t_z = std::chrono::steady_clock::now() - t0;
+
+        std::vector<float> flat(nblk);
+        t0 = std::chrono::steady_clock::now();
+        pool.parallel_for(nblk, [&](size_t begin, size_t end, int) {
+            for (auto b = begin; b < end; b++) flat[b] = block(b);
+        });
+        std::chrono::duration<double> t_flat = std::chrono::steady_clock::now() - t0;
+
+        cout << "workers=" << pool.get_nworker() << "\tz-blocks only " << t_z.count() * 1000 << " ms\tflat "
+             << t_flat.count() * 1000 << " ms" << endl;
+        pass = pass and check(flat == out, "flat blocks, same result");
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file test_verify.cc
+ * @author Jiannan Tian
+ * @brief one-pass metrics against a long-double two-pass reference, on ties, a large offset and odd lengths; streamed
+ * metrics, by ranges and by bricks out of order, against those in memory; and the throughput on a large field
+ * @version 0.3
+ * @date 2022-03-25
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/utils/verify.hh"
+
+using std::cout;
+using std::endl;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+bool close(double a, double b, double rel = 1e-9) { return fabs(a - b) <= rel * std::max(fabs(a), fabs(b)) + 1e-300; }
+
+// two passes in long double, first index of the max error
+template <typename T>
+stat_t reference(T const* x, T const* o, size_t len)
+{
+    long double sum_o = 0, sum_x = 0;
+    for (size_t i = 0; i < len; i++) sum_o += o[i], sum_x += x[i];
+    long double mean_o = sum_o / len, mean_x = sum_x / len, v_o = 0, v_x = 0, c = 0, e2 = 0;
+
+    stat_t s;
+    s.min_odata = s.max_odata = o[0], s.min_xdata = s.max_xdata = x[0], s.max_abserr = -1;
+    for (size_t i = 0; i < len; i++) {
+        long double err = fabsl((long double)x[i] - o[i]);
+        v_o += (o[i] - mean_o) * (o[i] - mean_o), v_x += (x[i] - mean_x) * (x[i] - mean_x);
+        c += (o[i] - mean_o) * (x[i] - mean_x), e2 += err * err;
+        s.min_odata = std::min<double>(s.min_odata, o[i]), s.max_odata = std::max<double>(s.max_odata, o[i]);
+        s.min_xdata = std::min<double>(s.min_xdata, x[i]), s.max_xdata = std::max<double>(s.max_xdata, x[i]);
+        if (err > s.max_abserr) s.max_abserr = err, s.max_abserr_index = i;
+        if (o[i] != 0) s.max_pwrrel_abserr = std::max<double>(s.max_pwrrel_abserr, err / fabsl(o[i]));
+    }
+    s.len       = len;
+    s.rng_odata = s.max_odata - s.min_odata;
+    s.std_odata = sqrtl(v_o / len), s.std_xdata = sqrtl(v_x / len);
+    s.coeff     = c / sqrtl(v_o * v_x);
+    s.MSE       = e2 / len;
+    s.PSNR      = 20 * log10(s.rng_odata) - 10 * log10(s.MSE);
+    return s;
+}
+
+template <typename T>
+bool f(size_t len, double offset, const char* what)
+{
+    std::vector<T> o(len), x(len);
+    for (size_t i = 0; i < len; i++) {
+        o[i] = offset + sin(i * 1e-3) + 0.01 * (std::rand() % 100);
+        x[i] = o[i] + 1e-3 * ((int)(std::rand() % 2001) - 1000) / 1000.0;
+    }
+    if (len > 100) x[len / 3] = o[len / 3] + 0.5, x[len / 2] = o[len / 2] - 0.5;  // a tie: the first wins
+
+    stat_t s, r = reference(x.data(), o.data(), len);
+    analysis::verify_data(&s, x.data(), o.data(), len);
+
+    auto ok = s.len == len and s.max_abserr_index == r.max_abserr_index and close(s.max_abserr, r.max_abserr) and
+              s.min_odata == r.min_odata and s.max_odata == r.max_odata and s.min_xdata == r.min_xdata and
+              s.max_xdata == r.max_xdata and close(s.max_pwrrel_abserr, r.max_pwrrel_abserr) and
+              close(s.std_odata, r.std_odata, 1e-7) and close(s.std_xdata, r.std_xdata, 1e-7) and
+              close(s.coeff, r.coeff, 1e-7) and close(s.MSE, r.MSE, 1e-7) and close(s.PSNR, r.PSNR, 1e-7);
+    cout << what << " len=" << len << "\tPSNR=" << s.PSNR << "\tcorr=" << s.coeff << "\tmax err " << s.max_abserr
+         << " at " << s.max_abserr_index << "\t";
+    return check(ok, "matches");
+}
+
+// the original in a file; the decompressed field written brick by brick, then verified by ranges and by bricks
+bool f_stream(uint32_t const field[3], uint32_t const brick[3], const char* what)
+{
+    auto const         len = (size_t)field[0] * field[1] * field[2];
+    std::vector<float> o(len), x(len), x_back(len);
+    for (size_t i = 0; i < len; i++) {
+        o[i] = sin(i * 1e-3) + 0.01 * (std::rand() % 100);
+        x[i] = o[i] + 1e-3 * ((int)(std::rand() % 2001) - 1000) / 1000.0;
+    }
+    x[len / 2] = o[len / 2] - 0.5, x[len / 3] = o[len / 3] + 0.5;  // a tie: the first in the field wins
+
+    std::string o_fname = "verify_o.tmp", x_fname = "verify_x.tmp";
+    io::PositionalFile(o_fname, io::PositionalFile::WRITE).write(o.data(), sizeof(float) * len);
+
+    stat_t s;
+    analysis::verify_data(&s, x.data(), o.data(), len);
+    auto same = [&](stat_t const& t) {
+        return t.len == s.len and t.max_abserr_index == s.max_abserr_index and t.max_abserr == s.max_abserr and
+               t.min_odata == s.min_odata and t.max_odata == s.max_odata and t.min_xdata == s.min_xdata and
+               t.max_xdata == s.max_xdata and t.max_pwrrel_abserr == s.max_pwrrel_abserr and
+               close(t.std_odata, s.std_odata) and close(t.std_xdata, s.std_xdata) and close(t.coeff, s.coeff) and
+               close(t.MSE, s.MSE) and close(t.PSNR, s.PSNR);
+    };
+
+    // ranges, last first
+    analysis::StreamingVerifier<float> by_range(o_fname, field[0], field[1], field[2]);
+    size_t const                       range_len = 10007;
+    for (auto end = len; end > 0; end -= std::min(end, range_len))
+        by_range.add_range(x.data() + end - std::min(end, range_len), end - std::min(end, range_len), end);
+
+    // bricks, last first, each from its own dense buffer; written as the decompressed file
+    analysis::StreamingVerifier<float> by_brick(o_fname, field[0], field[1], field[2]);
+    uint32_t                           nbrick[3];
+    for (auto d = 0; d < 3; d++) nbrick[d] = (field[d] - 1) / brick[d] + 1;
+    {
+        io::PositionalFile out(x_fname, io::PositionalFile::WRITE);
+        std::vector<float> buf;
+        for (auto i = (long)nbrick[0] * nbrick[1] * nbrick[2] - 1; i >= 0; i--) {
+            uint32_t idx[3] = {(uint32_t)(i % nbrick[0]), (uint32_t)(i / nbrick[0] % nbrick[1]),
+                               (uint32_t)(i / nbrick[0] / nbrick[1])};
+            uint32_t origin[3], extent[3];
+            for (auto d = 0; d < 3; d++) origin[d] = idx[d] * brick[d];
+            for (auto d = 0; d < 3; d++) extent[d] = std::min(brick[d], field[d] - origin[d]);
+
+            buf.clear();
+            for (auto z = 0u; z < extent[2]; z++)
+                for (auto y = 0u; y < extent[1]; y++) {
+                    auto row = x.begin() + ((size_t)(origin[2] + z) * field[1] + origin[1] + y) * field[0] + origin[0];
+                    buf.insert(buf.end(), row, row + extent[0]);
+                }
+            by_brick.add_box(buf.data(), origin, extent);
+            out.write_box(buf.data(), field, origin, extent);
+        }
+    }
+    io::PositionalFile(x_fname, io::PositionalFile::READ).read(x_back.data(), sizeof(float) * len);
+    std::remove(o_fname.c_str()), std::remove(x_fname.c_str());
+
+    stat_t t_range, t_brick;
+    by_range.get_stat(&t_range), by_brick.get_stat(&t_brick);
+    cout << what << " " << field[0] << "x" << field[1] << "x" << field[2] << " by " << brick[0] << "x" << brick[1]
+         << "x" << brick[2] << "\tmax err " << t_brick.max_abserr << " at " << t_brick.max_abserr_index << "\t";
+    return check(
+        by_range.is_complete() and by_brick.is_complete() and same(t_range) and same(t_brick) and x_back == x,
+        "matches in memory");
+}
+
+int main(int argc, char** argv)
+{
+    auto pass = true;
+    pass      = pass and f<float>(5, 0, "tiny");
+    pass      = pass and f<float>(1000, 0, "small");
+    pass      = pass and f<float>((1 << 16) * 3 + 17, 0, "chunks+tail");
+    pass      = pass and f<double>((1 << 20) + 1, 1e6, "offset 1e6");  // a raw sum of squares loses the variance
+    pass      = pass and f<float>((1 << 20) + 3, 1e3, "offset 1e3");
+
+    {  // x == o: no error, max error at 0
+        std::vector<float> o(100000, 1.5f);
+        o[7] = 2;
+        stat_t s;
+        analysis::verify_data(&s, o.data(), o.data(), o.size());
+        pass = pass and check(s.max_abserr == 0 and s.max_abserr_index == 0 and s.MSE == 0, "lossless");
+    }
+
+    {
+        uint32_t field[3] = {37, 29, 23};
+        uint32_t row[3] = {8, 8, 8}, plane[3] = {37, 7, 4}, slab[3] = {37, 29, 5};
+        pass = pass and f_stream(field, row, "per-row runs");
+        pass = pass and f_stream(field, plane, "per-plane runs");
+        pass = pass and f_stream(field, slab, "one run");
+
+        auto thrown = false;
+        try {
+            analysis::StreamingVerifier<float>("no-such-file.tmp", 10);
+        }
+        catch (std::runtime_error&) {
+            thrown = true;
+        }
+        pass = pass and check(thrown, "missing original");
+    }
+
+    size_t             len = argc > 1 ? atol(argv[1]) : (1ul << 27);  // 512 MiB per f32 array
+    std::vector<float> o(len), x(len);
+    for (size_t i = 0; i < len; i++) o[i] = i % 1000, x[i] = o[i] + 1e-3f;
+
+    stat_t s;
+    auto   t0 = std::chrono::steady_clock::now();
+    analysis::verify_data(&s, x.data(), o.data(), len);
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+    cout << "verify " << len << " f32 (both arrays " << 2.0 * len * sizeof(float) / 1e9 << " GB)\t" << t.count() << " s\t"
+         << 2.0 * len * sizeof(float) / 1e9 / t.count() << " GB/s" << endl;
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
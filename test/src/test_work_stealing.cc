@@ -0,0 +1,102 @@
+/**
+ * @file test_work_stealing.cc
+ * @author Jiannan Tian
+ * @brief every job runs once; workers keep their threads across runs; a worker held up by one slow job has the rest of
+ * its jobs stolen; errors stop the run
+ * @version 0.3
+ * @date 2022-03-22
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../src/utils/work_stealing.hh"
+
+using std::cout;
+using std::endl;
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+int main()
+{
+    auto pass = true;
+
+    for (auto nworker : {1, 4, 7}) {
+        for (size_t njob : {0, 1, 1000}) {
+            cusz::WorkStealingPool            pool(nworker);
+            std::vector<std::atomic<int>>     count(njob);
+            std::vector<int>                  owner(njob, -1);
+            for (auto& c : count) c = 0;
+            pool.run(
+                njob, [](size_t i) { return (i * 7919) % 1000; },
+                [&](size_t i, int w) { count[i]++, owner[i] = w; });
+
+            auto   once = true;
+            size_t done = 0;
+            for (size_t i = 0; i < njob; i++) once = once and count[i] == 1 and owner[i] >= 0 and owner[i] < nworker;
+            for (auto w = 0; w < nworker; w++) done += pool.get_njob_done(w);
+            pass = pass and once and done == njob;
+        }
+    }
+    pass = pass and check(pass, "every job once");
+
+    {  // the threads outlive a run: a worker is the same thread from batch to batch
+        cusz::WorkStealingPool       pool(4);
+        std::vector<std::thread::id> first(4), again(4);
+        auto                         same = true;
+        pool.run(400, [](size_t) { return 1; }, [&](size_t, int w) { first[w] = std::this_thread::get_id(); });
+        for (auto r = 0; r < 10; r++) {
+            pool.run(400, [](size_t) { return 1; }, [&](size_t, int w) { again[w] = std::this_thread::get_id(); });
+            for (auto w = 0; w < 4; w++)
+                same = same and (pool.get_njob_done(w) == 0 or again[w] == first[w] or first[w] == std::thread::id());
+        }
+        pass = pass and check(same, "threads kept across runs");
+    }
+
+    {  // one job takes far longer than its cost says; the others' workers take over the rest of its queue
+        cusz::WorkStealingPool pool(4);
+        size_t const           njob = 400;
+        auto                   slow = (size_t)0;  // the largest, dealt first
+        auto                   t0   = std::chrono::steady_clock::now();
+        pool.run(
+            njob, [&](size_t i) { return i == slow ? 100 : 1; },
+            [&](size_t i, int) { std::this_thread::sleep_for(std::chrono::milliseconds(i == slow ? 300 : 2)); });
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+
+        // without stealing, the slow worker alone would take 300 + 99 * 2 ms
+        cout << "makespan " << t.count() * 1000 << " ms, " << pool.get_nstolen() << " stolen" << endl;
+        pass = pass and check(pool.get_nstolen() > 0 and t.count() < 0.45, "stealing");
+    }
+
+    {  // the first error stops the run and is rethrown
+        cusz::WorkStealingPool pool(3);
+        std::atomic<int>       ndone{0};
+        auto                   thrown = false;
+        try {
+            pool.run(
+                10000, [](size_t) { return 1; },
+                [&](size_t i, int) {
+                    if (i == 10) throw std::runtime_error("job 10");
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    ndone++;
+                });
+        }
+        catch (std::runtime_error const& e) {
+            thrown = std::string(e.what()) == "job 10";
+        }
+        pass = pass and check(thrown and ndone < 10000 - 1, "error stops the run");
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file test_workspace_arena.cc
+ * @author Jiannan Tian
+ * @brief slab carving, coalescing and reuse across field sizes; malloc/free stand in for the CUDA allocators
+ * @version 0.3
+ * @date 2022-03-18
+ *
+ * (C) 2022 by Washington State University, Argonne National Laboratory
+ *
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "../src/utils/workspace_arena.hh"
+
+using std::cout;
+using std::endl;
+
+size_t                  nmalloc = 0, nfree = 0, budget = SIZE_MAX, in_use = 0;  // budget: a device of that size
+std::map<void*, size_t> outstanding;
+
+void* raw_alloc(size_t nbyte)
+{
+    if (in_use + nbyte > budget) return nullptr;
+    nmalloc++, in_use += nbyte;
+    auto p         = malloc(nbyte);
+    outstanding[p] = nbyte;
+    return p;
+}
+
+void raw_free(void* p)
+{
+    nfree++, in_use -= outstanding[p];
+    outstanding.erase(p);
+    free(p);
+}
+
+bool check(bool ok, const char* what)
+{
+    cout << what << "\t" << (ok ? "ok" : "wrong") << endl;
+    return ok;
+}
+
+// stage workspaces of a field of `len` elements, sized roughly as in the default path
+std::vector<void*> compress_once(cusz::WorkspaceArena& arena, size_t len)
+{
+    std::vector<void*> ws;
+    for (auto nbyte : {len * 4, len * 2, len * 4 / 5, len * 2, len * 2, (size_t)4096})
+        ws.push_back(arena.allocate(nbyte));
+    // touch all of it; overlaps would show up in the sanitizers
+    for (auto p : ws) static_cast<uint8_t*>(p)[0] = 1;
+    return ws;
+}
+
+int main()
+{
+    auto pass = true;
+
+    {  // disabled: pass-through
+        nmalloc = nfree = 0;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        auto p = arena.allocate(1000);
+        arena.deallocate(p);
+        pass = pass and check(nmalloc == 1 and nfree == 1 and arena.get_nslab() == 0, "disabled, pass-through");
+    }
+
+    {  // the largest field first, then smaller and equal ones reuse the slabs
+        nmalloc = nfree = 0;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        arena.enable();
+
+        std::vector<size_t> fields{1 << 22, 1 << 20, 3 << 20, 1 << 22, 12345, 1 << 21};
+        auto                ws = compress_once(arena, fields[0]);
+        for (auto p : ws) arena.deallocate(p);
+        auto after_first = nmalloc;
+
+        for (auto i = 1u; i < fields.size(); i++) {
+            ws = compress_once(arena, fields[i]);
+            for (auto j = ws.size(); j-- > 0;) arena.deallocate(ws[j]);  // release in another order
+        }
+        pass = pass and check(nmalloc == after_first and arena.get_nbyte_live() == 0, "reuse across field sizes");
+        pass = pass and check(
+                            arena.get_nbyte_peak() >= fields[0] * 4 and arena.get_nbyte_peak() < fields[0] * 12,
+                            "peak workspace of the largest field");
+    }
+
+    {  // coalescing: freed neighbors merge, so a block as large as the slab fits again
+        nmalloc = nfree = 0;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        arena.enable();
+        arena.reserve(1 << 24);
+
+        std::vector<void*> small;
+        for (auto i = 0; i < 16; i++) small.push_back(arena.allocate(1 << 20));
+        for (auto i = 0; i < 16; i += 2) arena.deallocate(small[i]);
+        for (auto i = 1; i < 16; i += 2) arena.deallocate(small[i]);
+        auto whole = arena.allocate(1 << 24);
+        pass       = pass and check(nmalloc == 1 and whole != nullptr, "coalescing");
+        arena.deallocate(whole);
+    }
+
+    {  // trim gives idle slabs back; a live block keeps its slab
+        nmalloc = nfree = 0;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        arena.enable();
+        auto a = arena.allocate(32 << 20);
+        auto b = arena.allocate(64 << 20);
+        arena.deallocate(a);
+        arena.trim();
+        auto kept = arena.get_nslab() == 1 and nfree == 1;
+        arena.deallocate(b);
+        arena.trim();
+        pass = pass and check(kept and arena.get_nslab() == 0 and nfree == 2, "trim");
+    }
+
+    {  // out of memory: idle slabs are trimmed before giving up
+        nmalloc = nfree = 0;
+        budget          = 48 << 20;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        arena.enable();
+        auto a = arena.allocate(40 << 20);
+        arena.deallocate(a);
+        auto b = arena.allocate(44 << 20);  // does not fit in the 40 MiB slab
+        pass   = pass and check(b != nullptr and nfree == 1 and arena.get_nslab() == 1, "trim on out-of-memory");
+        arena.deallocate(b);
+        budget = SIZE_MAX;
+    }
+
+    {  // a pointer not carved by the arena goes to the underlying allocator
+        nmalloc = nfree = 0;
+        cusz::WorkspaceArena arena(raw_alloc, raw_free);
+        auto p = arena.allocate(100);  // disabled
+        arena.enable();
+        arena.deallocate(p);
+        pass = pass and check(nfree == 1, "foreign pointer");
+    }
+
+    cout << (pass ? "PASSED" : "FAILED") << endl;
+    return pass ? 0 : 1;
+}